@@ -0,0 +1,15 @@
+#include "async.hpp"
+
+std::function<ALLEGRO_BITMAP* (ALLEGRO_BITMAP*)>
+filters::async::consume(std::function<ALLEGRO_BITMAP* (ALLEGRO_BITMAP*)> filter)
+{
+	return	[filter](ALLEGRO_BITMAP* source) -> ALLEGRO_BITMAP*
+	{
+		if (!source)	return nullptr;
+
+		ALLEGRO_BITMAP*	output	=	filter(source);
+		if (output != source)
+			al_destroy_bitmap(source);
+		return	output;
+	};
+}
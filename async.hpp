@@ -0,0 +1,298 @@
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "filters.hpp"
+#include "parallel.hpp"
+
+/**
+ *	filtry liczone asynchronicznie na puli wątków biblioteki. wynik to
+ *	std::shared_future, do którego można dopiąć następny krok albo
+ *	funkcję zwrotną, więc wywołujący nie czeka między krokami.
+ *
+ *	filters::async::run([=]() { return filters::gaussian_blur(photo, 2); })
+ *		.then(filters::async::consume([](ALLEGRO_BITMAP* b) { return filters::sharpen(b); }))
+ *		.done([](ALLEGRO_BITMAP* out) { ... });
+*/
+
+namespace filters
+{
+	namespace async
+	{
+		/*
+		 *	How a value of T is stored and passed on: fn() into a promise,
+		 *	future's value into the next step or callback. result<void>
+		 *	passes nothing, steps after it take no argument.
+		 */
+		template <typename T>
+		struct step
+		{
+			template <typename Fn>
+			struct after
+			{
+				typedef	typename std::result_of<Fn(T)>::type	type;
+			};
+
+			template <typename Fn>
+			static void
+			store(std::promise<T>& promise, Fn& fn)
+			{
+				promise.set_value(fn());
+			}
+
+			template <typename Fn>
+			static typename after<Fn>::type
+			call(Fn& fn, const std::shared_future<T>& future)
+			{
+				return	fn(future.get());
+			}
+
+			/*
+			 *	fn(value), fn(T()) if the call threw.
+			 */
+			template <typename Fn>
+			static void
+			settle(Fn& fn, const std::shared_future<T>& future)
+			{
+				T	value	=	T();
+				try
+				{
+					value	=	future.get();
+				}
+				catch (...)
+				{
+				}
+				fn(value);
+			}
+		};
+
+		template <>
+		struct step<void>
+		{
+			template <typename Fn>
+			struct after
+			{
+				typedef	typename std::result_of<Fn()>::type	type;
+			};
+
+			template <typename Fn>
+			static void
+			store(std::promise<void>& promise, Fn& fn)
+			{
+				fn();
+				promise.set_value();
+			}
+
+			template <typename Fn>
+			static typename after<Fn>::type
+			call(Fn& fn, const std::shared_future<void>& future)
+			{
+				future.get();
+				return	fn();
+			}
+
+			template <typename Fn>
+			static void
+			settle(Fn& fn, const std::shared_future<void>& future)
+			{
+				try
+				{
+					future.get();
+				}
+				catch (...)
+				{
+				}
+				fn();
+			}
+		};
+
+		/*
+		 *	Shared by a result and the job computing it: the value (or
+		 *	exception) and jobs to start once it's there.
+		 */
+		template <typename T>
+		struct state
+		{
+			std::promise<T>							promise;
+			std::shared_future<T>					future;
+			std::mutex								mutex;
+			bool									ready;
+			std::vector<std::function<void ()> >	next;
+
+			state()
+				:	future(promise.get_future()), ready(false)
+			{
+			}
+
+			/*
+			 *	Stores fn() (or what it threw) and queues jobs waiting for it.
+			 */
+			template <typename Fn>
+			void
+			fulfil(Fn& fn)
+			{
+				try
+				{
+					step<T>::store(promise, fn);
+				}
+				catch (...)
+				{
+					promise.set_exception(std::current_exception());
+				}
+
+				std::vector<std::function<void ()> >	jobs;
+				{
+					std::lock_guard<std::mutex>	guard(mutex);
+					ready	=	true;
+					jobs.swap(next);
+				}
+				for (std::size_t i = 0; i < jobs.size(); ++i)
+					parallel::submit(jobs[i]);
+			}
+
+			/*
+			 *	Queues job once the value is there, at once if it already is.
+			 */
+			void
+			when_ready(std::function<void ()> job)
+			{
+				{
+					std::lock_guard<std::mutex>	guard(mutex);
+					if (!ready)
+					{
+						next.push_back(job);
+						return;
+					}
+				}
+				parallel::submit(job);
+			}
+		};
+
+		/*
+		 *	Value of a call running on the pool. Copies share the call.
+		 *	Waiting for a result inside a pool job may never end, as the job
+		 *	computing it may be queued behind; steps are chained with then.
+		 */
+		template <typename T>
+		class result
+		{
+		public:
+			explicit result(std::shared_ptr<state<T> > s)
+				:	state_(s)
+			{
+			}
+
+			/*
+			 *	RET:	std::shared_future<T>
+			 *	get() returns the value, or throws what the call threw.
+			 */
+			std::shared_future<T>
+			future() const
+			{
+				return	state_->future;
+			}
+
+			T
+			get() const
+			{
+				return	state_->future.get();
+			}
+
+			/*
+			 *			next step
+			 *	ARGS:	Fn(T) -> U, Fn() -> U for result<void>
+			 *	RET:	result<U>
+			 *	Queues fn(value) once this result is ready; the caller doesn't
+			 *	wait. If this call threw, fn isn't called and the returned
+			 *	result throws the same.
+			 */
+			template <typename Fn>
+			result<typename step<T>::template after<Fn>::type>
+			then(Fn fn) const
+			{
+				typedef	typename step<T>::template after<Fn>::type	U;
+
+				std::shared_ptr<state<T> >	in	=	state_;
+				std::shared_ptr<state<U> >	out	=	std::make_shared<state<U> >();
+				state_->when_ready([in, out, fn]() mutable
+				{
+					auto	next	=	[&]() { return step<T>::call(fn, in->future); };
+					out->fulfil(next);
+				});
+				return	result<U>(out);
+			}
+
+			/*
+			 *			callback
+			 *	ARGS:	Fn(T), Fn() for result<void>
+			 *	Calls fn(value) on a pool thread once this result is ready.
+			 *	If the call threw, fn gets T(), nullptr for bitmaps, as from
+			 *	a filter that failed.
+			 */
+			template <typename Fn>
+			void
+			done(Fn fn) const
+			{
+				std::shared_ptr<state<T> >	in	=	state_;
+				state_->when_ready([in, fn]() mutable
+				{
+					step<T>::settle(fn, in->future);
+				});
+			}
+
+		private:
+			std::shared_ptr<state<T> >	state_;
+		};
+
+		/*
+		 *			call
+		 *	ARGS:	Fn() -> T
+		 *	RET:	result<T>
+		 *	Queues fn on the library's pool and returns at once.
+		 *	Bitmaps used on pool threads have to be memory bitmaps
+		 *	(see Threads in filters.hpp).
+		 */
+		template <typename Fn>
+		result<typename std::result_of<Fn()>::type>
+		run(Fn fn)
+		{
+			typedef	typename std::result_of<Fn()>::type	T;
+
+			std::shared_ptr<state<T> >	out	=	std::make_shared<state<T> >();
+			parallel::submit([out, fn]() mutable
+			{
+				out->fulfil(fn);
+			});
+			return	result<T>(out);
+		}
+
+		/*
+		 *			call		,	callback
+		 *	ARGS:	Fn() -> T	,	Done(T), Done() for void
+		 *	run(fn).done(done).
+		 */
+		template <typename Fn, typename Done>
+		void
+		run(Fn fn, Done done)
+		{
+			run(fn).done(done);
+		}
+
+		/*
+		 *			bitmap filter
+		 *	ARGS:	std::function<ALLEGRO_BITMAP* (ALLEGRO_BITMAP*)>
+		 *	RET:	std::function<ALLEGRO_BITMAP* (ALLEGRO_BITMAP*)>
+		 *	Step for then() that owns its input: runs filter and destroys
+		 *	the input unless filter returned it. A nullptr input (earlier
+		 *	step failed) is passed on without calling filter.
+		 */
+		std::function<ALLEGRO_BITMAP* (ALLEGRO_BITMAP*)>
+		consume(std::function<ALLEGRO_BITMAP* (ALLEGRO_BITMAP*)> filter);
+	}
+}
@@ -0,0 +1,224 @@
+#include "filters.hpp"
+#include "raster.hpp"
+#include "parallel.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	using filters::raster::image;
+	using filters::raster::luma;
+
+	/*
+	 *	Homogeneous colour sum: colour divided by weight is the average.
+	 */
+	struct cell
+	{
+		float	r;
+		float	g;
+		float	b;
+		float	w;
+	};
+
+	/*
+	 *	Bilateral grid: x and y downsampled by spatial sigma, z is luma
+	 *	downsampled by range sigma. z is the innermost axis, so the 8 cells
+	 *	read by slicing are 4 pairs of neighbours in memory.
+	 */
+	struct grid
+	{
+		int					size_x;
+		int					size_y;
+		int					size_z;
+		std::vector<cell>	cells;
+
+		cell*
+		at(int x, int y, int z)
+		{
+			return	&cells[((std::size_t) y * size_x + x) * size_z + z];
+		}
+	};
+
+	/*
+	 *	[1 4 6 4 1] / 16 along one axis, cells outside of the grid are empty.
+	 *	Lines along the axis are independent, so they are split between threads.
+	 */
+	void
+	blur_axis(grid& g, int axis)
+	{
+		const int	n		=	axis == 0 ? g.size_x : axis == 1 ? g.size_y : g.size_z;
+		const int	lines	=	g.size_x * g.size_y * g.size_z / n;
+		const float	taps[5]	=	{1 / 16.0f, 4 / 16.0f, 6 / 16.0f, 4 / 16.0f, 1 / 16.0f};
+
+		filters::parallel::for_bands(lines, [&](int, int begin, int end)
+		{
+			std::vector<cell>	line(n);
+			for (int l = begin; l < end; ++l)
+			{
+				// first cell of line and distance between its cells
+				cell*		first;
+				std::size_t	step;
+				if (axis == 2)
+				{
+					first	=	&g.cells[(std::size_t) l * g.size_z];
+					step	=	1;
+				}
+				else if (axis == 0)
+				{
+					first	=	g.at(0, l / g.size_z, l % g.size_z);
+					step	=	g.size_z;
+				}
+				else
+				{
+					first	=	g.at(l / g.size_z, 0, l % g.size_z);
+					step	=	(std::size_t) g.size_x * g.size_z;
+				}
+
+				for (int i = 0; i < n; ++i)
+					line[i]	=	first[i * step];
+
+				for (int i = 0; i < n; ++i)
+				{
+					cell	sum	=	{0, 0, 0, 0};
+					for (int t = -2; t <= 2; ++t)
+					{
+						if (i + t < 0 || i + t >= n)	continue;
+						const cell&	c	=	line[i + t];
+						float		k	=	taps[t + 2];
+						sum.r	+=	c.r * k;
+						sum.g	+=	c.g * k;
+						sum.b	+=	c.b * k;
+						sum.w	+=	c.w * k;
+					}
+					first[i * step]	=	sum;
+				}
+			}
+		}, 64);
+	}
+}
+
+ALLEGRO_BITMAP*
+filters::bilateral(ALLEGRO_BITMAP* source, float spatial_sigma, float range_sigma, region roi)
+{
+	// grid cells are placed from the image corner, a window would move them
+	return	raster::into_region(source, roi, true, [&](const view& in, const view& out)
+	{
+		return	bilateral(in, out, spatial_sigma, range_sigma);
+	});
+}
+
+bool
+filters::bilateral(const view& source, const view& output, float spatial_sigma, float range_sigma)
+{
+	// slice reads every pixel before writing it, so output may be source
+	image	in	=	raster::open(source);
+	image	out	=	raster::open(output);
+	if (!in.data || !out.data || in.width != out.width || in.height != out.height)
+		return	false;
+
+	const float	ss	=	std::max(spatial_sigma, 1.0f);
+	const float	sr	=	std::max(range_sigma, 1.0f);
+
+	grid	g;
+	g.size_x	=	int((in.width - 1) / ss + 0.5f) + 1;
+	g.size_y	=	int((in.height - 1) / ss + 0.5f) + 1;
+	g.size_z	=	int(255 / sr + 0.5f) + 1;
+	cell	empty	=	{0, 0, 0, 0};
+	g.cells.assign((std::size_t) g.size_x * g.size_y * g.size_z, empty);
+
+	// splat: every pixel goes to its nearest cell. Bands are rows of grid,
+	// so two threads never add to the same cell
+	std::vector<int>	cell_x(in.width);
+	for (int x = 0; x < in.width; ++x)
+		cell_x[x]	=	int(x / ss + 0.5f);
+
+	parallel::for_bands(g.size_y, [&](int, int begin, int end)
+	{
+		for (int y = 0; y < in.height; ++y)
+		{
+			int	gy	=	int(y / ss + 0.5f);
+			if (gy < begin || gy >= end)	continue;
+
+			const unsigned char*	p	=	raster::row(in, y);
+			for (int x = 0; x < in.width; ++x, p += 4)
+			{
+				cell*	c	=	g.at(cell_x[x], gy, int(luma(p) / sr + 0.5f));
+				c->r	+=	p[0];
+				c->g	+=	p[1];
+				c->b	+=	p[2];
+				c->w	+=	1.0f;
+			}
+		}
+	}, 1);
+
+	for (int axis = 0; axis < 3; ++axis)
+		blur_axis(g, axis);
+
+	// slice: trilinear read at pixel's position and luma
+	std::vector<int>	x0(in.width);
+	std::vector<float>	tx(in.width);
+	for (int x = 0; x < in.width; ++x)
+	{
+		float	fx	=	x / ss;
+		x0[x]	=	std::min(int(fx), std::max(g.size_x - 2, 0));
+		tx[x]	=	std::min(fx - x0[x], 1.0f);
+	}
+
+	parallel::for_bands(in.height, [&](int, int begin, int end)
+	{
+		for (int y = begin; y < end; ++y)
+		{
+			float	fy	=	y / ss;
+			int		y0	=	std::min(int(fy), std::max(g.size_y - 2, 0));
+			int		y1	=	std::min(y0 + 1, g.size_y - 1);
+			float	ty	=	std::min(fy - y0, 1.0f);
+
+			const unsigned char*	p	=	raster::row(in, y);
+			unsigned char*			o	=	raster::row(out, y);
+			for (int x = 0; x < in.width; ++x, p += 4, o += 4)
+			{
+				float	fz	=	luma(p) / sr;
+				int		z0	=	std::min(int(fz), std::max(g.size_z - 2, 0));
+				int		z1	=	std::min(z0 + 1, g.size_z - 1);
+				float	tz	=	std::min(fz - z0, 1.0f);
+				int		xa	=	x0[x];
+				int		xb	=	std::min(xa + 1, g.size_x - 1);
+
+				const cell*	c[8]	=	{	g.at(xa, y0, z0), g.at(xa, y0, z1), g.at(xb, y0, z0), g.at(xb, y0, z1),
+											g.at(xa, y1, z0), g.at(xa, y1, z1), g.at(xb, y1, z0), g.at(xb, y1, z1)	};
+				float		k[8];
+				k[0]	=	(1 - tx[x]) * (1 - ty) * (1 - tz);
+				k[1]	=	(1 - tx[x]) * (1 - ty) * tz;
+				k[2]	=	tx[x] * (1 - ty) * (1 - tz);
+				k[3]	=	tx[x] * (1 - ty) * tz;
+				k[4]	=	(1 - tx[x]) * ty * (1 - tz);
+				k[5]	=	(1 - tx[x]) * ty * tz;
+				k[6]	=	tx[x] * ty * (1 - tz);
+				k[7]	=	tx[x] * ty * tz;
+
+				cell	sum	=	{0, 0, 0, 0};
+				for (int i = 0; i < 8; ++i)
+				{
+					sum.r	+=	c[i]->r * k[i];
+					sum.g	+=	c[i]->g * k[i];
+					sum.b	+=	c[i]->b * k[i];
+					sum.w	+=	c[i]->w * k[i];
+				}
+
+				if (sum.w > 1e-6f)
+				{
+					o[0]	=	(unsigned char) std::min(sum.r / sum.w + 0.5f, 255.0f);
+					o[1]	=	(unsigned char) std::min(sum.g / sum.w + 0.5f, 255.0f);
+					o[2]	=	(unsigned char) std::min(sum.b / sum.w + 0.5f, 255.0f);
+				}
+				else
+					std::memcpy(o, p, 3);
+				o[3]	=	255;
+			}
+		}
+	});
+
+	return	true;
+}
@@ -0,0 +1,314 @@
+#include "cache.hpp"
+#include "raster.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+namespace
+{
+	const std::uint64_t	prime	=	0x9E3779B97F4A7C15ull;
+
+	inline std::uint64_t
+	mix(std::uint64_t h, std::uint64_t word)
+	{
+		h	=	(h ^ word) * prime;
+		return	h ^ (h >> 29);
+	}
+
+	/*
+	 *	Hash of pixel rows (without padding between them). Four independent
+	 *	lanes take 32 bytes per step, so the loop is bound by memory, not by
+	 *	multiply latency.
+	 */
+	std::uint64_t
+	hash_pixels(const filters::raster::image& img)
+	{
+		std::uint64_t	lanes[4]	=	{1, 2, 3, 4};
+		const int		row_bytes	=	img.width * 4;
+
+		for (int y = 0; y < img.height; ++y)
+		{
+			const unsigned char*	p	=	filters::raster::row(img, y);
+			int						i	=	0;
+
+			for (; i + 32 <= row_bytes; i += 32)
+			{
+				std::uint64_t	w[4];
+				std::memcpy(w, p + i, 32);
+				for (int l = 0; l < 4; ++l)
+					lanes[l]	=	mix(lanes[l], w[l]);
+			}
+
+			for (; i < row_bytes; ++i)
+				lanes[0]	=	mix(lanes[0], p[i]);
+		}
+
+		std::uint64_t	h	=	mix(img.width, img.height);
+		for (int l = 0; l < 4; ++l)
+			h	=	mix(h, lanes[l]);
+		return	h;
+	}
+
+	std::uint64_t
+	hash_string(const std::string& s, std::uint64_t h)
+	{
+		for (std::size_t i = 0; i < s.size(); ++i)
+			h	=	mix(h, (unsigned char) s[i]);
+		return	mix(h, s.size());
+	}
+
+	ALLEGRO_BITMAP*
+	to_bitmap(int width, int height, const std::vector<unsigned char>& pixels)
+	{
+		ALLEGRO_BITMAP*	output	=	al_create_bitmap(width, height);
+		if (!output)	return nullptr;
+
+		filters::raster::image	out	=	filters::raster::lock(output, ALLEGRO_LOCK_WRITEONLY);
+		if (!out.data)
+		{
+			al_destroy_bitmap(output);
+			return	nullptr;
+		}
+
+		for (int y = 0; y < height; ++y)
+			std::memcpy(filters::raster::row(out, y), &pixels[y * width * 4], width * 4);
+
+		al_unlock_bitmap(output);
+		return	output;
+	}
+
+	bool
+	from_bitmap(ALLEGRO_BITMAP* bitmap, int& width, int& height, std::vector<unsigned char>& pixels)
+	{
+		filters::raster::image	in	=	filters::raster::lock(bitmap, ALLEGRO_LOCK_READONLY);
+		if (!in.data)	return false;
+
+		width	=	in.width;
+		height	=	in.height;
+		pixels.resize(width * height * 4);
+		for (int y = 0; y < height; ++y)
+			std::memcpy(&pixels[y * width * 4], filters::raster::row(in, y), width * 4);
+
+		al_unlock_bitmap(bitmap);
+		return	true;
+	}
+}
+
+double
+filters::cache::statistics::hit_rate() const
+{
+	std::uint64_t	total	=	memory_hits + disk_hits + misses;
+	return	total ? double(memory_hits + disk_hits) / total : 0.0;
+}
+
+filters::cache::cache(std::size_t memory_limit, std::size_t disk_limit, std::string directory)
+	:	memory_limit_(memory_limit),
+		memory_used_(0),
+		disk_limit_(directory.empty() ? 0 : disk_limit),
+		disk_used_(0),
+		directory_(directory)
+{
+	stats_.memory_hits	=	stats_.disk_hits	=	stats_.misses	=	stats_.evictions	=	0;
+}
+
+filters::cache::~cache()
+{
+	// files stay on disk, next cache with the same directory finds them by name
+}
+
+ALLEGRO_BITMAP*
+filters::cache::apply(ALLEGRO_BITMAP* source, const std::string& key, filter_fn filter)
+{
+	raster::image	in	=	raster::lock(source, ALLEGRO_LOCK_READONLY);
+	if (!in.data)	return nullptr;
+	std::uint64_t	hash	=	hash_string(key, hash_pixels(in));
+	al_unlock_bitmap(source);
+
+	{
+		std::lock_guard<std::mutex>	guard(mutex_);
+
+		auto	found	=	memory_index_.find(hash);
+		if (found != memory_index_.end() && found->second->key == key)
+		{
+			memory_.splice(memory_.begin(), memory_, found->second);
+			++stats_.memory_hits;
+			return	to_bitmap(found->second->width, found->second->height, found->second->pixels);
+		}
+
+		entry	e;
+		if (load_from_disk(hash, key, e))
+		{
+			++stats_.disk_hits;
+			ALLEGRO_BITMAP*	output	=	to_bitmap(e.width, e.height, e.pixels);
+			store(std::move(e));
+			return	output;
+		}
+
+		++stats_.misses;
+	}
+
+	// filter runs without the lock, other threads may use the cache meanwhile
+	ALLEGRO_BITMAP*	output	=	filter(source);
+	if (!output)	return nullptr;
+
+	entry	e;
+	e.hash	=	hash;
+	e.key	=	key;
+	if (from_bitmap(output, e.width, e.height, e.pixels))
+	{
+		std::lock_guard<std::mutex>	guard(mutex_);
+		store(std::move(e));
+	}
+
+	return	output;
+}
+
+filters::cache::statistics
+filters::cache::stats() const
+{
+	std::lock_guard<std::mutex>	guard(mutex_);
+	return	stats_;
+}
+
+void
+filters::cache::clear()
+{
+	std::lock_guard<std::mutex>	guard(mutex_);
+
+	while (!disk_.empty())
+		drop_file(--disk_.end());
+
+	memory_.clear();
+	memory_index_.clear();
+	memory_used_	=	0;
+}
+
+std::string
+filters::cache::file_name(std::uint64_t hash) const
+{
+	char	name[32];
+	std::snprintf(name, sizeof(name), "/%016llx.px", (unsigned long long) hash);
+	return	directory_ + name;
+}
+
+void
+filters::cache::store(entry&& e)
+{
+	auto	old	=	memory_index_.find(e.hash);
+	if (old != memory_index_.end())
+	{
+		memory_used_	-=	old->second->pixels.size();
+		memory_.erase(old->second);
+		memory_index_.erase(old);
+	}
+
+	memory_used_	+=	e.pixels.size();
+	memory_.push_front(std::move(e));
+	memory_index_[memory_.front().hash]	=	memory_.begin();
+
+	while (memory_used_ > memory_limit_ && !memory_.empty())
+	{
+		lru_list::iterator	last	=	--memory_.end();
+		memory_used_	-=	last->pixels.size();
+		memory_index_.erase(last->hash);
+		++stats_.evictions;
+
+		entry	evicted	=	std::move(*last);
+		memory_.erase(last);
+		if (disk_limit_)
+			store_on_disk(std::move(evicted));
+	}
+}
+
+void
+filters::cache::store_on_disk(entry&& e)
+{
+	std::size_t	size	=	e.pixels.size();
+	if (size > disk_limit_)	return;
+
+	auto	known	=	disk_index_.find(e.hash);
+	if (known != disk_index_.end() && known->second->key == e.key)
+	{
+		disk_.splice(disk_.begin(), disk_, known->second);
+		return;
+	}
+	if (known != disk_index_.end())
+		drop_file(known->second);
+
+	std::ofstream	file(file_name(e.hash), std::ios::binary | std::ios::out);
+	if (!file)	return;
+
+	int	header[3]	=	{e.width, e.height, (int) e.key.size()};
+	file.write((const char*) header, sizeof(header));
+	file.write(e.key.data(), e.key.size());
+	file.write((const char*) e.pixels.data(), size);
+	if (!file)	return;
+
+	// disk list keeps only what is needed to find and account the file
+	e.pixels.clear();
+	e.pixels.shrink_to_fit();
+	disk_.push_front(std::move(e));
+	disk_.front().width		=	header[0];
+	disk_.front().height	=	header[1];
+	disk_index_[disk_.front().hash]	=	disk_.begin();
+	disk_used_	+=	size;
+
+	while (disk_used_ > disk_limit_)
+		drop_file(--disk_.end());
+}
+
+bool
+filters::cache::load_from_disk(std::uint64_t hash, const std::string& key, entry& e)
+{
+	if (directory_.empty())	return false;
+
+	std::ifstream	file(file_name(hash), std::ios::binary | std::ios::in);
+	if (!file)	return false;
+
+	int	header[3];
+	if (!file.read((char*) header, sizeof(header))	||
+		header[0] <= 0 || header[1] <= 0	||	header[2] != (int) key.size())
+		return	false;
+
+	e.key.resize(header[2]);
+	if (!file.read(&e.key[0], header[2]) || e.key != key)
+		return	false;
+
+	e.hash		=	hash;
+	e.width		=	header[0];
+	e.height	=	header[1];
+	e.pixels.resize(e.width * e.height * 4);
+	if (!file.read((char*) e.pixels.data(), e.pixels.size()))
+		return	false;
+
+	// files left by an earlier cache are adopted into the disk tier
+	auto	known	=	disk_index_.find(hash);
+	if (known != disk_index_.end())
+		disk_.splice(disk_.begin(), disk_, known->second);
+	else if (disk_limit_)
+	{
+		entry	meta;
+		meta.hash	=	hash;
+		meta.key	=	key;
+		meta.width	=	e.width;
+		meta.height	=	e.height;
+		disk_.push_front(meta);
+		disk_index_[hash]	=	disk_.begin();
+		disk_used_	+=	e.pixels.size();
+		while (disk_used_ > disk_limit_ && disk_.size() > 1)
+			drop_file(--disk_.end());
+	}
+
+	return	true;
+}
+
+void
+filters::cache::drop_file(lru_list::iterator it)
+{
+	std::remove(file_name(it->hash).c_str());
+	disk_used_	-=	(std::size_t) it->width * it->height * 4;
+	disk_index_.erase(it->hash);
+	disk_.erase(it);
+}
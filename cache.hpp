@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "filters.hpp"
+
+/**
+ *	pamięć podręczna wyników filtrów. kluczem jest skrót pikseli źródła
+ *	razem z nazwą filtra i jego parametrami, więc ten sam obraz z tymi
+ *	samymi parametrami jest liczony tylko raz.
+*/
+
+namespace filters
+{
+	class cache
+	{
+	public:
+		typedef	std::function<ALLEGRO_BITMAP* (ALLEGRO_BITMAP* source)>	filter_fn;
+
+		struct statistics
+		{
+			std::uint64_t	memory_hits;
+			std::uint64_t	disk_hits;
+			std::uint64_t	misses;
+			std::uint64_t	evictions;
+
+			double	hit_rate() const;
+		};
+
+		/*
+		 *			memory limit	,	disk limit	,	directory for disk tier
+		 *	ARGS:	size_t			,	[size_t]	,	[std::string]
+		 *	Limits are in bytes of pixel data. Entries evicted from memory
+		 *	go to disk tier if directory is given, disk tier evicts files
+		 *	the same least recently used way.
+		 */
+		cache(std::size_t memory_limit, std::size_t disk_limit = 0, std::string directory = "");
+		~cache();
+
+		/*
+		 *			source bitmap	,	filter identity and parameters	,	filter
+		 *	ARGS:	ALLEGRO_BITMAP*	,	std::string						,	filter_fn
+		 *	RET:	ALLEGRO_BITMAP*
+		 *	Returns copy of cached result for the same pixels and key,
+		 *	runs filter and stores its result otherwise.
+		 *	Returned bitmap is owned by caller, like results of filters.
+		 */
+		ALLEGRO_BITMAP*
+		apply(ALLEGRO_BITMAP* source, const std::string& key, filter_fn filter);
+
+		statistics	stats() const;
+		void		clear();
+
+	private:
+		struct entry
+		{
+			std::uint64_t				hash;
+			std::string					key;
+			int							width;
+			int							height;
+			std::vector<unsigned char>	pixels;
+		};
+
+		typedef	std::list<entry>	lru_list;
+
+		cache(const cache&)					=	delete;
+		cache&	operator=(const cache&)		=	delete;
+
+		std::string	file_name(std::uint64_t hash) const;
+		void		store(entry&& e);
+		void		store_on_disk(entry&& e);
+		bool		load_from_disk(std::uint64_t hash, const std::string& key, entry& e);
+		void		drop_file(lru_list::iterator it);
+
+		std::size_t		memory_limit_;
+		std::size_t		memory_used_;
+		std::size_t		disk_limit_;
+		std::size_t		disk_used_;
+		std::string		directory_;
+
+		// memory entries hold pixels, disk entries only hash, key and size
+		lru_list												memory_;
+		lru_list												disk_;
+		std::unordered_map<std::uint64_t, lru_list::iterator>	memory_index_;
+		std::unordered_map<std::uint64_t, lru_list::iterator>	disk_index_;
+
+		statistics			stats_;
+		mutable std::mutex	mutex_;
+	};
+
+	/*
+	 *			filter name	,	parameters...
+	 *	ARGS:	std::string	,	any streamable
+	 *	RET:	std::string
+	 *	Builds cache key, e.g. cache_key("gaussian_blur", 2, BORDER_WRAP).
+	 */
+	inline void
+	append_key(std::ostringstream&)
+	{
+	}
+
+	template <typename T, typename... Rest>
+	void
+	append_key(std::ostringstream& out, const T& value, const Rest&... rest)
+	{
+		out	<<	':'	<<	value;
+		append_key(out, rest...);
+	}
+
+	template <typename... Args>
+	std::string
+	cache_key(const std::string& name, const Args&... args)
+	{
+		std::ostringstream	out;
+		out	<<	name;
+		append_key(out, args...);
+		return	out.str();
+	}
+}
@@ -0,0 +1,403 @@
+#include "filters.hpp"
+#include "raster.hpp"
+#include "gray.hpp"
+#include "cpu.hpp"
+#include "parallel.hpp"
+
+#include <vector>
+#include <deque>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef FILTERS_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	using filters::raster::image;
+
+	inline unsigned char
+	div255(unsigned int x)
+	{
+		return	(x + 1 + (x >> 8)) >> 8;
+	}
+
+	inline unsigned char
+	quantize_alpha(float alpha)
+	{
+		return	std::min(std::max(int(alpha * 255 + 0.5f), 0), 255);
+	}
+
+	/*
+	 *	blend_row for pixels [x, width).
+	 */
+	inline void
+	blend_pixels(unsigned char* dst, const unsigned char* src, const unsigned char* alpha, int x, int width)
+	{
+		for (; x < width; ++x)
+		{
+			unsigned int	a	=	alpha[x];
+			for (int c = 0; c < 4; ++c)
+				dst[x * 4 + c]	=	div255(dst[x * 4 + c] * (255 - a)	+	src[x * 4 + c] * a);
+		}
+	}
+
+	/*
+	 *	dst = (dst * (255 - a) + src * a) / 255 per channel, a taken per pixel
+	 *	from alpha row. Both products fit in 16 bits, so SSE2 path blends
+	 *	4 pixels (16 channels) at once with no widening past 16 bits.
+	 */
+	void
+	blend_row_sse2(unsigned char* dst, const unsigned char* src, const unsigned char* alpha, int width)
+	{
+		int	x	=	0;
+#ifdef __SSE2__
+		const __m128i	zero	=	_mm_setzero_si128();
+		const __m128i	full	=	_mm_set1_epi16(255);
+		const __m128i	one		=	_mm_set1_epi16(1);
+
+		for (; x + 4 <= width; x += 4)
+		{
+			int		a4;
+			std::memcpy(&a4, alpha + x, 4);
+			__m128i	a	=	_mm_cvtsi32_si128(a4);
+			a	=	_mm_unpacklo_epi8(a, a);
+			a	=	_mm_unpacklo_epi16(a, a);
+
+			__m128i	d	=	_mm_loadu_si128((const __m128i*) (dst + x * 4));
+			__m128i	s	=	_mm_loadu_si128((const __m128i*) (src + x * 4));
+
+			__m128i	a_lo	=	_mm_unpacklo_epi8(a, zero);
+			__m128i	a_hi	=	_mm_unpackhi_epi8(a, zero);
+			__m128i	lo		=	_mm_add_epi16(	_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(full, a_lo)),
+												_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), a_lo));
+			__m128i	hi		=	_mm_add_epi16(	_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(full, a_hi)),
+												_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), a_hi));
+
+			lo	=	_mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one), _mm_srli_epi16(lo, 8)), 8);
+			hi	=	_mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one), _mm_srli_epi16(hi, 8)), 8);
+
+			_mm_storeu_si128((__m128i*) (dst + x * 4), _mm_packus_epi16(lo, hi));
+		}
+#endif
+		blend_pixels(dst, src, alpha, x, width);
+	}
+
+#ifdef FILTERS_DISPATCH
+	/*
+	 *	blend_row, 8 pixels at once. Every alpha byte is zero extended
+	 *	to its pixel's dword and multiplied into all 4 of its bytes.
+	 */
+	FILTERS_AVX2 void
+	blend_row_avx2(unsigned char* dst, const unsigned char* src, const unsigned char* alpha, int width)
+	{
+		const __m256i	zero	=	_mm256_setzero_si256();
+		const __m256i	full	=	_mm256_set1_epi16(255);
+		const __m256i	one		=	_mm256_set1_epi16(1);
+		const __m256i	spread	=	_mm256_set1_epi32(0x01010101);
+
+		int	x	=	0;
+		for (; x + 8 <= width; x += 8)
+		{
+			__m256i	a	=	_mm256_mullo_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (alpha + x))), spread);
+			__m256i	d	=	_mm256_loadu_si256((const __m256i*) (dst + x * 4));
+			__m256i	s	=	_mm256_loadu_si256((const __m256i*) (src + x * 4));
+
+			__m256i	a_lo	=	_mm256_unpacklo_epi8(a, zero);
+			__m256i	a_hi	=	_mm256_unpackhi_epi8(a, zero);
+			__m256i	lo		=	_mm256_add_epi16(	_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_sub_epi16(full, a_lo)),
+													_mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), a_lo));
+			__m256i	hi		=	_mm256_add_epi16(	_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_sub_epi16(full, a_hi)),
+													_mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), a_hi));
+
+			lo	=	_mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(lo, one), _mm256_srli_epi16(lo, 8)), 8);
+			hi	=	_mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(hi, one), _mm256_srli_epi16(hi, 8)), 8);
+
+			_mm256_storeu_si256((__m256i*) (dst + x * 4), _mm256_packus_epi16(lo, hi));
+		}
+		blend_pixels(dst, src, alpha, x, width);
+	}
+
+FILTERS_AVX512_BEGIN
+	/*
+	 *	blend_row_avx2, 16 pixels at once.
+	 */
+	FILTERS_AVX512 void
+	blend_row_avx512(unsigned char* dst, const unsigned char* src, const unsigned char* alpha, int width)
+	{
+		const __m512i	zero	=	_mm512_setzero_si512();
+		const __m512i	full	=	_mm512_set1_epi16(255);
+		const __m512i	one		=	_mm512_set1_epi16(1);
+		const __m512i	spread	=	_mm512_set1_epi32(0x01010101);
+
+		int	x	=	0;
+		for (; x + 16 <= width; x += 16)
+		{
+			__m512i	a	=	_mm512_mullo_epi32(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*) (alpha + x))), spread);
+			__m512i	d	=	_mm512_loadu_si512(dst + x * 4);
+			__m512i	s	=	_mm512_loadu_si512(src + x * 4);
+
+			__m512i	a_lo	=	_mm512_unpacklo_epi8(a, zero);
+			__m512i	a_hi	=	_mm512_unpackhi_epi8(a, zero);
+			__m512i	lo		=	_mm512_add_epi16(	_mm512_mullo_epi16(_mm512_unpacklo_epi8(d, zero), _mm512_sub_epi16(full, a_lo)),
+													_mm512_mullo_epi16(_mm512_unpacklo_epi8(s, zero), a_lo));
+			__m512i	hi		=	_mm512_add_epi16(	_mm512_mullo_epi16(_mm512_unpackhi_epi8(d, zero), _mm512_sub_epi16(full, a_hi)),
+													_mm512_mullo_epi16(_mm512_unpackhi_epi8(s, zero), a_hi));
+
+			lo	=	_mm512_srli_epi16(_mm512_add_epi16(_mm512_add_epi16(lo, one), _mm512_srli_epi16(lo, 8)), 8);
+			hi	=	_mm512_srli_epi16(_mm512_add_epi16(_mm512_add_epi16(hi, one), _mm512_srli_epi16(hi, 8)), 8);
+
+			_mm512_storeu_si512(dst + x * 4, _mm512_packus_epi16(lo, hi));
+		}
+		blend_pixels(dst, src, alpha, x, width);
+	}
+FILTERS_AVX512_END
+#endif
+
+	typedef	void (*blend_fn)(unsigned char* dst, const unsigned char* src, const unsigned char* alpha, int width);
+
+	const blend_fn	blend_row	=	FILTERS_PICK(blend_row_sse2, blend_row_avx2, blend_row_avx512);
+
+	/*
+	 *	Blends layers fg (with optional masks) over bg into out, all of
+	 *	the same size. Out may be any of the inputs. Masks are RGBA, or
+	 *	single channel images if mask_bytes is 1.
+	 */
+	void
+	blend_layers(	const image& bg, const std::vector<const image*>& fg, const std::vector<const image*>& masks,
+					const std::vector<float>& opacities, const image& out, int mask_bytes = 4)
+	{
+		std::vector<unsigned char>	opacity(fg.size());
+		for (std::size_t l = 0; l < fg.size(); ++l)
+			opacity[l]	=	quantize_alpha(opacities[l]);
+
+		// rows are independent, every band gets its own buffers
+		filters::parallel::for_bands(bg.height, [&](int, int begin, int end)
+		{
+			// constant opacity rows are filled once, mask rows once per image row
+			std::vector<std::vector<unsigned char> >	alpha(fg.size());
+			for (std::size_t l = 0; l < fg.size(); ++l)
+				alpha[l].assign(bg.width, opacity[l]);
+
+			// row is built in a small buffer, target may be one of the layers
+			std::vector<unsigned char>	row(bg.width * 4);
+			unsigned char*				dst	=	row.data();
+
+			for (int y = begin; y < end; ++y)
+			{
+				std::memcpy(dst, filters::raster::row(bg, y), bg.width * 4);
+
+				for (std::size_t l = 0; l < fg.size(); ++l)
+				{
+					const unsigned char*	a	=	alpha[l].data();
+
+					if (masks[l])
+					{
+						const unsigned char*	m		=	filters::raster::row(*masks[l], y);
+						unsigned char*			scaled	=	alpha[l].data();
+
+						// single channel row is the alpha row itself
+						if (mask_bytes == 1 && opacity[l] == 255)
+							a	=	m;
+						else if (mask_bytes == 1)
+							for (int x = 0; x < bg.width; ++x)
+								scaled[x]	=	div255(m[x] * opacity[l] + 127);
+
+						// blue channel, the one al_unmap_rgb(mask, &a, &a, &a) leaves in a
+						else if (opacity[l] == 255)
+							for (int x = 0; x < bg.width; ++x)
+								scaled[x]	=	m[x * 4 + 2];
+						else
+							for (int x = 0; x < bg.width; ++x)
+								scaled[x]	=	div255(m[x * 4 + 2] * opacity[l] + 127);
+					}
+
+					else if (!opacity[l])
+						continue;
+
+					blend_row(dst, filters::raster::row(*fg[l], y), a, bg.width);
+				}
+
+				for (int x = 0; x < bg.width; ++x)
+					dst[x * 4 + 3]	=	255;
+
+				std::memcpy(filters::raster::row(out, y), dst, bg.width * 4);
+			}
+		});
+	}
+
+	/*
+	 *	Locks the same part of every distinct bitmap once; the same bitmap
+	 *	may be used as background, layer, mask and target at the same time.
+	 *	Flags of the first lock of a bitmap are used.
+	 */
+	struct lock_set
+	{
+		filters::raster::rect			area;
+		std::vector<ALLEGRO_BITMAP*>	bitmaps;
+		std::deque<image>				images;
+
+		const image*
+		get(ALLEGRO_BITMAP* bitmap, int flags = ALLEGRO_LOCK_READONLY)
+		{
+			for (std::size_t i = 0; i < bitmaps.size(); ++i)
+				if (bitmaps[i] == bitmap)
+					return	&images[i];
+
+			image	img	=	filters::raster::lock(bitmap, area, flags);
+			if (!img.data)	return nullptr;
+			bitmaps.push_back(bitmap);
+			images.push_back(img);
+			return	&images.back();
+		}
+
+		~lock_set()
+		{
+			for (std::size_t i = 0; i < bitmaps.size(); ++i)
+				al_unlock_bitmap(bitmaps[i]);
+		}
+	};
+}
+
+filters::layer::layer(ALLEGRO_BITMAP* image, float opacity)
+	:	image(image), mask(nullptr), opacity(opacity)
+{
+}
+
+filters::layer::layer(ALLEGRO_BITMAP* image, ALLEGRO_BITMAP* mask, float opacity)
+	:	image(image), mask(mask), opacity(opacity)
+{
+}
+
+ALLEGRO_BITMAP*
+filters::composite(ALLEGRO_BITMAP* background, const std::vector<layer>& layers, region roi)
+{
+	int	img_w	=	al_get_bitmap_width(background);
+	int	img_h	=	al_get_bitmap_height(background);
+
+	for (std::size_t l = 0; l < layers.size(); ++l)
+	{
+		if (img_w	!=	al_get_bitmap_width(layers[l].image)	||
+			img_h	!=	al_get_bitmap_height(layers[l].image))
+			return	nullptr;
+
+		if (layers[l].mask	&&
+			(img_w	!=	al_get_bitmap_width(layers[l].mask)	||
+			 img_h	!=	al_get_bitmap_height(layers[l].mask)))
+			return	nullptr;
+	}
+
+	raster::rect	r	=	raster::clip(roi, img_w, img_h);
+	if (r.w <= 0 || r.h <= 0)	return roi.target;
+
+	if (roi.target	&&
+		(al_get_bitmap_width(roi.target) < r.x + r.w	||
+		 al_get_bitmap_height(roi.target) < r.y + r.h))
+		return	nullptr;
+
+	ALLEGRO_BITMAP*	output	=	roi.target ? roi.target : al_create_bitmap(r.w, r.h);
+	if (!output)	return nullptr;
+
+	// locks has to be released before output is returned
+	{
+		lock_set	locks;
+		locks.area	=	r;
+
+		// target locked first, it may be one of the inputs
+		const image*	out	=	nullptr;
+		raster::image	own_out	=	{nullptr, 0, 0, 0};
+		if (roi.target)
+			out	=	locks.get(roi.target, ALLEGRO_LOCK_READWRITE);
+		else
+		{
+			raster::rect	all	=	{0, 0, r.w, r.h};
+			own_out	=	raster::lock(output, all, ALLEGRO_LOCK_WRITEONLY);
+			out		=	own_out.data ? &own_out : nullptr;
+		}
+
+		const image*				bg	=	locks.get(background);
+		std::vector<const image*>	fg(layers.size());
+		std::vector<const image*>	masks(layers.size(), nullptr);
+		bool						ok	=	bg != nullptr	&&	out != nullptr;
+
+		for (std::size_t l = 0; ok && l < layers.size(); ++l)
+		{
+			fg[l]	=	locks.get(layers[l].image);
+			ok		=	fg[l] != nullptr;
+			if (ok && layers[l].mask)
+			{
+				masks[l]	=	locks.get(layers[l].mask);
+				ok			=	masks[l] != nullptr;
+			}
+		}
+
+		if (!ok)
+		{
+			if (own_out.data)	al_unlock_bitmap(output);
+			if (!roi.target)	al_destroy_bitmap(output);
+			return	nullptr;
+		}
+
+		std::vector<float>	opacity(layers.size());
+		for (std::size_t l = 0; l < layers.size(); ++l)
+			opacity[l]	=	layers[l].opacity;
+
+		blend_layers(*bg, fg, masks, opacity, *out);
+
+		if (own_out.data)	al_unlock_bitmap(output);
+	}
+
+	return output;
+}
+
+namespace
+{
+	bool
+	blend_view(	const filters::view& background, const filters::view& foreground, const filters::view* mask,
+				float alpha, const filters::view& output)
+	{
+		// mask may be single channel, see gray.hpp
+		const bool	single	=	mask && mask->format == filters::gray::format;
+		image		bg		=	filters::raster::open(background);
+		image		fg		=	filters::raster::open(foreground);
+		image		out		=	filters::raster::open(output);
+		image		m		=	!mask ? fg : single ? filters::gray::open(*mask) : filters::raster::open(*mask);
+		if (!bg.data || !fg.data || !out.data || !m.data)	return false;
+
+		if (fg.width != bg.width || out.width != bg.width || m.width != bg.width ||
+			fg.height != bg.height || out.height != bg.height || m.height != bg.height)
+			return	false;
+
+		blend_layers(bg, std::vector<const image*>(1, &fg), std::vector<const image*>(1, mask ? &m : nullptr),
+					 std::vector<float>(1, alpha), out, single ? 1 : 4);
+		return	true;
+	}
+}
+
+bool
+filters::alpha_blending(const view& background, const view& foreground, float alpha, const view& output)
+{
+	// as the bitmap version returns one of its inputs, that input is copied
+	if (alpha == 1.0f || alpha == 0.0f)
+	{
+		image	in	=	raster::open(alpha == 1.0f ? foreground : background);
+		image	bg	=	raster::open(background);
+		image	out	=	raster::open(output);
+		if (!in.data || !bg.data || !out.data || in.width != bg.width || in.height != bg.height ||
+			out.width != bg.width || out.height != bg.height)
+			return	false;
+
+		raster::copy(in, out);
+		return	true;
+	}
+	return	blend_view(background, foreground, nullptr, alpha, output);
+}
+
+bool
+filters::alpha_blending(const view& background, const view& foreground, const view& mask, const view& output)
+{
+	return	blend_view(background, foreground, &mask, 1.0f, output);
+}
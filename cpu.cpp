@@ -0,0 +1,63 @@
+#include "cpu.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	filters::cpu::level
+	choose()
+	{
+		filters::cpu::level	best	=	filters::cpu::detected();
+		const char*			wanted	=	std::getenv("FILTERS_CPU");
+		if (!wanted)	return best;
+
+		filters::cpu::level	l	=	best;
+		if (!std::strcmp(wanted, "sse2") || !std::strcmp(wanted, "baseline"))
+			l	=	filters::cpu::CPU_BASELINE;
+		else if (!std::strcmp(wanted, "avx2"))
+			l	=	filters::cpu::CPU_AVX2;
+		else if (!std::strcmp(wanted, "avx512"))
+			l	=	filters::cpu::CPU_AVX512;
+
+		// asking for more than the CPU has would end in SIGILL
+		return	l < best ? l : best;
+	}
+}
+
+filters::cpu::level
+filters::cpu::detected()
+{
+#ifdef FILTERS_DISPATCH
+	// also checks XGETBV, so a CPU with AVX under an OS that doesn't save it counts as baseline
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+		return	CPU_AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return	CPU_AVX2;
+#endif
+	return	CPU_BASELINE;
+}
+
+filters::cpu::level
+filters::cpu::active()
+{
+	static const level	chosen	=	choose();
+	return	chosen;
+}
+
+const char*
+filters::cpu::name(level l)
+{
+	switch (l)
+	{
+		case CPU_AVX512:	return "avx512";
+		case CPU_AVX2:		return "avx2";
+		default:			break;
+	}
+#ifdef __SSE2__
+	return	"sse2";
+#else
+	return	"baseline";
+#endif
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+/**
+ *	wybór wariantów jąder SIMD w czasie działania. program jest budowany
+ *	bez -march, więc warianty AVX2 i AVX-512 dostają swój zestaw
+ *	instrukcji atrybutem funkcji, a który z nich liczy, jest ustalane raz,
+ *	z CPUID albo ze zmiennej środowiska FILTERS_CPU.
+*/
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FILTERS_DISPATCH
+#define FILTERS_AVX2	__attribute__((target("avx2")))
+#define FILTERS_AVX512	__attribute__((target("avx2,avx512f,avx512bw")))
+
+// GCC 12 headers fill unused lanes of AVX-512 intrinsics with a
+// self-initialised value, which -Wmaybe-uninitialized reports at every use
+#ifndef __clang__
+#define FILTERS_AVX512_BEGIN	_Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+#define FILTERS_AVX512_END		_Pragma("GCC diagnostic pop")
+#else
+#define FILTERS_AVX512_BEGIN
+#define FILTERS_AVX512_END
+#endif
+#endif
+
+/*
+ *	Kernel for the active level out of baseline, AVX2 and AVX-512
+ *	variants. Without dispatch (other compilers and CPUs) the variants
+ *	aren't compiled and baseline is the only one.
+ */
+#ifdef FILTERS_DISPATCH
+#define FILTERS_PICK(baseline, avx2, avx512)	filters::cpu::pick(baseline, avx2, avx512)
+#else
+#define FILTERS_PICK(baseline, avx2, avx512)	(baseline)
+#endif
+
+namespace filters
+{
+	namespace cpu
+	{
+		enum level
+		{
+			CPU_BASELINE,	// what the compiler targets by default, SSE2 on x86-64
+			CPU_AVX2,
+			CPU_AVX512		// AVX-512 F and BW
+		};
+
+		/*
+		 *	RET:	level
+		 *	Best level both the CPU and the OS (saved vector state) support.
+		 */
+		level
+		detected();
+
+		/*
+		 *	RET:	level
+		 *	Level kernels run at: detected(), lowered by FILTERS_CPU set to
+		 *	sse2 (or baseline), avx2 or avx512. A level above detected()
+		 *	is never used. Chosen on first call, the same for the whole run.
+		 */
+		level
+		active();
+
+		/*
+		 *	RET:	const char*
+		 *	Name of level, as FILTERS_CPU takes it.
+		 */
+		const char*
+		name(level l);
+
+		/*
+		 *			variants of one kernel
+		 *	ARGS:	Fn, Fn, Fn
+		 *	RET:	Fn
+		 *	Variant for active(); null variants fall back to the level below.
+		 */
+		template <typename Fn>
+		Fn
+		pick(Fn baseline, Fn avx2, Fn avx512)
+		{
+			level	l	=	active();
+			if (l >= CPU_AVX512 && avx512)	return avx512;
+			if (l >= CPU_AVX2 && avx2)		return avx2;
+			return	baseline;
+		}
+	}
+}
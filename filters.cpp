@@ -1,1405 +1,2116 @@
-#include "filters.hpp"
-
-#include <iostream>
-#include <fstream>
-#include <ctime>
-
-inline double
-filters::lerp(double a, double b, double x)
-{
-	return a * (1 - x) + b * x;
-}
-
-inline double
-filters::cosrp(double a, double b, double x)
-{
-	double 	ft	=	x	*	3.1415927;
-	double	f	=	(1	-	cos(ft))	*	0.5;
-	return	a	*	(1	-	f)	+	b	*	f;
-}
-
-inline double
-filters::cubrp(double v0, double v1, double v2, double v3, double x)
-{
-	double	P	=	(v3	-	v2)	-	(v0	-	v1);
-	double	Q	=	(v0	-	v1)	-	P;
-	double	R	=	v2	-	v0;
-	double	S	=	v1;
-
-	return	(P	*	pow(x, 3)	+	Q	*	pow(x, 2)	+	R	*	x	+	S);
-}
-
-inline float
-filters::noise_1d(int x)
-{
-	x	=	(x	<<	13)	^	x;
-	return	(1.0 - ((x * (x * x * 15731 + 789221) + 1376312589) & 0x7fffffff) / 1073741824.0);
-}
-
-inline float
-filters::noise_2d(int x, int y)
-{
-    int	n	=	x	+	y	*	57;
-    n	=	(n	<<	13)	^ 	n;
-    return ( 1.0 - ( (n * (n * n * 15731 + 789221) + 1376312589) & 0x7fffffff) / 1073741824.0);
-}
-
-inline float
-filters::smooth_noise1d(int x)
-{
-	return	noise_1d(x) / 2	+	noise_1d(x - 1) / 4	+	noise_1d(x + 1) / 4;
-}
-
-inline float
-filters::smooth_noise2d(int x, int y)
-{
-    float	corners = (noise_2d(x - 1, y - 1) + noise_2d(x + 1, y - 1) + noise_2d(x - 1, y + 1) + noise_2d(x + 1, y + 1) ) / 16;
-    float	sides   = (noise_2d(x - 1, y) + noise_2d(x + 1, y) + noise_2d(x, y - 1) + noise_2d(x, y + 1)) / 8;
-    float	center  = noise_2d(x, y) / 4;
-
-    return corners + sides + center;
-}
-
-inline float
-filters::perlin::interpolated_noise_1d(float x)
-{
-	int		integer_X		=	int(x);
-	float	fractional_X	=	x	-	integer_X;
-	
-	float	v1 = smooth_noise1d(integer_X);
-	float	v2 = smooth_noise1d(integer_X + 1);
-
-	return cosrp(v1, v2, fractional_X);
-}
-
-float
-filters::perlin::perlin_noise_1d(float x)
-{
-	float	total = 0;
-	float	p	=	1.0 / 4.0;
-	int		n	= 	7;
-
-	for (int i = 0; i < n; ++i)
-	{
-		int		frequency = pow(2, i);		
-		float	amplitude = pow(p, i);
-		total 	= 	total	+	interpolated_noise_1d(x * frequency) * amplitude;
-	}
-
-	return total;
-}
-
-inline float
-filters::perlin::interpolated_noise_2d(float x, float y)
-{
-	int		integer_X    = int(x);
-	float	fractional_X = x - integer_X;
-
-	int		integer_Y    = int(y);
-	float	fractional_Y = y - integer_Y;
-
-	float	v1 = smooth_noise2d(integer_X,     integer_Y);
-	float	v2 = smooth_noise2d(integer_X + 1, integer_Y);
-	float	v3 = smooth_noise2d(integer_X,     integer_Y + 1);
-	float	v4 = smooth_noise2d(integer_X + 1, integer_Y + 1);
-
-	float	i1 = cosrp(v1 , v2 , fractional_X);
-	float	i2 = cosrp(v3 , v4 , fractional_X);
-
-	return cosrp(i1 , i2 , fractional_Y);
-}
-
-float
-filters::perlin::perlin_noise_2d(float x, float y, float p)
-{
-	srand(time(NULL));
-	float	total = 0;
-	//float	p	=	1.0 / 1.2;
-	int		n	= 	16;
-
-	for (int i = 0; i < n; ++i)
-	{
-		int		frequency 	= 	pow(2, i);
-		float	amplitude	=	pow(p, i);
-		total	=	total	+	interpolated_noise_2d(x * frequency, y * frequency)	*	amplitude;
-	}
-
-	return total;
-}
-
-ALLEGRO_BITMAP*
-filters::perlin::clouds(unsigned int width, unsigned int height, float p)
-{
-	ALLEGRO_BITMAP*	output	=	al_create_bitmap(width, height);
-	al_set_target_bitmap(output);
-	al_clear_to_color(al_map_rgb(0, 0, 0));
-	al_lock_bitmap(output, al_get_bitmap_format(output), ALLEGRO_LOCK_WRITEONLY);
-
-	srand(time(NULL));
-	unsigned int	seed	=	rand() % 10000000;
-
-	for (unsigned int y = 0; y < height; ++y)
-	{
-		for (unsigned int x = 0; x < width; ++x)
-		{
-			int	val	=	(perlin_noise_2d((float) (x + seed) / width , (float) (y + seed) / height, p) * 127)	+ 127;
-			val	=	std::min(std::max(val, 0), 255);
-			al_put_pixel(x, y, al_map_rgb(val, val, val));
-		}
-	}
-
-	al_unlock_bitmap(output);
-	return output;
-}
-
-ALLEGRO_BITMAP*
-filters::perlin::heightmap(ALLEGRO_BITMAP* source)
-{
-	unsigned int 	img_w	=	al_get_bitmap_width(source);
-	unsigned int	img_h	=	al_get_bitmap_height(source);
-
-	ALLEGRO_BITMAP*	output	=	al_create_bitmap(img_w, img_h);
-
-	ALLEGRO_COLOR	colors[3]	=	{	al_map_rgb(0, 0, 255),
-										al_map_rgb(0, 255, 0),
-										al_map_rgb(255, 0, 0)};
-
-	unsigned char	pxl[3];
-	unsigned char	color[3];
-	unsigned char	hill[3]	=	{0, 255, 0};
-	unsigned char	mntn[3]	=	{255, 0, 0};
-
-	ALLEGRO_COLOR	out_pxl;
-
-	al_set_target_bitmap(output);
-	al_lock_bitmap(source, al_get_bitmap_format(source), ALLEGRO_LOCK_READONLY);
-	al_lock_bitmap(output, al_get_bitmap_format(output), ALLEGRO_LOCK_WRITEONLY);
-
-	for (unsigned int y = 0; y < img_h; ++y)
-	{
-		for (unsigned int x = 0; x < img_w; ++x)
-		{
-			al_unmap_rgb(	al_get_pixel(source, x, y),
-							&pxl[0],
-							&pxl[1],
-							&pxl[2]);
-			
-			unsigned int no_of_color	=	floor(pxl[0] / 256.0 * 3);
-			if (no_of_color > 0)
-			{
-				al_unmap_rgb(	colors[no_of_color],
-								&color[0],
-								&color[1],
-								&color[0]);
-				for (int i = 0; i < 3; ++i)
-				
-					pxl[i]	=	lerp(hill[i], mntn[i], pxl[i] / 256.0);
-				
-				out_pxl	=	al_map_rgb(	pxl[0],
-										pxl[1],
-										pxl[2]);
-			}
-
-			else
-			{
-				out_pxl	=	al_map_rgb(	0,
-										0,
-										255 * (pxl[0] / (256.0 / 3)));
-			}
-
-			al_put_pixel(x, y, out_pxl);
-		}
-	}
-
-	al_unlock_bitmap(source);
-	al_unlock_bitmap(output);
-	return output;
-}
-
-ALLEGRO_BITMAP*
-filters::glitch(ALLEGRO_BITMAP* source, unsigned int power)
-{
-	unsigned int	img_w	=	al_get_bitmap_width(source);
-	unsigned int	img_h	=	al_get_bitmap_height(source);
-
-	unsigned int	rand_source_x	=	0;
-	unsigned int	rand_source_y	=	0;
-
-	unsigned int	rand_output_x	=	0;
-	unsigned int	rand_output_y	=	0;
-
-	unsigned int	rand_matrix_w	=	0;
-	unsigned int	rand_matrix_h	=	0;
-/*
-	unsigned int	line_beg		=	0;
-	unsigned int	line_end		=	0;
-*/
-	unsigned char	pixel[3];
-
-	unsigned int	mode	=	0;
-
-	ALLEGRO_BITMAP*	output	=	al_create_bitmap(img_w, img_h);
-
-	srand(time(NULL));
-
-    std::vector<int> 	v	=	{0, 1, 2};
-	std::random_device 	rd;
-	std::mt19937 		g(rd());
-
-	al_lock_bitmap(source, al_get_bitmap_format(source), ALLEGRO_LOCK_READONLY);
-	al_lock_bitmap(output, al_get_bitmap_format(output), ALLEGRO_LOCK_WRITEONLY);
-	al_set_target_bitmap(output);
-
-	for (unsigned int i = 0; i < img_h; ++i)
-	{
-		for (unsigned int j = 0; j < img_w; ++j)
-		{
-			al_unmap_rgb(	al_get_pixel(	source,
-											j,
-											i),
-							&pixel[0],
-							&pixel[1],
-							&pixel[2]);
-
-			al_set_target_bitmap(output);
-			al_put_pixel(j, i, al_map_rgb(	pixel[0],
-											pixel[1],
-											pixel[2]));
-		}
-	}
-
-	for (unsigned int n = 0; n < power; ++n)
-	{
-		rand_source_x	=	g()	%	img_w;
-		rand_source_y	=	g()	%	img_h;
-
-		rand_output_x	=	g()	%	img_w;
-		rand_output_y	=	g()	%	img_h;
-
-		rand_matrix_w	=	g()	%	img_w / 4;
-		rand_matrix_h	=	g()	%	img_h / 8;
-
-		mode	=	g()	%	100;
-		if (mode<=	33)
-		{
-			for (unsigned int i = 0; i < rand_matrix_h / 2; ++i)
-			{
-				for (unsigned int j = 0; j < rand_matrix_w / 2; ++j)
-				{
-					al_put_pixel(	(rand_output_x	+	g() % rand_matrix_w)	%	img_w,
-									(rand_output_y	+	g()	% rand_matrix_h)	%	img_h,
-									al_map_rgb(	g() %	256,
-												g()	%	256,
-												g()	%	256));
-				}
-			}
-		}
-
-		else if (mode >	33)
-		{
-	    	std::shuffle(v.begin(), v.end(), g);
-		
-			for (unsigned int i = 0; i < rand_matrix_h; ++i)
-			{
-				for (unsigned int j = 0; j < rand_matrix_w; ++j)
-				{
-					al_unmap_rgb(	al_get_pixel(	source,
-													(rand_source_x	+	j)	%	img_w,
-													(rand_source_y	+	i)	%	img_h),
-									&pixel[0],
-									&pixel[1],
-									&pixel[2]);
-
-					
-					al_put_pixel(	(rand_output_x	+	j)	%	img_w,
-									(rand_output_y	+	i)	%	img_h,
-									al_map_rgb(	pixel[v[0]],
-												pixel[v[1]],
-												pixel[v[2]]));				
-				}
-			}
-		}
-	}
-
-	for (unsigned int i = 0; i < img_h; ++i)
-	{
-		if (i & 1)
-		{
-			al_draw_line(0, i, img_w, i, al_map_rgb(0, 0, 0), 1.0);
-			/*
-			line_beg	=	g()	%	img_w;
-			line_end	=	g()	%	(img_w 	/ 2);
-			al_draw_line(line_beg, i, (line_beg + line_end) % img_w, i, al_map_rgb(0, 0, 0), g() % 2);
-			*/
-		}
-	}
-
-	al_unlock_bitmap(source);
-	al_unlock_bitmap(output);
-	return output;
-}
-
-// działa
-ALLEGRO_BITMAP*
-filters::grayscale(ALLEGRO_BITMAP* source)
-{
-	unsigned int		img_w	=	al_get_bitmap_width(source);
-	unsigned int		img_h	=	al_get_bitmap_height(source);
-	ALLEGRO_BITMAP*		output	=	al_create_bitmap(img_w, img_h);
-	al_set_target_bitmap(output);
-	al_clear_to_color(al_map_rgb(0,0,0));
-	unsigned char		r	=	0;
-	unsigned char		g	=	0;
-	unsigned char		b	=	0;
-	unsigned char		avg	=	0;
-
-	for (unsigned int y = 0; y < img_h; ++y)
-	{
-		for (unsigned int x = 0; x < img_w; ++x)
-		{
-			al_set_target_bitmap(source);			
-			al_unmap_rgb(	al_get_pixel(source, x, y),
-							&r,
-							&g,
-							&b
-						);
-			avg	=	(int)((r + g + b) / 3.0);
-			al_set_target_bitmap(output);
-			al_put_pixel(x, y, al_map_rgb(avg, avg, avg));
-		}
-	}
-
-	return output;
-}
-
-// działa
-ALLEGRO_BITMAP*
-filters::black_white(ALLEGRO_BITMAP* source)
-{
-	unsigned int		img_w	=	al_get_bitmap_width(source);
-	unsigned int		img_h	=	al_get_bitmap_height(source);
-	ALLEGRO_BITMAP*		output	=	al_create_bitmap(img_w, img_h);
-	al_set_target_bitmap(output);
-	al_clear_to_color(al_map_rgb(0,0,0));
-	unsigned char		r	=	0;
-	unsigned char		g	=	0;
-	unsigned char		b	=	0;
-	unsigned char		avg	=	0;
-	unsigned char		bw	=	0;
-
-	for (unsigned int y = 0; y < img_h; ++y)
-	{
-		for (unsigned int x = 0; x < img_w; ++x)
-		{
-			al_set_target_bitmap(source);			
-			al_unmap_rgb(	al_get_pixel(source, x, y),
-							&r,
-							&g,
-							&b
-						);
-			avg	=	(int)((r + g + b) / 3.0);
-			bw	=	avg > 127 ? 255 : 0;
-			al_set_target_bitmap(output);
-			al_put_pixel(x, y, al_map_rgb(bw, bw, bw));
-		}
-	}
-
-	return output;
-}
-
-// działa
-ALLEGRO_BITMAP*
-filters::gaussian_blur(ALLEGRO_BITMAP* source, unsigned int n)
-{
-	if (!n) return source;
-	unsigned int		img_w		=	al_get_bitmap_width(source);
-	unsigned int		img_h		=	al_get_bitmap_height(source);
-	const	unsigned int	matrix_w	=	7;
-	const	unsigned int	matrix_h	=	7;
-	int		r	=	0;
-	int		g	=	0;
-	int		b	=	0;
-	ALLEGRO_COLOR		pixels[matrix_h][matrix_w];
-	unsigned char		results[3];
-	unsigned char		tmp_channels[3][matrix_h][matrix_w];
-	ALLEGRO_BITMAP*		output	=	al_create_bitmap(img_w, img_h);
-	al_set_target_bitmap(output);
-	al_clear_to_color(al_map_rgb(0,0,0));
-	int					kernel	=	0;
-
-	int				filter_matrix[matrix_h][matrix_w]	=
-	{ 
-		{0,		0,		0,		5,		0,		0,		0},
-		{0,		5,		18,		32,		18,		5,		0},
-		{0,		18,		64,		100,	64,		18,		0},
-		{5,		32,		100,	100,	100,	32,		5},
-		{0,		18,		64,		100,	64,		18,		0},
-		{0,		5,		18,		32,		18,		5,		0},
-		{0,		0,		0,		5,		0,		0,		0}
-	};
-
-	for (unsigned int y = 0; y < matrix_h; ++y)
-	
-		for (unsigned int x = 0; x < matrix_w; ++x)
-		
-			kernel	+=	filter_matrix[y][x];
-
-	float				factor	=	1.0/kernel;
-	al_lock_bitmap(source, al_get_bitmap_format(source), ALLEGRO_LOCK_READONLY);
-	al_lock_bitmap(output, al_get_bitmap_format(output), ALLEGRO_LOCK_WRITEONLY);
-
-	for (unsigned int i = 0; i < n; ++i)
-	{
-		for (unsigned int y = 0; y < img_h; ++y)
-		{
-			for (unsigned int x = 0; x < img_w; ++x)
-			{
-				al_set_target_bitmap(source);
-				for (unsigned int i = 0; i < matrix_h; ++i)
-				{
-					for (unsigned int j = 0; j < matrix_w; ++j)
-					{
-						pixels[i][j]	=	al_get_pixel(source, (img_w + x + j - (matrix_w / 2)) % img_w, (img_h + y + i - (matrix_h / 2)) % img_h);
-					}
-				}
-				
-				for (unsigned int i = 0; i < matrix_h; ++i)
-				{
-					for (unsigned int j = 0; j < matrix_w; ++j)
-					{
-						al_unmap_rgb(	pixels[i][j],
-										&tmp_channels[0][i][j],
-										&tmp_channels[1][i][j],
-										&tmp_channels[2][i][j]);
-					}
-				}
-
-				for (unsigned int i = 0; i < matrix_h; ++i)
-				{
-					for (unsigned int j = 0; j < matrix_w; ++j)
-					{
-						r	+=	round(tmp_channels[0][i][j]	*	filter_matrix[i][j]);
-						g	+=	round(tmp_channels[1][i][j]	*	filter_matrix[i][j]);
-						b	+=	round(tmp_channels[2][i][j]	*	filter_matrix[i][j]);
-					}
-				}
-
-				results[0]	=	std::min(std::max(int(factor * r), 0), 255);
-				results[1]	=	std::min(std::max(int(factor * g), 0), 255);
-				results[2]	=	std::min(std::max(int(factor * b), 0), 255);
-
-				al_set_target_bitmap(output);
-				al_put_pixel(x, y, al_map_rgb(results[0], results[1], results[2]));
-				r			= 	g			=	b			=	0;
-				results[0]	=	results[1]	=	results[2]	=	0;
-			}
-		}
-		source	=	output;
-	}
-	al_unlock_bitmap(source);
-	al_unlock_bitmap(output);
-	return output;
-}
-
-ALLEGRO_BITMAP*
-filters::gaussian_blur_optimized(ALLEGRO_BITMAP* source, unsigned int n)
-{
-	// TODO
-	// dodać odejmowanie i dodawanie pixeli na krawędzi
-	if (!n) return source;
-	unsigned int		img_w		=	al_get_bitmap_width(source);
-	unsigned int		img_h		=	al_get_bitmap_height(source);
-	const	unsigned int	matrix_w	=	7;
-	const	unsigned int	matrix_h	=	1;
-	int		r	=	0;
-	int		g	=	0;
-	int		b	=	0;
-	ALLEGRO_COLOR		pixels[matrix_h][matrix_w];
-	unsigned char		results[3];
-	unsigned char		tmp_channels[3][matrix_h][matrix_w];
-	ALLEGRO_BITMAP*		output	=	al_create_bitmap(img_w, img_h);
-	al_set_target_bitmap(output);
-	al_clear_to_color(al_map_rgb(0,0,0));
-	int					kernel	=	0;
-/*
-	int				filter_matrix[matrix_h][matrix_w]	=
-	{ 
-		{0,		0,		0,		5,		0,		0,		0},
-		{0,		5,		18,		32,		18,		5,		0},
-		{0,		18,		64,		100,	64,		18,		0},
-		{5,		32,		100,	100,	100,	32,		5},
-		{0,		18,		64,		100,	64,		18,		0},
-		{0,		5,		18,		32,		18,		5,		0},
-		{0,		0,		0,		5,		0,		0,		0}
-	};
-*/
-	int	filter_matrix[matrix_h][matrix_w]	=
-	{
-		{5,		32,		100,	100,	100,	32,		5}		
-	};
-
-	for (unsigned int y = 0; y < matrix_h; ++y)
-	
-		for (unsigned int x = 0; x < matrix_w; ++x)
-		
-			kernel	+=	filter_matrix[y][x];
-
-	float				factor	=	1.0/kernel;
-	al_lock_bitmap(source, al_get_bitmap_format(source), ALLEGRO_LOCK_READONLY);
-	al_lock_bitmap(output, al_get_bitmap_format(output), ALLEGRO_LOCK_WRITEONLY);
-
-	// first pass
-
-	for (unsigned int i = 0; i < n; ++i)
-	{
-		for (unsigned int y = 0; y < img_h; ++y)
-		{
-			for (unsigned int x = 0; x < img_w; ++x)
-			{
-				al_set_target_bitmap(source);
-				for (unsigned int j = 0; j < matrix_w; ++j)
-				{
-					pixels[0][j]	=	al_get_pixel(source, (img_w + x + j - (matrix_w / 2)) % img_w, (img_h + y - (matrix_h / 2)) % img_h);
-				}
-				
-				for (unsigned int j = 0; j < matrix_w; ++j)
-				{
-					al_unmap_rgb(	pixels[0][j],
-									&tmp_channels[0][0][j],
-									&tmp_channels[1][0][j],
-									&tmp_channels[2][0][j]);
-				}
-
-				for (unsigned int i = 0; i < matrix_h; ++i)
-				{
-					for (unsigned int j = 0; j < matrix_w; ++j)
-					{
-						r	+=	round(tmp_channels[0][i][j]	*	filter_matrix[i][j]);
-						g	+=	round(tmp_channels[1][i][j]	*	filter_matrix[i][j]);
-						b	+=	round(tmp_channels[2][i][j]	*	filter_matrix[i][j]);
-					}
-				}
-
-				results[0]	=	std::min(std::max(int(factor * r), 0), 255);
-				results[1]	=	std::min(std::max(int(factor * g), 0), 255);
-				results[2]	=	std::min(std::max(int(factor * b), 0), 255);
-
-				al_set_target_bitmap(output);
-				al_put_pixel(x, y, al_map_rgb(results[0], results[1], results[2]));
-				r			= 	g			=	b			=	0;
-				results[0]	=	results[1]	=	results[2]	=	0;
-			}
-		}
-		source	=	output;
-	}
-
-	for (unsigned int i = 0; i < n; ++i)
-	{
-		for (unsigned int x = 0; x < img_w; ++x)
-		{
-			for (unsigned int y = 0; y < img_h; ++y)
-			{
-				al_set_target_bitmap(source);
-				for (unsigned int i = 0; i < matrix_h; ++i)
-				{
-					for (unsigned int j = 0; j < matrix_w; ++j)
-					{
-						pixels[i][j]	=	al_get_pixel(source, (img_w + x + i - (matrix_h / 2)) % img_w, (img_h + y + j - (matrix_w / 2)) % img_h);
-					}
-				}
-				
-				for (unsigned int i = 0; i < matrix_h; ++i)
-				{
-					for (unsigned int j = 0; j < matrix_w; ++j)
-					{
-						al_unmap_rgb(	pixels[i][j],
-										&tmp_channels[0][i][j],
-										&tmp_channels[1][i][j],
-										&tmp_channels[2][i][j]);
-					}
-				}
-
-				for (unsigned int i = 0; i < matrix_h; ++i)
-				{
-					for (unsigned int j = 0; j < matrix_w; ++j)
-					{
-						r	+=	round(tmp_channels[0][i][j]	*	filter_matrix[i][j]);
-						g	+=	round(tmp_channels[1][i][j]	*	filter_matrix[i][j]);
-						b	+=	round(tmp_channels[2][i][j]	*	filter_matrix[i][j]);
-					}
-				}
-
-				results[0]	=	std::min(std::max(int(factor * r), 0), 255);
-				results[1]	=	std::min(std::max(int(factor * g), 0), 255);
-				results[2]	=	std::min(std::max(int(factor * b), 0), 255);
-
-				al_set_target_bitmap(output);
-				al_put_pixel(x, y, al_map_rgb(results[0], results[1], results[2]));
-				r			= 	g			=	b			=	0;
-				results[0]	=	results[1]	=	results[2]	=	0;
-			}
-		}
-		source	=	output;
-	}
-
-	al_unlock_bitmap(source);
-	al_unlock_bitmap(output);
-	return output;
-}
-
-// działa
-ALLEGRO_BITMAP*
-filters::gaussian_blur_sampling(ALLEGRO_BITMAP* source, unsigned int n, unsigned int samples)
-{
-	if (!n) return source;
-	unsigned int		img_w		=	al_get_bitmap_width(source);
-	unsigned int		img_h		=	al_get_bitmap_height(source);
-	const	unsigned int	matrix_w	=	7;
-	const	unsigned int	matrix_h	=	7;
-	int		r	=	0;
-	int		g	=	0;
-	int		b	=	0;
-	ALLEGRO_COLOR		pixels[matrix_h][matrix_w];
-	unsigned char		results[3];
-	unsigned char		tmp_channels[3][matrix_h][matrix_w];
-	ALLEGRO_BITMAP*		output	=	al_create_bitmap(img_w, img_h);
-	al_set_target_bitmap(output);
-	al_clear_to_color(al_map_rgb(0,0,0));
-	int					kernel	=	0;
-	float				factor	=	0;
-	int					filter_matrix[matrix_h][matrix_w]	=
-	{ 
-		{0,		0,		0,		5,		0,		0,		0},
-		{0,		5,		18,		32,		18,		5,		0},
-		{0,		18,		64,		100,	64,		18,		0},
-		{5,		32,		100,	100,	100,	32,		5},
-		{0,		18,		64,		100,	64,		18,		0},
-		{0,		5,		18,		32,		18,		5,		0},
-		{0,		0,		0,		5,		0,		0,		0}
-	};
-
-	al_lock_bitmap(source, al_get_bitmap_format(source), ALLEGRO_LOCK_READONLY);
-	al_lock_bitmap(output, al_get_bitmap_format(output), ALLEGRO_LOCK_WRITEONLY);
-
-	for (unsigned int i = 0; i < n; ++i)
-	{
-		for (unsigned int y = 0; y < img_h; ++y)
-		{
-			for (unsigned int x = 0; x < img_w; ++x)
-			{
-				al_set_target_bitmap(source);
-				for (unsigned int i = 0; i < matrix_h; ++i)
-				{
-					for (unsigned int j = 0; j < matrix_w; ++j)
-					{
-						pixels[i][j]	=	al_get_pixel(source, (img_w + x + j - (matrix_w / 2)) % img_w, (img_h + y + i - (matrix_h / 2)) % img_h);
-					}
-				}
-				
-				for (unsigned int i = 0; i < matrix_h; ++i)
-				{
-					for (unsigned int j = 0; j < matrix_w; ++j)
-					{
-						al_unmap_rgb(	pixels[i][j],
-										&tmp_channels[0][i][j],
-										&tmp_channels[1][i][j],
-										&tmp_channels[2][i][j]);
-					}
-				}
-
-
-				for (unsigned int i = 0; i < samples; ++i)
-				{
-					int	sample	=	rand()	%	(matrix_h * matrix_w);
-					int	x		=	sample % matrix_w;
-					int	y		=	(int)((float)sample / matrix_h);
-					r	+=	tmp_channels[0][y][x]	*	filter_matrix[y][x];
-					g	+=	tmp_channels[1][y][x]	*	filter_matrix[y][x];
-					b	+=	tmp_channels[2][y][x]	*	filter_matrix[y][x];
-					kernel	+=	filter_matrix[y][x];
-				}
-
-				factor	=	1.0	/	kernel;
-				results[0]	=	std::min(std::max(int(factor * r), 0), 255);
-				results[1]	=	std::min(std::max(int(factor * g), 0), 255);
-				results[2]	=	std::min(std::max(int(factor * b), 0), 255);
-				kernel	=	0;
-				al_set_target_bitmap(output);
-				al_put_pixel(x, y, al_map_rgb(results[0], results[1], results[2]));
-				r			= 	g			=	b			=	0;
-				results[0]	=	results[1]	=	results[2]	=	0;
-			}
-		}
-		source	=	output;
-	}
-	al_unlock_bitmap(source);
-	al_unlock_bitmap(output);
-	return output;
-}
-
-// działa
-ALLEGRO_BITMAP*
-filters::box_blur(ALLEGRO_BITMAP* source, unsigned int n)
-{
-	if (!n) return source;
-	unsigned int		img_w		=	al_get_bitmap_width(source);
-	unsigned int		img_h		=	al_get_bitmap_height(source);
-	const	unsigned int	matrix_w	=	3;
-	const	unsigned int	matrix_h	=	3;
-	int		r	=	0;
-	int		g	=	0;
-	int		b	=	0;
-	ALLEGRO_COLOR		pixels[matrix_h][matrix_w];
-	unsigned char		results[3];
-	unsigned char		tmp_channels[3][matrix_h][matrix_w];
-	ALLEGRO_BITMAP*		output	=	al_create_bitmap(img_w, img_h);
-	al_set_target_bitmap(output);
-	al_clear_to_color(al_map_rgb(0,0,0));
-	int					kernel	=	0;
-	int					filter_matrix[matrix_h][matrix_w]	=
-	{ 
-		{1,	1,	1},
-		{1,	1,	1},
-		{1,	1,	1}
-	};
-
-	for (unsigned int i = 0; i < matrix_h; ++i)
-	{
-		for (unsigned int j = 0; j < matrix_w; ++j)
-		{
-			kernel	+=	filter_matrix[i][j];
-		}
-	}
-
-	float				factor	=	1.0/kernel;
-
-	al_lock_bitmap(source, al_get_bitmap_format(source), ALLEGRO_LOCK_READONLY);
-	al_lock_bitmap(output, al_get_bitmap_format(output), ALLEGRO_LOCK_WRITEONLY);
-
-	for (unsigned int i = 0; i < n; ++i)
-	{
-		for (unsigned int y = 0; y < img_h; ++y)
-		{
-			for (unsigned int x = 0; x < img_w; ++x)
-			{
-				al_set_target_bitmap(source);
-				for (unsigned int i = 0; i < matrix_h; ++i)
-				{
-					for (unsigned int j = 0; j < matrix_w; ++j)
-					{
-						pixels[i][j]	=	al_get_pixel(source, (img_w + x + j - (matrix_w / 2)) % img_w, (img_h + y + i - (matrix_h / 2)) % img_h);
-					}
-				}
-				
-				for (unsigned int i = 0; i < matrix_h; ++i)
-				{
-					for (unsigned int j = 0; j < matrix_w; ++j)
-					{
-						al_unmap_rgb(	pixels[i][j],
-										&tmp_channels[0][i][j],
-										&tmp_channels[1][i][j],
-										&tmp_channels[2][i][j]);
-					}
-				}
-
-				for (unsigned int i = 0; i < matrix_h; ++i)
-				{
-					for (unsigned int j = 0; j < matrix_w; ++j)
-					{
-						r	+=	round(tmp_channels[0][i][j]	*	filter_matrix[i][j]);
-						g	+=	round(tmp_channels[1][i][j]	*	filter_matrix[i][j]);
-						b	+=	round(tmp_channels[2][i][j]	*	filter_matrix[i][j]);
-					}
-				}
-
-				results[0]	=	std::min(std::max(int(factor * r), 0), 255);
-				results[1]	=	std::min(std::max(int(factor * g), 0), 255);
-				results[2]	=	std::min(std::max(int(factor * b), 0), 255);
-
-				al_set_target_bitmap(output);
-				al_put_pixel(x, y, al_map_rgb(results[0], results[1], results[2]));
-				r			= 	g			=	b			=	0;
-				results[0]	=	results[1]	=	results[2]	=	0;
-			}
-		}
-		source	=	output;
-	}
-	al_unlock_bitmap(source);
-	al_unlock_bitmap(output);
-	return output;
-}
-
-// działa
-ALLEGRO_BITMAP*
-filters::box_blur_sampling(ALLEGRO_BITMAP* source, unsigned int n, unsigned int samples)
-{
-	if (!n) return source;
-	unsigned int		img_w		=	al_get_bitmap_width(source);
-	unsigned int		img_h		=	al_get_bitmap_height(source);
-	const	unsigned int	matrix_w	=	3;
-	const	unsigned int	matrix_h	=	3;
-	int		r	=	0;
-	int		g	=	0;
-	int		b	=	0;
-	ALLEGRO_COLOR		pixels[matrix_h][matrix_w];
-	unsigned char		results[3];
-	unsigned char		tmp_channels[3][matrix_h][matrix_w];
-	ALLEGRO_BITMAP*		output	=	al_create_bitmap(img_w, img_h);
-	int					kernel	=	0;
-	float				factor	=	0.0;
-	int					filter_matrix[matrix_h][matrix_w]	=
-	{ 
-		{1,	1,	1},
-		{1,	1,	1},
-		{1,	1,	1}
-	};
-
-	al_set_target_bitmap(output);
-	al_clear_to_color(al_map_rgb(0,0,0));
-
-	al_lock_bitmap(source, al_get_bitmap_format(source), ALLEGRO_LOCK_READONLY);
-	al_lock_bitmap(output, al_get_bitmap_format(output), ALLEGRO_LOCK_WRITEONLY);
-
-	for (unsigned int i = 0; i < n; ++i)
-	{
-		for (unsigned int y = 0; y < img_h; ++y)
-		{
-			for (unsigned int x = 0; x < img_w; ++x)
-			{
-				al_set_target_bitmap(source);
-
-				for (unsigned int i = 0; i < matrix_h; ++i)
-				{
-					for (unsigned int j = 0; j < matrix_w; ++j)
-					{
-						pixels[i][j]	=	al_get_pixel(source, (img_w + x + j - (matrix_w / 2)) % img_w, (img_h + y + i - (matrix_h / 2)) % img_h);
-					}
-				}
-				
-				for (unsigned int i = 0; i < matrix_h; ++i)
-				{
-					for (unsigned int j = 0; j < matrix_w; ++j)
-					{
-						al_unmap_rgb(	pixels[i][j],
-										&tmp_channels[0][i][j],
-										&tmp_channels[1][i][j],
-										&tmp_channels[2][i][j]);
-					}
-				}
-
-				for (unsigned int i = 0; i < samples; ++i)
-				{
-					int	sample	=	rand()	%	(matrix_h * matrix_w);
-					int	x		=	sample % matrix_w;
-					int	y		=	(int)((float)sample / matrix_h);
-					r	+=	tmp_channels[0][y][x]	*	filter_matrix[y][x];
-					g	+=	tmp_channels[1][y][x]	*	filter_matrix[y][x];
-					b	+=	tmp_channels[2][y][x]	*	filter_matrix[y][x];
-					kernel	+=	filter_matrix[y][x];
-				}
-				factor	=	1.0 / kernel;
-				results[0]	=	std::min(std::max((int) (r	*	factor), 0), 255);
-				results[1]	=	std::min(std::max((int) (g	*	factor), 0), 255);
-				results[2]	=	std::min(std::max((int) (b	*	factor), 0), 255);
-				al_set_target_bitmap(output);
-				al_put_pixel(x, y, al_map_rgb(results[0], results[1], results[2]));
-				r			= 	g			=	b			=	0;
-				results[0]	=	results[1]	=	results[2]	=	0;
-				kernel	=	0;
-			}
-		}
-		source	=	output;
-	}
-	al_unlock_bitmap(source);
-	al_unlock_bitmap(output);
-	return output;
-}
-
-ALLEGRO_BITMAP*
-filters::alpha_blending(ALLEGRO_BITMAP* background, ALLEGRO_BITMAP* foreground, ALLEGRO_BITMAP* mask)
-{
-	int	bg_w	=	al_get_bitmap_width(background);
-	int	bg_h	=	al_get_bitmap_height(background);
-	if (bg_w	!=	al_get_bitmap_width(foreground)	||
-		bg_h	!=	al_get_bitmap_height(foreground))
-		return	nullptr;
-
-	ALLEGRO_BITMAP*	output	=	al_create_bitmap(bg_w, bg_h);
-
-	unsigned char	bg_r	=	0;
-	unsigned char	bg_g	=	0;
-	unsigned char	bg_b	=	0;
-	unsigned char	fg_r	=	0;
-	unsigned char	fg_g	=	0;
-	unsigned char	fg_b	=	0;
-	unsigned char	alpha	=	0;
-	unsigned char	results[3];
-	float	alpha_val	=	0;
-
-	ALLEGRO_COLOR	bg_pixel;
-	ALLEGRO_COLOR	fg_pixel;
-	ALLEGRO_COLOR	mask_pixel;
-
-	al_lock_bitmap(background, al_get_bitmap_format(background), ALLEGRO_LOCK_READONLY);
-	al_lock_bitmap(foreground, al_get_bitmap_format(foreground), ALLEGRO_LOCK_READONLY);
-	al_lock_bitmap(mask, al_get_bitmap_format(mask), ALLEGRO_LOCK_READONLY);
-	al_lock_bitmap(output, al_get_bitmap_format(output), ALLEGRO_LOCK_WRITEONLY);
-
-	for (unsigned int y = 0; y < (unsigned int) bg_h; ++y)
-	{
-		for (unsigned int x = 0; x < (unsigned int) bg_w; ++x)
-		{
-			bg_pixel	=	al_get_pixel(background, x, y);
-			fg_pixel	=	al_get_pixel(foreground, x, y);
-			mask_pixel	=	al_get_pixel(mask, x, y);
-			al_unmap_rgb(	bg_pixel,
-							&bg_r,
-							&bg_g,
-							&bg_b);
-			al_unmap_rgb(	fg_pixel,
-							&fg_r,
-							&fg_g,
-							&fg_b);
-			al_unmap_rgb(	mask_pixel,
-							&alpha,
-							&alpha,
-							&alpha
-						);
-			alpha_val	=	(float) alpha / 255;
-			results[0]	=	std::min(std::max(int((bg_r * (1.0 - alpha_val))	+	(fg_r * alpha_val)), 0), 255);
-			results[1]	=	std::min(std::max(int((bg_g * (1.0 - alpha_val))	+	(fg_g * alpha_val)), 0), 255);
-			results[2]	=	std::min(std::max(int((bg_b * (1.0 - alpha_val))	+	(fg_b * alpha_val)), 0), 255);
-
-			al_set_target_bitmap(output);
-			al_put_pixel(x, y, al_map_rgb(	results[0],
-											results[1],
-											results[2]));
-		}
-	}
-
-	al_unlock_bitmap(output);
-	al_unlock_bitmap(foreground);
-	al_unlock_bitmap(background);
-	al_unlock_bitmap(mask);
-	return output;
-}
-
-// działa
-ALLEGRO_BITMAP*
-filters::alpha_blending(ALLEGRO_BITMAP* background, ALLEGRO_BITMAP* foreground, float alpha)
-{
-	int	bg_w	=	al_get_bitmap_width(background);
-	int	bg_h	=	al_get_bitmap_height(background);
-	if (bg_w	!=	al_get_bitmap_width(foreground)	||
-		bg_h	!=	al_get_bitmap_height(foreground))
-		return	nullptr;
-
-	ALLEGRO_BITMAP*	output	=	al_create_bitmap(bg_w, bg_h);
-	if (alpha	==	1.0)
-	{
-		output	=	foreground;
-		return	output;
-	}
-	if (alpha	==	0.0)
-	{
-		output	=	background;
-		return	output;
-	}	
-
-	unsigned char	bg_r	=	0;
-	unsigned char	bg_g	=	0;
-	unsigned char	bg_b	=	0;
-	unsigned char	fg_r	=	0;
-	unsigned char	fg_g	=	0;
-	unsigned char	fg_b	=	0;
-	unsigned char	results[3];
-
-	ALLEGRO_COLOR	bg_pixel;
-	ALLEGRO_COLOR	fg_pixel;
-
-	al_lock_bitmap(background, al_get_bitmap_format(background), ALLEGRO_LOCK_READONLY);
-	al_lock_bitmap(foreground, al_get_bitmap_format(foreground), ALLEGRO_LOCK_READONLY);
-	al_lock_bitmap(output, al_get_bitmap_format(output), ALLEGRO_LOCK_WRITEONLY);
-
-	for (unsigned int y = 0; y < (unsigned int) bg_h; ++y)
-	{
-		for (unsigned int x = 0; x < (unsigned int) bg_w; ++x)
-		{
-			bg_pixel	=	al_get_pixel(background, x, y);
-			fg_pixel	=	al_get_pixel(foreground, x, y);
-			al_unmap_rgb(	bg_pixel,
-							&bg_r,
-							&bg_g,
-							&bg_b);
-			al_unmap_rgb(	fg_pixel,
-							&fg_r,
-							&fg_g,
-							&fg_b);
-
-			results[0]	=	std::min(std::max(int((bg_r * (1.0 - alpha))	+	(fg_r * alpha)), 0), 255);
-			results[1]	=	std::min(std::max(int((bg_g * (1.0 - alpha))	+	(fg_g * alpha)), 0), 255);
-			results[2]	=	std::min(std::max(int((bg_b * (1.0 - alpha))	+	(fg_b * alpha)), 0), 255);
-
-			al_set_target_bitmap(output);
-			al_put_pixel(x, y, al_map_rgb(	results[0],
-											results[1],
-											results[2]));
-		}
-	}
-
-	al_unlock_bitmap(output);
-	al_unlock_bitmap(foreground);
-	al_unlock_bitmap(background);
-	return output;
-}
-
-//działa
-ALLEGRO_BITMAP*
-filters::detect_edges(ALLEGRO_BITMAP* source)
-{
-	unsigned int		img_w		=	al_get_bitmap_width(source);
-	unsigned int		img_h		=	al_get_bitmap_height(source);
-	const	unsigned int	matrix_w	=	5;
-	const	unsigned int	matrix_h	=	5;
-	int		r	=	0;
-	int		g	=	0;
-	int		b	=	0;
-	ALLEGRO_COLOR		pixels[matrix_h][matrix_w];
-	unsigned char		results[3];
-	unsigned char		tmp_channels[3][matrix_h][matrix_w];
-	ALLEGRO_BITMAP*		output	=	al_create_bitmap(img_w, img_h);
-	al_set_target_bitmap(output);
-	al_clear_to_color(al_map_rgb(0,0,0));
-	float				factor	=	1.0/1.0;
-	int				filter_matrix[matrix_h][matrix_w]	=
-	{ 
-		{0,	0,	-1,	0,	0},
-		{0, 0,	-1,	0,	0},
-		{0, 0,	2,	0,	0},
-		{0, 0,	0,	0,	0},
-		{0, 0,	0,	0,	0}
-	};
-
-	for (unsigned int y = 0; y < img_h; ++y)
-	{
-		for (unsigned int x = 0; x < img_w; ++x)
-		{
-			for (unsigned int i = 0; i < matrix_h; ++i)
-			{
-				for (unsigned int j = 0; j < matrix_w; ++j)
-				{
-					pixels[i][j]	=	al_get_pixel(source, (img_w + x + j - 1) % img_w, (img_h + y + i - 1) % img_h);
-				}
-			}
-			
-			for (unsigned int i = 0; i < matrix_h; ++i)
-			{
-				for (unsigned int j = 0; j < matrix_w; ++j)
-				{
-					al_unmap_rgb(	pixels[i][j],
-									&tmp_channels[0][i][j],
-									&tmp_channels[1][i][j],
-									&tmp_channels[2][i][j]);
-				}
-			}
-
-			for (unsigned int i = 0; i < matrix_h; ++i)
-			{
-				for (unsigned int j = 0; j < matrix_w; ++j)
-				{
-					r	+=	round(tmp_channels[0][i][j]	*	filter_matrix[i][j]);
-					g	+=	round(tmp_channels[1][i][j]	*	filter_matrix[i][j]);
-					b	+=	round(tmp_channels[2][i][j]	*	filter_matrix[i][j]);
-				}
-			}
-
-			results[0]	=	std::min(std::max(int(factor * r), 0), 255);
-			results[1]	=	std::min(std::max(int(factor * g), 0), 255);
-			results[2]	=	std::min(std::max(int(factor * b), 0), 255);
-
-			al_put_pixel(x, y, al_map_rgb(results[0], results[1], results[2]));
-			r			= 	g			=	b			=	0;
-			results[0]	=	results[1]	=	results[2]	=	0;
-		}
-	}
-	
-	return output;
-}
-
-//działa
-ALLEGRO_BITMAP*
-filters::sharpen(ALLEGRO_BITMAP* source)
-{
-	unsigned int		img_w		=	al_get_bitmap_width(source);
-	unsigned int		img_h		=	al_get_bitmap_height(source);
-	const	unsigned int	matrix_w	=	3;
-	const	unsigned int	matrix_h	=	3;
-	int		r	=	0;
-	int		g	=	0;
-	int		b	=	0;
-	ALLEGRO_COLOR		pixels[matrix_h][matrix_w];
-	unsigned char		results[3];
-	unsigned char		tmp_channels[3][matrix_h][matrix_w];
-	ALLEGRO_BITMAP*		output	=	al_create_bitmap(img_w, img_h);
-	al_set_target_bitmap(output);
-	al_clear_to_color(al_map_rgb(0,0,0));
-	float				factor	=	1.0/1.0;
-	int				filter_matrix[matrix_h][matrix_w]	=
-	{ 
-		{0, -1, 0},
-		{-1, 5, -1},
-		{0, -1, 0}
-	};
-
-	for (unsigned int y = 0; y < img_h; ++y)
-	{
-		for (unsigned int x = 0; x < img_w; ++x)
-		{
-			for (unsigned int i = 0; i < matrix_h; ++i)
-			{
-				for (unsigned int j = 0; j < matrix_w; ++j)
-				{
-					pixels[i][j]	=	al_get_pixel(source, (img_w + x + j - 1) % img_w, (img_h + y + i - 1) % img_h);
-				}
-			}
-			
-			for (unsigned int i = 0; i < matrix_h; ++i)
-			{
-				for (unsigned int j = 0; j < matrix_w; ++j)
-				{
-					al_unmap_rgb(	pixels[i][j],
-									&tmp_channels[0][i][j],
-									&tmp_channels[1][i][j],
-									&tmp_channels[2][i][j]);
-				}
-			}
-
-			for (unsigned int i = 0; i < matrix_h; ++i)
-			{
-				for (unsigned int j = 0; j < matrix_w; ++j)
-				{
-					r	+=	round(tmp_channels[0][i][j]	*	filter_matrix[i][j]);
-					g	+=	round(tmp_channels[1][i][j]	*	filter_matrix[i][j]);
-					b	+=	round(tmp_channels[2][i][j]	*	filter_matrix[i][j]);
-				}
-			}
-
-			results[0]	=	std::min(std::max(int(factor * r), 0), 255);
-			results[1]	=	std::min(std::max(int(factor * g), 0), 255);
-			results[2]	=	std::min(std::max(int(factor * b), 0), 255);
-
-			al_put_pixel(x, y, al_map_rgb(results[0], results[1], results[2]));
-			r			= 	g			=	b			=	0;
-			results[0]	=	results[1]	=	results[2]	=	0;
-		}
-	}
-	
-	return output;
-}
-
-ALLEGRO_BITMAP*
-filters::tint(ALLEGRO_BITMAP* source)
-{
-	unsigned int		img_w	=	al_get_bitmap_width(source);
-	unsigned int		img_h	=	al_get_bitmap_height(source);
-	ALLEGRO_BITMAP*		output	=	al_create_bitmap(img_w, img_h);
-	al_set_target_bitmap(output);
-	al_clear_to_color(al_map_rgb(0,0,0));
-	unsigned char		r	=	0;
-	unsigned char		g	=	0;
-	unsigned char		b	=	0;
-
-	for (unsigned int y = 0; y < img_h; ++y)
-	{
-		for (unsigned int x = 0; x < img_w; ++x)
-		{
-			al_set_target_bitmap(source);			
-			al_unmap_rgb(	al_get_pixel(source, x, y),
-							&r,
-							&g,
-							&b
-						);
-
-			al_set_target_bitmap(output);
-			al_put_pixel(x, y, al_map_rgb(b, r, g));
-		}
-	}
-
-	return output;
-}
-
-// działa
-ALLEGRO_BITMAP*
-filters::lighten(ALLEGRO_BITMAP* source, int n)
-{
-	if (!n)	return source;
-	unsigned int					img_w	=	al_get_bitmap_width(source);
-	unsigned int					img_h	=	al_get_bitmap_height(source);
-	ALLEGRO_BITMAP*		output	=	al_create_bitmap(img_w, img_h);
-	al_set_target_bitmap(output);
-	al_clear_to_color(al_map_rgb(0,0,0));
-	unsigned char		r	=	0;
-	unsigned char		g	=	0;
-	unsigned char		b	=	0;
-
-	for (unsigned int y = 0; y < img_h; ++y)
-	{
-		for (unsigned int x = 0; x < img_w; ++x)
-		{
-			al_set_target_bitmap(source);			
-			al_unmap_rgb(	al_get_pixel(source, x, y),
-							&r,
-							&g,
-							&b
-						);
-			if (n > 0)
-			{
-				r	=	(r + n) <= 255 ? (r + n) : 255;
-				g	=	(g + n) <= 255 ? (g + n) : 255;
-				b	=	(b + n) <= 255 ? (b + n) : 255;				
-			}
-
-			else
-			{
-				r	=	(r + n) >= 0 ? (r + n) : 0;
-				g	=	(g + n) >= 0 ? (g + n) : 0;
-				b	=	(b + n) >= 0 ? (b + n) : 0;				
-			}
-
-
-			al_set_target_bitmap(output);
-			al_put_pixel(x, y, al_map_rgb(r, g, b));
-		}
-	}
-
-	return output;
-}
-
-// działa
-ALLEGRO_BITMAP*
-filters::contrast(ALLEGRO_BITMAP* source, float n)
-{
-	if (n == 1.0)	return source;
-	unsigned int		img_w	=	al_get_bitmap_width(source);
-	unsigned int		img_h	=	al_get_bitmap_height(source);
-	ALLEGRO_BITMAP*		output	=	al_create_bitmap(img_w, img_h);
-	al_set_target_bitmap(output);
-	al_clear_to_color(al_map_rgb(0,0,0));
-	unsigned char		r	=	0;
-	unsigned char		g	=	0;
-	unsigned char		b	=	0;
-
-	for (unsigned int y = 0; y < img_h; ++y)
-	{
-		for (unsigned int x = 0; x < img_w; ++x)
-		{
-			al_set_target_bitmap(source);			
-			al_unmap_rgb(	al_get_pixel(source, x, y),
-							&r,
-							&g,
-							&b
-						);
-					
-			r	=	(r * n) <= 255 ? (int) (r * n) : 255;
-			g	=	(g * n) <= 255 ? (int) (g * n) : 255;
-			b	=	(b * n) <= 255 ? (int) (b * n) : 255;
-
-			al_set_target_bitmap(output);
-			al_put_pixel(x, y, al_map_rgb(r, g, b));
-		}
-	}
-
-	return output;
-}
-
-// działa
-ALLEGRO_BITMAP*
-filters::gradient(unsigned int width, unsigned int height, ALLEGRO_COLOR from, ALLEGRO_COLOR to)
-{
-	ALLEGRO_BITMAP*	output	=	al_create_bitmap(width, height);
-	unsigned char	from_pxl[3];
-	unsigned char	to_pxl[3];
-
-	al_set_target_bitmap(output);
-
-	al_unmap_rgb(	from,
-					&from_pxl[0],
-					&from_pxl[1],
-					&from_pxl[2]
-				);
-
-	al_unmap_rgb(	to,
-					&to_pxl[0],
-					&to_pxl[1],
-					&to_pxl[2]
-				);
-
-	for (unsigned int y = 0; y < height; ++y)
-	{
-		for (unsigned int x = 0; x < width; ++x)
-		{
-
-			al_put_pixel(x, y,
-							al_map_rgb(	(int) lerp(from_pxl[0], to_pxl[0], x / (float) width),
-										(int) lerp(from_pxl[1], to_pxl[1], x / (float) width),
-										(int) lerp(from_pxl[2], to_pxl[2], x / (float) width)
-										)
-						);
-		}
-	}
-
-	return output;
-}
-
-ALLEGRO_BITMAP*
-filters::file_to_img(std::string filename, unsigned int width)
-{
-	std::ifstream	file(filename, std::ios::binary | std::ios::in);
-	if (!file)	std::cout	<<	"error"	<<	std::endl;
-	char	r;
-	char	g;
-	char	b;
-	file.seekg(0, std::ios::end);
-	unsigned int	size	=	file.tellg();
-	file.seekg(0, std::ios::beg);
-	unsigned int	height	=	size / width / 3;
-	ALLEGRO_BITMAP*	output	=	al_create_bitmap(width, height);
-	al_lock_bitmap(output, al_get_bitmap_format(output), ALLEGRO_LOCK_WRITEONLY);
-	al_set_target_bitmap(output);
-	for (unsigned int i = 0; i	<	size; ++i)
-	{
-		file.read(&r, sizeof(r));
-		file.read(&g, sizeof(g));
-		file.read(&b, sizeof(b));
-		al_put_pixel(i % width, i / width, al_map_rgb(r, g, b));
-	}
-	al_unlock_bitmap(output);
-	return output;
-}
-
-void
-fractals::draw_circle(int x, int y, float radius, ALLEGRO_BITMAP* background)
-{
-	al_draw_circle(x, y, radius, al_map_rgb(255, 255, 255), 1);
-
-	if (radius > 8)
-	{
-		draw_circle(x + radius / 2, y, radius / 2, background);
-    	draw_circle(x - radius / 2, y, radius / 2, background);
-    	draw_circle(x, y + radius / 2, radius / 2, background);
-    	draw_circle(x, y - radius / 2, radius / 2, background);
-	}
-}
-
-void
-fractals::draw_line(int x, int y, float length, ALLEGRO_BITMAP* background)
-{
-	if (length >= 1)
-	{
-		al_set_target_bitmap(background);
-		al_draw_line(x, y, x + length, y, al_map_rgb(255, 255, 255), 1);
-		y	+=	20;
-		draw_line(x, y, length / 3, background);
-		draw_line(x + length * 2.0 / 3.0, y, length / 3, background);		
-	}
-}
+#include "filters.hpp"
+
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <functional>
+#include "raster.hpp"
+#include "gray.hpp"
+#include "parallel.hpp"
+#include "cpu.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef FILTERS_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	using filters::raster::image;
+	using filters::raster::border_coord;
+
+	/*
+	 *	Single weight of convolution matrix, relative to filtered pixel.
+	 *	Zero weights are never stored.
+	 */
+	struct tap
+	{
+		int	dx;
+		int	dy;
+		int	weight;
+	};
+
+	/*
+	 *	One convolution pass: non-zero taps, their extent around filtered
+	 *	pixel and normalising factor.
+	 */
+	struct kernel
+	{
+		std::vector<tap>	taps;
+		int					left;
+		int					top;
+		int					right;
+		int					bottom;
+		float				factor;
+	};
+
+	kernel
+	make_kernel(const int* matrix, int matrix_w, int matrix_h, int anchor_x, int anchor_y, float factor)
+	{
+		kernel	k;
+		k.left	=	k.top	=	k.right	=	k.bottom	=	0;
+		k.factor	=	factor;
+
+		for (int i = 0; i < matrix_h; ++i)
+		{
+			for (int j = 0; j < matrix_w; ++j)
+			{
+				int	weight	=	matrix[i * matrix_w + j];
+				if (!weight)	continue;
+
+				tap	t	=	{j - anchor_x, i - anchor_y, weight};
+				k.taps.push_back(t);
+				k.left		=	std::max(k.left, -t.dx);
+				k.right		=	std::max(k.right, t.dx);
+				k.top		=	std::max(k.top, -t.dy);
+				k.bottom	=	std::max(k.bottom, t.dy);
+			}
+		}
+
+		return k;
+	}
+
+	float
+	normalising_factor(const int* matrix, int matrix_w, int matrix_h)
+	{
+		int	sum	=	0;
+		for (int i = 0; i < matrix_w * matrix_h; ++i)
+			sum	+=	matrix[i];
+		return	sum ? 1.0 / sum : 1.0;
+	}
+
+	/*
+	 *	Where filtered buffer lies in the image: position of its pixel (0, 0)
+	 *	and size of the whole image. For whole image filtering it's {0, 0, w, h}.
+	 */
+	struct frame
+	{
+		int	x;
+		int	y;
+		int	image_w;
+		int	image_h;
+	};
+
+	/*
+	 *	border_pixel for one axis: index of window coordinate c into window
+	 *	of src_n pixels starting at origin, or -1 for BORDER_CONSTANT.
+	 *	Border handling is separable, so filters resolve it once per row
+	 *	and column instead of once per tap.
+	 */
+	inline int
+	window_coord(int c, int origin, int image_n, int src_n, filters::border_mode mode)
+	{
+		if (mode == filters::BORDER_WRAP)
+			return	border_coord(c, src_n, mode);
+		c	=	border_coord(origin + c, image_n, mode);
+		return	c < 0 ? -1 : std::min(std::max(c - origin, 0), src_n - 1);
+	}
+
+	/*
+	 *	Reads pixel (x, y) of src, coordinates may lie outside of src.
+	 *	Coordinates outside of the image follow border mode. Coordinates
+	 *	inside the image but outside of src (src is a window with halo)
+	 *	are clamped to src - they only feed halo pixels, which are never
+	 *	written out. For BORDER_WRAP window coordinates are virtual, window
+	 *	was loaded with wrapped pixels already.
+	 */
+	inline const unsigned char*
+	border_pixel(const image& src, const frame& f, int x, int y, const filters::border& edge)
+	{
+		if (edge.mode == filters::BORDER_WRAP)
+		{
+			x	=	border_coord(x, src.width, edge.mode);
+			y	=	border_coord(y, src.height, edge.mode);
+			return	filters::raster::pixel(src, x, y);
+		}
+
+		x	=	border_coord(f.x + x, f.image_w, edge.mode);
+		y	=	border_coord(f.y + y, f.image_h, edge.mode);
+		if (x < 0 || y < 0)	return edge.color;
+
+		x	=	std::min(std::max(x - f.x, 0), src.width - 1);
+		y	=	std::min(std::max(y - f.y, 0), src.height - 1);
+		return	filters::raster::pixel(src, x, y);
+	}
+
+	inline void
+	store(unsigned char* out, int r, int g, int b, float factor)
+	{
+		out[0]	=	std::min(std::max(int(factor * r), 0), 255);
+		out[1]	=	std::min(std::max(int(factor * g), 0), 255);
+		out[2]	=	std::min(std::max(int(factor * b), 0), 255);
+		out[3]	=	255;
+	}
+
+	/*
+	 *	Convolves src into dst (same size, different memory).
+	 *	Pixels whose whole neighbourhood lies inside the image are computed
+	 *	with precomputed memory offsets and no bounds logic at all; only
+	 *	the frame of kernel extent width goes through border_pixel.
+	 */
+	void
+	convolve(const image& src, const image& dst, const frame& f, const kernel& k, const filters::border& edge)
+	{
+		const int			img_w	=	src.width;
+		const int			img_h	=	src.height;
+		const std::size_t	n_taps	=	k.taps.size();
+
+		std::vector<std::ptrdiff_t>	offsets(n_taps);
+		std::vector<int>			weights(n_taps);
+		for (std::size_t t = 0; t < n_taps; ++t)
+		{
+			offsets[t]	=	(std::ptrdiff_t) k.taps[t].dy * src.pitch	+	k.taps[t].dx * 4;
+			weights[t]	=	k.taps[t].weight;
+		}
+
+		auto	slow	=	[&](int x, int y)
+		{
+			int	r	=	0;
+			int	g	=	0;
+			int	b	=	0;
+			for (std::size_t t = 0; t < n_taps; ++t)
+			{
+				const unsigned char*	p	=	border_pixel(src, f, x + k.taps[t].dx, y + k.taps[t].dy, edge);
+				r	+=	p[0]	*	weights[t];
+				g	+=	p[1]	*	weights[t];
+				b	+=	p[2]	*	weights[t];
+			}
+			store(filters::raster::pixel(dst, x, y), r, g, b, k.factor);
+		};
+
+		const int	x_beg	=	std::min(k.left, img_w);
+		const int	x_end	=	std::max(img_w - k.right, x_beg);
+
+		filters::parallel::for_bands(img_h, [&](int, int begin, int end)
+		{
+			for (int y = begin; y < end; ++y)
+			{
+				if (y < k.top || y >= img_h - k.bottom)
+				{
+					for (int x = 0; x < img_w; ++x)
+						slow(x, y);
+					continue;
+				}
+
+				for (int x = 0; x < x_beg; ++x)
+					slow(x, y);
+
+				const unsigned char*	in	=	filters::raster::pixel(src, x_beg, y);
+				unsigned char*			out	=	filters::raster::pixel(dst, x_beg, y);
+				for (int x = x_beg; x < x_end; ++x, in += 4, out += 4)
+				{
+					int	r	=	0;
+					int	g	=	0;
+					int	b	=	0;
+					for (std::size_t t = 0; t < n_taps; ++t)
+					{
+						const unsigned char*	p	=	in + offsets[t];
+						r	+=	p[0]	*	weights[t];
+						g	+=	p[1]	*	weights[t];
+						b	+=	p[2]	*	weights[t];
+					}
+					store(out, r, g, b, k.factor);
+				}
+
+				for (int x = x_end; x < img_w; ++x)
+					slow(x, y);
+			}
+		});
+	}
+
+	/*
+	 *	Like convolve, but every pixel sums only given number of randomly
+	 *	chosen taps, normalised by their own weights.
+	 */
+	void
+	convolve_sampled(const image& src, const image& dst, const frame& f, const kernel& k, unsigned int samples, const filters::border& edge)
+	{
+		const int	img_w	=	src.width;
+		const int	img_h	=	src.height;
+		const int	n_taps	=	k.taps.size();
+
+		// own generators: rand() is shared by the whole program and locks,
+		// every band draws from its own one, seeded apart
+		const unsigned int	seed	=	std::random_device{}();
+
+		filters::parallel::for_bands(img_h, [&](int band, int begin, int end)
+		{
+			std::minstd_rand	draw(seed + band);
+
+			for (int y = begin; y < end; ++y)
+			{
+				bool	inner_row	=	y >= k.top	&&	y < img_h - k.bottom;
+				for (int x = 0; x < img_w; ++x)
+				{
+					bool	inner	=	inner_row	&&	x >= k.left	&&	x < img_w - k.right;
+					int		r		=	0;
+					int		g		=	0;
+					int		b		=	0;
+					int		sum		=	0;
+
+					for (unsigned int i = 0; i < samples; ++i)
+					{
+						const tap&				t	=	k.taps[draw() % n_taps];
+						const unsigned char*	p	=	inner	?	filters::raster::pixel(src, x + t.dx, y + t.dy)
+															:	border_pixel(src, f, x + t.dx, y + t.dy, edge);
+						r	+=	p[0]	*	t.weight;
+						g	+=	p[1]	*	t.weight;
+						b	+=	p[2]	*	t.weight;
+						sum	+=	t.weight;
+					}
+
+					store(filters::raster::pixel(dst, x, y), r, g, b, sum ? 1.0 / sum : 1.0);
+				}
+			}
+		});
+	}
+
+	/*
+	 *	Median of (2 r + 1)^2 neighbourhood for rows [y0, y1) of dst, after
+	 *	Perreault and Hebert: every column keeps histogram of its 2 r + 1
+	 *	pixels, moved down by adding one pixel and removing one; kernel
+	 *	histogram slides right by adding one column and removing one.
+	 *	Histograms are two level (16 coarse bins of 16 fine bins), fine bins
+	 *	of the kernel are updated only for the coarse bin holding the median,
+	 *	so cost per pixel doesn't depend on r.
+	 */
+	void
+	median_rows(const image& src, const image& dst, const frame& f, const filters::border& edge, int r, int y0, int y1)
+	{
+		const int	w		=	dst.width;
+		const int	span	=	2 * r + 1;
+		const int	cols	=	w + 2 * r;
+		const int	target	=	span * span / 2 + 1;
+
+		std::vector<int>	xs(cols);
+		for (int x = 0; x < cols; ++x)
+			xs[x]	=	window_coord(x - r, f.x, f.image_w, src.width, edge.mode);
+
+		struct column
+		{
+			std::uint16_t	coarse[3][16];
+			std::uint16_t	fine[3][256];
+		};
+
+		std::vector<column>	columns(cols);
+		std::memset(columns.data(), 0, cols * sizeof(column));
+
+		auto	update	=	[&](int y, int delta)
+		{
+			int	yy	=	window_coord(y, f.y, f.image_h, src.height, edge.mode);
+			for (int x = 0; x < cols; ++x)
+			{
+				const unsigned char*	p	=	(xs[x] < 0 || yy < 0) ? edge.color : filters::raster::pixel(src, xs[x], yy);
+				for (int c = 0; c < 3; ++c)
+				{
+					columns[x].coarse[c][p[c] >> 4]	+=	delta;
+					columns[x].fine[c][p[c]]		+=	delta;
+				}
+			}
+		};
+
+		for (int y = y0 - r; y < y0 + r; ++y)
+			update(y, 1);
+
+		for (int y = y0; y < y1; ++y)
+		{
+			if (y > y0)	update(y - r - 1, -1);
+			update(y + r, 1);
+
+			unsigned char*	out	=	filters::raster::row(dst, y);
+			for (int c = 0; c < 3; ++c)
+			{
+				int	coarse[16]		=	{0};
+				int	fine[16][16];
+				int	updated[16];
+				for (int k = 0; k < 16; ++k)
+					updated[k]	=	-span;
+
+				for (int x = 0; x < span; ++x)
+					for (int k = 0; k < 16; ++k)
+						coarse[k]	+=	columns[x].coarse[c][k];
+
+				for (int x = 0; x < w; ++x)
+				{
+					if (x > 0)
+						for (int k = 0; k < 16; ++k)
+							coarse[k]	+=	columns[x + span - 1].coarse[c][k]	-	columns[x - 1].coarse[c][k];
+
+					int	k	=	0;
+					int	sum	=	0;
+					while (sum + coarse[k] < target)
+						sum	+=	coarse[k++];
+
+					// fine bins of k are brought from their last position, or rebuilt if that's cheaper
+					int*	bins	=	fine[k];
+					if (x - updated[k] >= span)
+					{
+						std::memset(bins, 0, sizeof(fine[k]));
+						for (int j = x; j < x + span; ++j)
+							for (int v = 0; v < 16; ++v)
+								bins[v]	+=	columns[j].fine[c][k * 16 + v];
+					}
+					else
+						for (int j = updated[k] + 1; j <= x; ++j)
+							for (int v = 0; v < 16; ++v)
+								bins[v]	+=	columns[j + span - 1].fine[c][k * 16 + v]	-	columns[j - 1].fine[c][k * 16 + v];
+					updated[k]	=	x;
+
+					int	v	=	0;
+					while (sum + bins[v] < target)
+						sum	+=	bins[v++];
+
+					out[x * 4 + c]	=	k * 16 + v;
+				}
+			}
+
+			for (int x = 0; x < w; ++x)
+				out[x * 4 + 3]	=	255;
+		}
+	}
+
+	/*
+	 *	Unsharp mask of rows [y0, y1) of dst. Rows of src are blurred
+	 *	horizontally into a ring of 2 r + 1 rows (8 fractional bits), every
+	 *	output row blurs the ring vertically and is sharpened right away:
+	 *	blurred image only ever exists as the ring. Channel differences
+	 *	below threshold are left alone.
+	 */
+	void
+	unsharp_rows(	const image& src, const image& dst, const frame& f, const filters::border& edge,
+					const std::vector<int>& weights, int amount, int threshold, int y0, int y1)
+	{
+		const int	w		=	dst.width;
+		const int	span	=	weights.size();
+		const int	r		=	span / 2;
+
+		std::vector<int>	xs(w + 2 * r);
+		for (int x = 0; x < w + 2 * r; ++x)
+			xs[x]	=	window_coord(x - r, f.x, f.image_w, src.width, edge.mode);
+
+		std::vector<unsigned char>	padded((w + 2 * r) * 3);
+		std::vector<std::uint16_t>	ring(span * w * 3);
+		std::vector<int>			sum(w * 3);
+
+		auto	blur_row	=	[&](int y)
+		{
+			int	yy	=	window_coord(y, f.y, f.image_h, src.height, edge.mode);
+			for (int x = 0; x < w + 2 * r; ++x)
+			{
+				const unsigned char*	p	=	(xs[x] < 0 || yy < 0) ? edge.color : filters::raster::pixel(src, xs[x], yy);
+				padded[x * 3 + 0]	=	p[0];
+				padded[x * 3 + 1]	=	p[1];
+				padded[x * 3 + 2]	=	p[2];
+			}
+
+			std::uint16_t*	out	=	&ring[((y % span + span) % span) * w * 3];
+			for (int i = 0; i < w * 3; ++i)
+			{
+				int	acc	=	0;
+				for (int k = 0; k < span; ++k)
+					acc	+=	padded[i + k * 3] * weights[k];
+				out[i]	=	(acc + 32) >> 6;
+			}
+		};
+
+		for (int y = y0 - r; y < y0 + r; ++y)
+			blur_row(y);
+
+		for (int y = y0; y < y1; ++y)
+		{
+			blur_row(y + r);
+
+			std::fill(sum.begin(), sum.end(), 0);
+			for (int k = 0; k < span; ++k)
+			{
+				const std::uint16_t*	in	=	&ring[(((y - r + k) % span + span) % span) * w * 3];
+				for (int i = 0; i < w * 3; ++i)
+					sum[i]	+=	in[i] * weights[k];
+			}
+
+			const unsigned char*	in	=	filters::raster::row(src, y);
+			unsigned char*			out	=	filters::raster::row(dst, y);
+			for (int x = 0; x < w; ++x, in += 4, out += 4)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					// difference and threshold in 1 / 256
+					int	diff	=	in[c] * 256	-	((sum[x * 3 + c] + (1 << 13)) >> 14);
+					if (std::abs(diff) < threshold)
+					{
+						out[c]	=	in[c];
+						continue;
+					}
+					std::int64_t	v	=	in[c]	+	(((std::int64_t) diff * amount + (1 << 15)) >> 16);
+					out[c]	=	std::min<std::int64_t>(std::max<std::int64_t>(v, 0), 255);
+				}
+				out[3]	=	255;
+			}
+		}
+	}
+
+	/*
+	 *	How far outside of the filtered pixel all passes of a filter read.
+	 */
+	struct halo
+	{
+		int	left;
+		int	top;
+		int	right;
+		int	bottom;
+	};
+
+	halo
+	halo_of(const kernel& k, unsigned int passes)
+	{
+		halo	h	=	{	k.left * (int) passes,	k.top * (int) passes,
+							k.right * (int) passes,	k.bottom * (int) passes};
+		return	h;
+	}
+
+	halo
+	operator+(const halo& a, const halo& b)
+	{
+		halo	h	=	{a.left + b.left, a.top + b.top, a.right + b.right, a.bottom + b.bottom};
+		return	h;
+	}
+
+	/*
+	 *	Passes over whole in, alternating between out and a single
+	 *	scratch buffer so that the last one lands in out. If in and out
+	 *	are the same memory (view filtered in place), in is copied first.
+	 */
+	template <typename Pass>
+	void
+	run_whole(const image& in, const image& out, unsigned int passes, Pass pass)
+	{
+		frame	f	=	{0, 0, in.width, in.height};
+
+		std::vector<unsigned char>	scratch;
+		image						tmp	=	out;
+		if (passes > 1)
+		{
+			scratch.resize(in.width * in.height * 4);
+			tmp	=	filters::raster::wrap(in.width, in.height, scratch.data());
+		}
+
+		std::vector<unsigned char>	copy;
+		image						current	=	in;
+		if (in.data == out.data)
+		{
+			copy.resize(in.width * in.height * 4);
+			current	=	filters::raster::wrap(in.width, in.height, copy.data());
+			filters::raster::copy(in, current);
+		}
+
+		for (unsigned int i = 0; i < passes; ++i)
+		{
+			image	next	=	((passes - i) & 1) ? out : tmp;
+			pass(i, current, next, f);
+			current	=	next;
+		}
+	}
+
+	/*
+	 *	Runs given number of passes, each one reading result of the
+	 *	previous one. pass(i, in, out, frame) is called for every pass.
+	 *
+	 *	Whole image: passes alternate between output and a single scratch
+	 *	buffer so that the last one lands in output.
+	 *
+	 *	Region of interest: only region grown by halo is locked and loaded
+	 *	into a window buffer, passes run on the window and only the region
+	 *	is written to a new bitmap of region size, or to roi.target at
+	 *	region position.
+	 */
+	template <typename Pass>
+	ALLEGRO_BITMAP*
+	run_passes(	ALLEGRO_BITMAP* source, unsigned int passes, const halo& h,
+				const filters::region& roi, filters::border_mode mode, Pass pass)
+	{
+		int	img_w	=	al_get_bitmap_width(source);
+		int	img_h	=	al_get_bitmap_height(source);
+
+		if (roi.whole())
+		{
+			ALLEGRO_BITMAP*	output	=	al_create_bitmap(img_w, img_h);
+			if (!output)	return nullptr;
+
+			image	in	=	filters::raster::lock(source, ALLEGRO_LOCK_READONLY);
+			if (!in.data)
+			{
+				al_destroy_bitmap(output);
+				return nullptr;
+			}
+			image	out	=	filters::raster::lock(output, passes > 1 ? ALLEGRO_LOCK_READWRITE : ALLEGRO_LOCK_WRITEONLY);
+			run_whole(in, out, passes, pass);
+
+			al_unlock_bitmap(output);
+			al_unlock_bitmap(source);
+			return output;
+		}
+
+		filters::raster::rect	r	=	filters::raster::clip(roi, img_w, img_h);
+		if (r.w <= 0 || r.h <= 0)	return roi.target;
+
+		if (roi.target	&&
+			(al_get_bitmap_width(roi.target) < r.x + r.w	||
+			 al_get_bitmap_height(roi.target) < r.y + r.h))
+			return nullptr;
+
+		// window in image coordinates; with BORDER_WRAP it may stick out of the image
+		filters::raster::rect	win		=	{	r.x - h.left,				r.y - h.top,
+												r.w + h.left + h.right,		r.h + h.top + h.bottom};
+		filters::raster::rect	read	=	{	std::max(win.x, 0),		std::max(win.y, 0), 0, 0};
+		read.w	=	std::min(win.x + win.w, img_w)	-	read.x;
+		read.h	=	std::min(win.y + win.h, img_h)	-	read.y;
+
+		bool	wrapped	=	false;
+		if (mode != filters::BORDER_WRAP)
+			win	=	read;
+		else if (read.x != win.x || read.y != win.y || read.w != win.w || read.h != win.h)
+		{
+			filters::raster::rect	all	=	{0, 0, img_w, img_h};
+			read	=	all;
+			wrapped	=	true;
+		}
+
+		bool			in_place	=	roi.target == source;
+		ALLEGRO_BITMAP*	output		=	roi.target ? roi.target : al_create_bitmap(r.w, r.h);
+		if (!output)	return nullptr;
+
+		image	in	=	filters::raster::lock(source, read, in_place ? ALLEGRO_LOCK_READWRITE : ALLEGRO_LOCK_READONLY);
+		if (!in.data)
+		{
+			if (!roi.target)	al_destroy_bitmap(output);
+			return nullptr;
+		}
+
+		std::vector<unsigned char>	buffers[2];
+		image						window[2];
+		for (int i = 0; i < 2; ++i)
+		{
+			buffers[i].resize(win.w * win.h * 4);
+			window[i]	=	filters::raster::wrap(win.w, win.h, buffers[i].data());
+		}
+
+		for (int y = 0; y < win.h; ++y)
+		{
+			if (!wrapped)
+			{
+				std::memcpy(filters::raster::row(window[0], y),
+							filters::raster::pixel(in, win.x - read.x, win.y - read.y + y),
+							win.w * 4);
+				continue;
+			}
+
+			int	src_y	=	border_coord(win.y + y, img_h, filters::BORDER_WRAP);
+			for (int x = 0; x < win.w; ++x)
+				std::memcpy(filters::raster::pixel(window[0], x, y),
+							filters::raster::pixel(in, border_coord(win.x + x, img_w, filters::BORDER_WRAP), src_y),
+							4);
+		}
+
+		frame	f	=	{win.x, win.y, img_w, img_h};
+		for (unsigned int i = 0; i < passes; ++i)
+			pass(i, window[i & 1], window[(i + 1) & 1], f);
+
+		const image&	result	=	window[passes & 1];
+		image			out;
+		filters::raster::rect	out_area	=	{roi.target ? r.x : 0, roi.target ? r.y : 0, r.w, r.h};
+
+		if (in_place)
+		{
+			out			=	filters::raster::wrap(r.w, r.h, filters::raster::pixel(in, r.x - read.x, r.y - read.y));
+			out.pitch	=	in.pitch;
+		}
+		else
+			out	=	filters::raster::lock(output, out_area, ALLEGRO_LOCK_WRITEONLY);
+
+		if (out.data)
+			for (int y = 0; y < r.h; ++y)
+				std::memcpy(filters::raster::row(out, y),
+							filters::raster::pixel(result, r.x - win.x, r.y - win.y + y),
+							r.w * 4);
+
+		if (!in_place && out.data)	al_unlock_bitmap(output);
+		al_unlock_bitmap(source);
+		return output;
+	}
+
+	/*
+	 *	Filter as passes: how many, how far they read and what they do.
+	 *	Built once per call and run on a bitmap (with region) or on views.
+	 */
+	struct plan
+	{
+		unsigned int	passes;
+		halo			reach;
+		std::function<void (unsigned int, const image&, const image&, const frame&)>	pass;
+	};
+
+	ALLEGRO_BITMAP*
+	run_plan(ALLEGRO_BITMAP* source, const plan& p, const filters::region& roi, filters::border_mode mode)
+	{
+		return	run_passes(source, p.passes, p.reach, roi, mode, p.pass);
+	}
+
+	bool
+	run_plan(const filters::view& source, const filters::view& output, const plan& p)
+	{
+		image	in	=	filters::raster::open(source);
+		image	out	=	filters::raster::open(output);
+		if (!in.data || !out.data || in.width != out.width || in.height != out.height)
+			return	false;
+
+		if (!p.passes)
+			filters::raster::copy(in, out);
+		else
+			run_whole(in, out, p.passes, p.pass);
+		return	true;
+	}
+
+	/*
+	 *	Result of a filter that changes nothing: source itself for the
+	 *	whole image, otherwise the region copied where the filter would
+	 *	have written it.
+	 */
+	ALLEGRO_BITMAP*
+	unchanged(ALLEGRO_BITMAP* source, const filters::region& roi)
+	{
+		if (roi.whole())	return source;
+
+		halo	none	=	{0, 0, 0, 0};
+		return	run_passes(source, 0, none, roi, filters::BORDER_CLAMP,
+			[](unsigned int, const image&, const image&, const frame&) {});
+	}
+
+	bool
+	unchanged(const filters::view& source, const filters::view& output)
+	{
+		plan	p;
+		p.passes	=	0;
+		p.reach		=	{0, 0, 0, 0};
+		return	run_plan(source, output, p);
+	}
+
+	/*
+	 *	Calls fn(in, out) for every pixel of in, out may be in itself.
+	 *	Bands of rows run in parallel, so fn mustn't keep state.
+	 */
+	template <typename Fn>
+	void
+	map_rows(const image& in, const image& out, Fn fn)
+	{
+		filters::parallel::for_bands(in.height, [&](int, int begin, int end)
+		{
+			for (int y = begin; y < end; ++y)
+			{
+				const unsigned char*	src	=	filters::raster::row(in, y);
+				unsigned char*			dst	=	filters::raster::row(out, y);
+				for (int x = 0; x < in.width; ++x, src += 4, dst += 4)
+					fn(src, dst);
+			}
+		});
+	}
+
+	/*
+	 *	Runs fn(in, out) for every pixel of source (or its region).
+	 */
+	template <typename Fn>
+	ALLEGRO_BITMAP*
+	map_pixels(ALLEGRO_BITMAP* source, const filters::region& roi, Fn fn)
+	{
+		halo	none	=	{0, 0, 0, 0};
+		return	run_passes(source, 1, none, roi, filters::BORDER_CLAMP,
+			[&](unsigned int, const image& in, const image& out, const frame&)
+		{
+			map_rows(in, out, fn);
+		});
+	}
+
+	template <typename Fn>
+	bool
+	map_pixels(const filters::view& source, const filters::view& output, Fn fn)
+	{
+		image	in	=	filters::raster::open(source);
+		image	out	=	filters::raster::open(output);
+		if (!in.data || !out.data || in.width != out.width || in.height != out.height)
+			return	false;
+
+		map_rows(in, out, fn);
+		return	true;
+	}
+
+	/*
+	 *	shuffle_pixels for pixels [x, count).
+	 */
+	inline void
+	shuffle_tail(unsigned char* dst, const unsigned char* src, int x, int count, const int order[3])
+	{
+		for (; x < count; ++x)
+		{
+			dst[x * 4]		=	src[x * 4 + order[0]];
+			dst[x * 4 + 1]	=	src[x * 4 + order[1]];
+			dst[x * 4 + 2]	=	src[x * 4 + order[2]];
+			dst[x * 4 + 3]	=	255;
+		}
+	}
+
+	/*
+	 *	Copies count pixels, output channel c taken from input channel
+	 *	order[c]; alpha is set to 255. SSE2 has no byte shuffle, so every
+	 *	channel of 4 pixels is shifted to its place within the dword.
+	 */
+	void
+	shuffle_pixels_sse2(unsigned char* dst, const unsigned char* src, int count, const int order[3])
+	{
+		int	x	=	0;
+#ifdef __SSE2__
+		const __m128i	byte	=	_mm_set1_epi32(0xff);
+		const __m128i	alpha	=	_mm_set1_epi32(0xff000000);
+		__m128i			from[3];
+		__m128i			to[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			from[c]	=	_mm_cvtsi32_si128(order[c] * 8);
+			to[c]	=	_mm_cvtsi32_si128(c * 8);
+		}
+
+		for (; x + 4 <= count; x += 4)
+		{
+			__m128i	p	=	_mm_loadu_si128((const __m128i*) (src + x * 4));
+			__m128i	o	=	alpha;
+			for (int c = 0; c < 3; ++c)
+				o	=	_mm_or_si128(o, _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(p, from[c]), byte), to[c]));
+			_mm_storeu_si128((__m128i*) (dst + x * 4), o);
+		}
+#endif
+		shuffle_tail(dst, src, x, count, order);
+	}
+
+#ifdef FILTERS_DISPATCH
+	/*
+	 *	pshufb control moving channels of 4 pixels, alpha bytes zeroed.
+	 */
+	inline __m128i
+	shuffle_control(const int order[3])
+	{
+		return	_mm_setr_epi8(	order[0],		order[1],		order[2],		-1,
+								order[0] + 4,	order[1] + 4,	order[2] + 4,	-1,
+								order[0] + 8,	order[1] + 8,	order[2] + 8,	-1,
+								order[0] + 12,	order[1] + 12,	order[2] + 12,	-1);
+	}
+
+	/*
+	 *	shuffle_pixels, 8 pixels per byte shuffle. Pixels don't cross
+	 *	128-bit lanes, so in-lane pshufb is enough.
+	 */
+	FILTERS_AVX2 void
+	shuffle_pixels_avx2(unsigned char* dst, const unsigned char* src, int count, const int order[3])
+	{
+		const __m256i	control	=	_mm256_broadcastsi128_si256(shuffle_control(order));
+		const __m256i	alpha	=	_mm256_set1_epi32(0xff000000);
+
+		int	x	=	0;
+		for (; x + 8 <= count; x += 8)
+		{
+			__m256i	p	=	_mm256_loadu_si256((const __m256i*) (src + x * 4));
+			_mm256_storeu_si256((__m256i*) (dst + x * 4), _mm256_or_si256(_mm256_shuffle_epi8(p, control), alpha));
+		}
+		shuffle_tail(dst, src, x, count, order);
+	}
+
+FILTERS_AVX512_BEGIN
+	/*
+	 *	shuffle_pixels, 16 pixels per byte shuffle.
+	 */
+	FILTERS_AVX512 void
+	shuffle_pixels_avx512(unsigned char* dst, const unsigned char* src, int count, const int order[3])
+	{
+		// control of 4 pixels repeated in every lane
+		alignas(64) unsigned char	bytes[64];
+		for (int i = 0; i < 64; ++i)
+			bytes[i]	=	i % 4 == 3 ? 0x80 : (i & ~3) % 16 + order[i % 4];
+
+		const __m512i	control	=	_mm512_load_si512(bytes);
+		const __m512i	alpha	=	_mm512_set1_epi32(0xff000000);
+
+		int	x	=	0;
+		for (; x + 16 <= count; x += 16)
+		{
+			__m512i	p	=	_mm512_loadu_si512(src + x * 4);
+			_mm512_storeu_si512(dst + x * 4, _mm512_or_si512(_mm512_shuffle_epi8(p, control), alpha));
+		}
+		shuffle_tail(dst, src, x, count, order);
+	}
+FILTERS_AVX512_END
+#endif
+
+	typedef	void (*shuffle_fn)(unsigned char* dst, const unsigned char* src, int count, const int order[3]);
+
+	const shuffle_fn	shuffle_pixels	=	FILTERS_PICK(shuffle_pixels_sse2, shuffle_pixels_avx2, shuffle_pixels_avx512);
+
+	/*
+	 *	xorshift64*, one call gives a whole noise pixel: colour in low
+	 *	24 bits, position in high 32 bits.
+	 */
+	inline std::uint64_t
+	next_noise(std::uint64_t& state)
+	{
+		state	^=	state >> 12;
+		state	^=	state << 25;
+		state	^=	state >> 27;
+		return	state * 0x2545F4914F6CDD1Dull;
+	}
+	/*
+	 *	Gradient colours are looked up in a table of gradient_steps
+	 *	entries covering positions 0 - 1.
+	 */
+	const int	gradient_steps	=	1024;
+
+	std::vector<unsigned char>
+	bake_gradient(const std::vector<filters::gradient_stop>& stops)
+	{
+		std::vector<filters::gradient_stop>	sorted(stops);
+		std::stable_sort(sorted.begin(), sorted.end(), [](const filters::gradient_stop& a, const filters::gradient_stop& b)
+		{
+			return	a.position < b.position;
+		});
+
+		std::vector<unsigned char>	rgba(sorted.size() * 4);
+		for (std::size_t i = 0; i < sorted.size(); ++i)
+			al_unmap_rgba(sorted[i].color, &rgba[i * 4], &rgba[i * 4 + 1], &rgba[i * 4 + 2], &rgba[i * 4 + 3]);
+
+		std::vector<unsigned char>	lut(gradient_steps * 4);
+		std::size_t					next	=	0;
+		for (int v = 0; v < gradient_steps; ++v)
+		{
+			float	p	=	v / float(gradient_steps - 1);
+			while (next < sorted.size() && sorted[next].position <= p)
+				++next;
+
+			std::size_t	lo	=	next ? next - 1 : 0;
+			std::size_t	hi	=	std::min(next, sorted.size() - 1);
+			float		len	=	sorted[hi].position - sorted[lo].position;
+			float		t	=	len > 0.0f ? (p - sorted[lo].position) / len : 0.0f;
+
+			for (int c = 0; c < 4; ++c)
+				lut[v * 4 + c]	=	(unsigned char) (filters::lerp(rgba[lo * 4 + c], rgba[hi * 4 + c], t) + 0.5);
+		}
+
+		return	lut;
+	}
+
+	inline void
+	gradient_pixel(unsigned char* dst, const std::vector<unsigned char>& lut, float t)
+	{
+		int	i	=	std::min(std::max(int(t + 0.5f), 0), gradient_steps - 1);
+		std::memcpy(dst, &lut[i * 4], 4);
+	}
+
+	/*
+	 *	atan2(y, x) as part of full turn in [0, 1), polynomial good to
+	 *	about 1e-5 turn, much finer than gradient table.
+	 */
+	inline float
+	turn(float y, float x)
+	{
+		float	ax	=	std::fabs(x);
+		float	ay	=	std::fabs(y);
+		float	m	=	std::max(ax, ay);
+		if (m == 0.0f)	return 0.0f;
+
+		float	a	=	std::min(ax, ay) / m;
+		float	q	=	a * a;
+		float	r	=	((-0.0464964749f * q + 0.15931422f) * q - 0.327622764f) * q * a + a;
+		if (ay > ax)	r	=	1.57079637f - r;
+		if (x < 0.0f)	r	=	3.14159274f - r;
+		if (y < 0.0f)	r	=	6.28318548f - r;
+		return	std::min(r * 0.159154943f, 1.0f);
+	}
+}
+
+ALLEGRO_BITMAP*
+filters::raster::into_region(ALLEGRO_BITMAP* source, const region& roi, bool whole_image, const view_fn& fn)
+{
+	const int	img_w	=	al_get_bitmap_width(source);
+	const int	img_h	=	al_get_bitmap_height(source);
+
+	// a halo of the image size clamped to it is the whole image
+	halo	h	=	{0, 0, 0, 0};
+	if (whole_image)
+		h	=	{img_w, img_h, img_w, img_h};
+
+	bool			ok		=	true;
+	ALLEGRO_BITMAP*	output	=	run_passes(source, 1, h, roi, BORDER_CLAMP,
+		[&](unsigned int, const image& in, const image& out, const frame&)
+	{
+		ok	=	fn(view_of(in), view_of(out));
+	});
+
+	if (!ok && output && output != roi.target)
+	{
+		al_destroy_bitmap(output);
+		return nullptr;
+	}
+	return	ok ? output : nullptr;
+}
+
+filters::border::border(border_mode mode)
+	:	mode(mode)
+{
+	color[0]	=	color[1]	=	color[2]	=	0;
+	color[3]	=	255;
+}
+
+filters::border::border(border_mode mode, ALLEGRO_COLOR color)
+	:	mode(mode)
+{
+	al_unmap_rgba(color, &this->color[0], &this->color[1], &this->color[2], &this->color[3]);
+}
+
+filters::region::region()
+	:	x(0), y(0), width(-1), height(-1), target(nullptr)
+{
+}
+
+filters::region::region(int x, int y, int width, int height, ALLEGRO_BITMAP* target)
+	:	x(x), y(y), width(width), height(height), target(target)
+{
+}
+
+bool
+filters::region::whole() const
+{
+	return	width < 0;
+}
+
+filters::view::view()
+	:	data(nullptr), width(0), height(0), pitch(0), format(ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE)
+{
+}
+
+filters::view::view(void* data, int width, int height, int pitch, int format)
+	:	data((unsigned char*) data), width(width), height(height), pitch(pitch), format(format)
+{
+}
+
+filters::view
+filters::view::part(int x, int y, int width, int height) const
+{
+	int	x0	=	std::max(x, 0);
+	int	y0	=	std::max(y, 0);
+	int	x1	=	std::min(x + width, this->width);
+	int	y1	=	std::min(y + height, this->height);
+	if (x1 <= x0 || y1 <= y0)	return view(nullptr, 0, 0, pitch, format);
+
+	int	bytes	=	format == gray::format ? 1 : 4;
+	return	view(data + (std::ptrdiff_t) y0 * pitch + x0 * bytes, x1 - x0, y1 - y0, pitch, format);
+}
+
+inline float
+filters::noise_1d(int x)
+{
+	x	=	(x	<<	13)	^	x;
+	return	(1.0 - ((x * (x * x * 15731 + 789221) + 1376312589) & 0x7fffffff) / 1073741824.0);
+}
+
+inline float
+filters::noise_2d(int x, int y)
+{
+    int	n	=	x	+	y	*	57;
+    n	=	(n	<<	13)	^ 	n;
+    return ( 1.0 - ( (n * (n * n * 15731 + 789221) + 1376312589) & 0x7fffffff) / 1073741824.0);
+}
+
+inline float
+filters::smooth_noise1d(int x)
+{
+	return	noise_1d(x) / 2	+	noise_1d(x - 1) / 4	+	noise_1d(x + 1) / 4;
+}
+
+inline float
+filters::smooth_noise2d(int x, int y)
+{
+    float	corners = (noise_2d(x - 1, y - 1) + noise_2d(x + 1, y - 1) + noise_2d(x - 1, y + 1) + noise_2d(x + 1, y + 1) ) / 16;
+    float	sides   = (noise_2d(x - 1, y) + noise_2d(x + 1, y) + noise_2d(x, y - 1) + noise_2d(x, y + 1)) / 8;
+    float	center  = noise_2d(x, y) / 4;
+
+    return corners + sides + center;
+}
+
+inline float
+filters::perlin::interpolated_noise_1d(float x)
+{
+	int		integer_X		=	int(x);
+	float	fractional_X	=	x	-	integer_X;
+	
+	float	v1 = smooth_noise1d(integer_X);
+	float	v2 = smooth_noise1d(integer_X + 1);
+
+	return cosrp(v1, v2, fractional_X);
+}
+
+float
+filters::perlin::perlin_noise_1d(float x)
+{
+	float	total = 0;
+	float	p	=	1.0 / 4.0;
+	int		n	= 	7;
+
+	for (int i = 0; i < n; ++i)
+	{
+		int		frequency = pow(2, i);		
+		float	amplitude = pow(p, i);
+		total 	= 	total	+	interpolated_noise_1d(x * frequency) * amplitude;
+	}
+
+	return total;
+}
+
+inline float
+filters::perlin::interpolated_noise_2d(float x, float y)
+{
+	int		integer_X    = int(x);
+	float	fractional_X = x - integer_X;
+
+	int		integer_Y    = int(y);
+	float	fractional_Y = y - integer_Y;
+
+	float	v1 = smooth_noise2d(integer_X,     integer_Y);
+	float	v2 = smooth_noise2d(integer_X + 1, integer_Y);
+	float	v3 = smooth_noise2d(integer_X,     integer_Y + 1);
+	float	v4 = smooth_noise2d(integer_X + 1, integer_Y + 1);
+
+	float	i1 = cosrp(v1 , v2 , fractional_X);
+	float	i2 = cosrp(v3 , v4 , fractional_X);
+
+	return cosrp(i1 , i2 , fractional_Y);
+}
+
+float
+filters::perlin::perlin_noise_2d(float x, float y, float p)
+{
+	float	total = 0;
+	//float	p	=	1.0 / 1.2;
+	int		n	= 	16;
+
+	for (int i = 0; i < n; ++i)
+	{
+		int		frequency 	= 	pow(2, i);
+		float	amplitude	=	pow(p, i);
+		total	=	total	+	interpolated_noise_2d(x * frequency, y * frequency)	*	amplitude;
+	}
+
+	return total;
+}
+
+ALLEGRO_BITMAP*
+filters::perlin::clouds(unsigned int width, unsigned int height, float p)
+{
+	ALLEGRO_BITMAP*	output	=	al_create_bitmap(width, height);
+	if (!output)	return nullptr;
+
+	raster::image	out	=	raster::lock(output, ALLEGRO_LOCK_WRITEONLY);
+	if (!out.data)	return output;
+
+	clouds(raster::view_of(out), p);
+
+	al_unlock_bitmap(output);
+	return output;
+}
+
+bool
+filters::perlin::clouds(const view& output, float p)
+{
+	// single channel output gets the value alone
+	const bool		single	=	output.format == gray::format;
+	raster::image	out		=	single ? gray::open(output) : raster::open(output);
+	if (!out.data)	return false;
+
+	unsigned int	seed	=	std::random_device{}() % 10000000;
+
+	for (int y = 0; y < out.height; ++y)
+	{
+		unsigned char*	dst	=	raster::row(out, y);
+		for (int x = 0; x < out.width; ++x)
+		{
+			int	val	=	(perlin_noise_2d((float) (x + seed) / out.width , (float) (y + seed) / out.height, p) * 127)	+ 127;
+			val	=	std::min(std::max(val, 0), 255);
+			if (single)
+			{
+				dst[x]	=	val;
+				continue;
+			}
+			dst[x * 4]	=	dst[x * 4 + 1]	=	dst[x * 4 + 2]	=	val;
+			dst[x * 4 + 3]	=	255;
+		}
+	}
+
+	return	true;
+}
+
+filters::perlin::color_stop::color_stop(unsigned char height, ALLEGRO_COLOR color)
+	:	height(height), color(color)
+{
+}
+
+namespace
+{
+	// water ramps up to blue, land goes from green to red
+	std::vector<filters::perlin::color_stop>
+	default_stops()
+	{
+		std::vector<filters::perlin::color_stop>	stops;
+		stops.push_back(filters::perlin::color_stop(0,		al_map_rgb(0, 0, 0)));
+		stops.push_back(filters::perlin::color_stop(85,		al_map_rgb(0, 0, 254)));
+		stops.push_back(filters::perlin::color_stop(86,		al_map_rgb(85, 169, 0)));
+		stops.push_back(filters::perlin::color_stop(255,	al_map_rgb(254, 0, 0)));
+		return	stops;
+	}
+
+	/*
+	 *	Pixels of count source pixels replaced by lut entries of their
+	 *	red byte (height).
+	 */
+	void
+	palette_row_scalar(unsigned char* dst, const unsigned char* src, const unsigned char* lut, int count)
+	{
+		for (int x = 0; x < count; ++x)
+			std::memcpy(dst + x * 4, lut + src[x * 4] * 4, 4);
+	}
+
+#ifdef FILTERS_DISPATCH
+	/*
+	 *	palette_row, 8 pixels gathered at once.
+	 */
+	FILTERS_AVX2 void
+	palette_row_avx2(unsigned char* dst, const unsigned char* src, const unsigned char* lut, int count)
+	{
+		const __m256i	red	=	_mm256_set1_epi32(0xff);
+
+		int	x	=	0;
+		for (; x + 8 <= count; x += 8)
+		{
+			__m256i	h	=	_mm256_and_si256(_mm256_loadu_si256((const __m256i*) (src + x * 4)), red);
+			_mm256_storeu_si256((__m256i*) (dst + x * 4), _mm256_i32gather_epi32((const int*) lut, h, 4));
+		}
+		palette_row_scalar(dst + x * 4, src + x * 4, lut, count - x);
+	}
+
+FILTERS_AVX512_BEGIN
+	/*
+	 *	palette_row, 16 pixels gathered at once.
+	 */
+	FILTERS_AVX512 void
+	palette_row_avx512(unsigned char* dst, const unsigned char* src, const unsigned char* lut, int count)
+	{
+		const __m512i	red	=	_mm512_set1_epi32(0xff);
+
+		int	x	=	0;
+		for (; x + 16 <= count; x += 16)
+		{
+			__m512i	h	=	_mm512_and_si512(_mm512_loadu_si512(src + x * 4), red);
+			_mm512_storeu_si512(dst + x * 4, _mm512_i32gather_epi32(h, lut, 4));
+		}
+		palette_row_scalar(dst + x * 4, src + x * 4, lut, count - x);
+	}
+FILTERS_AVX512_END
+#endif
+
+	/*
+	 *	palette_row of single channel source, one byte per height.
+	 */
+	void
+	palette_levels_scalar(unsigned char* dst, const unsigned char* src, const unsigned char* lut, int count)
+	{
+		for (int x = 0; x < count; ++x)
+			std::memcpy(dst + x * 4, lut + src[x] * 4, 4);
+	}
+
+#ifdef FILTERS_DISPATCH
+	/*
+	 *	palette_levels, 8 heights widened to indices and gathered at once.
+	 */
+	FILTERS_AVX2 void
+	palette_levels_avx2(unsigned char* dst, const unsigned char* src, const unsigned char* lut, int count)
+	{
+		int	x	=	0;
+		for (; x + 8 <= count; x += 8)
+		{
+			__m256i	h	=	_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (src + x)));
+			_mm256_storeu_si256((__m256i*) (dst + x * 4), _mm256_i32gather_epi32((const int*) lut, h, 4));
+		}
+		palette_levels_scalar(dst + x * 4, src + x, lut, count - x);
+	}
+
+FILTERS_AVX512_BEGIN
+	/*
+	 *	palette_levels, 16 heights at once.
+	 */
+	FILTERS_AVX512 void
+	palette_levels_avx512(unsigned char* dst, const unsigned char* src, const unsigned char* lut, int count)
+	{
+		int	x	=	0;
+		for (; x + 16 <= count; x += 16)
+		{
+			__m512i	h	=	_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*) (src + x)));
+			_mm512_storeu_si512(dst + x * 4, _mm512_i32gather_epi32(h, lut, 4));
+		}
+		palette_levels_scalar(dst + x * 4, src + x, lut, count - x);
+	}
+FILTERS_AVX512_END
+#endif
+
+	typedef	void (*palette_row_fn)(unsigned char* dst, const unsigned char* src, const unsigned char* lut, int count);
+
+	const palette_row_fn	palette_row		=	FILTERS_PICK(palette_row_scalar, palette_row_avx2, palette_row_avx512);
+	const palette_row_fn	palette_levels	=	FILTERS_PICK(palette_levels_scalar, palette_levels_avx2, palette_levels_avx512);
+}
+
+ALLEGRO_BITMAP*
+filters::perlin::heightmap(ALLEGRO_BITMAP* source, region roi)
+{
+	return heightmap(source, default_stops(), roi);
+}
+
+bool
+filters::perlin::heightmap(const view& source, const view& output)
+{
+	return	heightmap(source, output, default_stops());
+}
+
+ALLEGRO_BITMAP*
+filters::perlin::heightmap(ALLEGRO_BITMAP* source, const std::vector<color_stop>& stops, region roi)
+{
+	return	raster::into_region(source, roi, false, [&](const view& in, const view& out)
+	{
+		return	heightmap(in, out, stops);
+	});
+}
+
+bool
+filters::perlin::heightmap(const view& source, const view& output, const std::vector<color_stop>& stops)
+{
+	if (stops.empty())	return heightmap(source, output);
+
+	// heights are the red byte of RGBA sources, the only byte of single channel ones
+	const bool		single	=	source.format == gray::format;
+	raster::image	in		=	single ? gray::open(source) : raster::open(source);
+	raster::image	out		=	raster::open(output);
+	if (!in.data || !out.data || in.width != out.width || in.height != out.height)
+		return	false;
+
+	std::vector<color_stop>	sorted(stops);
+	std::stable_sort(sorted.begin(), sorted.end(), [](const color_stop& a, const color_stop& b)
+	{
+		return	a.height < b.height;
+	});
+
+	std::vector<unsigned char>	rgba(sorted.size() * 4);
+	for (std::size_t i = 0; i < sorted.size(); ++i)
+		al_unmap_rgba(sorted[i].color, &rgba[i * 4], &rgba[i * 4 + 1], &rgba[i * 4 + 2], &rgba[i * 4 + 3]);
+
+	// whole palette is baked once, every pixel is then one table read
+	alignas(32) unsigned char	lut[256 * 4];
+	std::size_t					next	=	0;
+	for (int v = 0; v < 256; ++v)
+	{
+		while (next < sorted.size() && sorted[next].height <= v)
+			++next;
+
+		std::size_t	lo	=	next ? next - 1 : 0;
+		std::size_t	hi	=	std::min(next, sorted.size() - 1);
+		int			len	=	sorted[hi].height - sorted[lo].height;
+		int			t	=	len > 0 ? v - sorted[lo].height : 0;
+
+		for (int c = 0; c < 4; ++c)
+			lut[v * 4 + c]	=	len > 0	?	(rgba[lo * 4 + c] * (len - t) + rgba[hi * 4 + c] * t + len / 2) / len
+										:	rgba[lo * 4 + c];
+	}
+
+	const int				img_w	=	in.width;
+	const int				img_h	=	in.height;
+	const palette_row_fn	colour	=	single ? palette_levels : palette_row;
+
+	parallel::for_bands(img_h, [&](int, int begin, int end)
+	{
+		for (int y = begin; y < end; ++y)
+			colour(raster::row(out, y), raster::row(in, y), lut, img_w);
+	});
+
+	return	true;
+}
+
+ALLEGRO_BITMAP*
+filters::glitch(ALLEGRO_BITMAP* source, unsigned int power, unsigned int seed, region roi)
+{
+	// blocks are moved across the whole image
+	return	raster::into_region(source, roi, true, [&](const view& in, const view& out)
+	{
+		return	glitch(in, out, power, seed);
+	});
+}
+
+bool
+filters::glitch(const view& source, const view& output, unsigned int power, unsigned int seed)
+{
+	raster::image	in	=	raster::open(source);
+	raster::image	out	=	raster::open(output);
+	if (!in.data || !out.data || in.width != out.width || in.height != out.height)
+		return	false;
+
+	// blocks are moved from the original, so in place needs a copy of it
+	std::vector<unsigned char>	copy;
+	if (in.data == out.data)
+	{
+		copy.resize(in.width * in.height * 4);
+		in	=	raster::wrap(in.width, in.height, copy.data());
+		raster::copy(raster::open(source), in);
+	}
+
+	const int	img_w	=	in.width;
+	const int	img_h	=	in.height;
+
+	std::mt19937	g(seed);
+	int				order[3]	=	{0, 1, 2};
+
+	// odd rows end up under scanlines, only even ones are worth copying
+	for (int y = 0; y < img_h; y += 2)
+		std::memcpy(raster::row(out, y), raster::row(in, y), img_w * 4);
+
+	for (unsigned int n = 0; n < power; ++n)
+	{
+		int	source_x	=	g()	%	img_w;
+		int	source_y	=	g()	%	img_h;
+
+		int	output_x	=	g()	%	img_w;
+		int	output_y	=	g()	%	img_h;
+
+		int	matrix_w	=	g()	%	img_w / 4;
+		int	matrix_h	=	g()	%	img_h / 8;
+
+		if (g() % 100 <= 33)
+		{
+			if (!matrix_w || !matrix_h)	continue;
+
+			std::uint64_t	state	=	((std::uint64_t) g() << 32 | g()) | 1;
+			for (int i = 0; i < (matrix_h / 2) * (matrix_w / 2); ++i)
+			{
+				std::uint64_t	r		=	next_noise(state);
+				std::uint32_t	place	=	std::uint32_t(r >> 32) % std::uint32_t(matrix_w * matrix_h);
+				unsigned char*	p		=	raster::pixel(out,	(output_x + place % matrix_w) % img_w,
+																(output_y + place / matrix_w) % img_h);
+				p[0]	=	r;
+				p[1]	=	r >> 8;
+				p[2]	=	r >> 16;
+				p[3]	=	255;
+			}
+		}
+		else
+		{
+			std::shuffle(order, order + 3, g);
+
+			// block wraps around the edges, so rows are split where either side wraps
+			for (int i = 0; i < matrix_h; ++i)
+			{
+				const unsigned char*	src	=	raster::row(in, (source_y + i) % img_h);
+				unsigned char*			dst	=	raster::row(out, (output_y + i) % img_h);
+
+				for (int j = 0; j < matrix_w; )
+				{
+					int	sx	=	(source_x + j) % img_w;
+					int	dx	=	(output_x + j) % img_w;
+					int	run	=	std::min(matrix_w - j, std::min(img_w - sx, img_w - dx));
+
+					if (order[0] == 0 && order[1] == 1 && order[2] == 2)
+						std::memcpy(dst + dx * 4, src + sx * 4, run * 4);
+					else
+						shuffle_pixels(dst + dx * 4, src + sx * 4, run, order);
+					j	+=	run;
+				}
+			}
+		}
+	}
+
+	std::vector<unsigned char>	black(img_w * 4, 0);
+	for (int x = 0; x < img_w; ++x)
+		black[x * 4 + 3]	=	255;
+	for (int y = 1; y < img_h; y += 2)
+		std::memcpy(raster::row(out, y), black.data(), img_w * 4);
+
+	return	true;
+}
+
+namespace
+{
+	/*
+	 *	Kernels of the convolution filters, shared by bitmap and view versions.
+	 */
+	const int	gauss_7x7[7][7]	=
+	{
+		{0,		0,		0,		5,		0,		0,		0},
+		{0,		5,		18,		32,		18,		5,		0},
+		{0,		18,		64,		100,	64,		18,		0},
+		{5,		32,		100,	100,	100,	32,		5},
+		{0,		18,		64,		100,	64,		18,		0},
+		{0,		5,		18,		32,		18,		5,		0},
+		{0,		0,		0,		5,		0,		0,		0}
+	};
+
+	const int	gauss_7[7]	=	{5,	32,	100,	100,	100,	32,	5};
+
+	const int	box_3x3[3][3]	=
+	{
+		{1,	1,	1},
+		{1,	1,	1},
+		{1,	1,	1}
+	};
+
+	const int	edges_5x5[5][5]	=
+	{
+		{0,	0,	-1,	0,	0},
+		{0, 0,	-1,	0,	0},
+		{0, 0,	2,	0,	0},
+		{0, 0,	0,	0,	0},
+		{0, 0,	0,	0,	0}
+	};
+
+	const int	sharpen_3x3[3][3]	=
+	{
+		{0, -1, 0},
+		{-1, 5, -1},
+		{0, -1, 0}
+	};
+
+	/*
+	 *	n passes of one kernel, convolved fully or sampled.
+	 */
+	plan
+	convolution_plan(const kernel& k, unsigned int n, const filters::border& edge, unsigned int samples = 0)
+	{
+		plan	p;
+		p.passes	=	n;
+		p.reach		=	halo_of(k, n);
+		p.pass		=	[k, edge, samples](unsigned int, const image& in, const image& out, const frame& f)
+		{
+			if (samples)	convolve_sampled(in, out, f, k, samples, edge);
+			else			convolve(in, out, f, k, edge);
+		};
+		return	p;
+	}
+
+	plan
+	gaussian_plan(unsigned int n, const filters::border& edge)
+	{
+		kernel	k	=	make_kernel(&gauss_7x7[0][0], 7, 7, 3, 3, normalising_factor(&gauss_7x7[0][0], 7, 7));
+		return	convolution_plan(k, n, edge);
+	}
+
+	plan
+	gaussian_optimized_plan(unsigned int n, const filters::border& edge)
+	{
+		float	factor	=	normalising_factor(gauss_7, 7, 1);
+
+		// first n passes horizontal, then n passes vertical
+		kernel	horizontal	=	make_kernel(gauss_7, 7, 1, 3, 0, factor);
+		kernel	vertical	=	make_kernel(gauss_7, 1, 7, 0, 3, factor);
+
+		plan	p;
+		p.passes	=	2 * n;
+		p.reach		=	halo_of(horizontal, n) + halo_of(vertical, n);
+		p.pass		=	[=](unsigned int i, const image& in, const image& out, const frame& f)
+		{
+			convolve(in, out, f, i < n ? horizontal : vertical, edge);
+		};
+		return	p;
+	}
+
+	plan
+	gaussian_sampling_plan(unsigned int n, unsigned int samples, const filters::border& edge)
+	{
+		kernel	k	=	make_kernel(&gauss_7x7[0][0], 7, 7, 3, 3, 1.0);
+		return	convolution_plan(k, n, edge, samples);
+	}
+
+	plan
+	box_plan(unsigned int n, const filters::border& edge)
+	{
+		kernel	k	=	make_kernel(&box_3x3[0][0], 3, 3, 1, 1, normalising_factor(&box_3x3[0][0], 3, 3));
+		return	convolution_plan(k, n, edge);
+	}
+
+	plan
+	box_sampling_plan(unsigned int n, unsigned int samples, const filters::border& edge)
+	{
+		kernel	k	=	make_kernel(&box_3x3[0][0], 3, 3, 1, 1, 1.0);
+		return	convolution_plan(k, n, edge, samples);
+	}
+
+	plan
+	median_plan(unsigned int radius, const filters::border& edge)
+	{
+		int		r	=	std::min(radius, 127u);
+		plan	p;
+		p.passes	=	radius ? 1 : 0;
+		p.reach		=	{r, r, r, r};
+		p.pass		=	[r, edge](unsigned int, const image& in, const image& out, const frame& f)
+		{
+			filters::parallel::for_bands(out.height, [&](int, int begin, int end)
+			{
+				median_rows(in, out, f, edge, r, begin, end);
+			});
+		};
+		return	p;
+	}
+
+	plan
+	edges_plan(const filters::border& edge)
+	{
+		return	convolution_plan(make_kernel(&edges_5x5[0][0], 5, 5, 1, 1, 1.0), 1, edge);
+	}
+
+	plan
+	sharpen_plan(const filters::border& edge)
+	{
+		return	convolution_plan(make_kernel(&sharpen_3x3[0][0], 3, 3, 1, 1, 1.0), 1, edge);
+	}
+
+	plan
+	unsharp_plan(float radius, float amount, unsigned int threshold, const filters::border& edge)
+	{
+		plan	p;
+		p.passes	=	0;
+		p.reach		=	{0, 0, 0, 0};
+		if (radius <= 0.0f || amount == 0.0f)	return p;
+
+		// past 65536 every difference saturates anyway, a stays in int
+		std::vector<int>	weights	=	filters::raster::gaussian_weights(radius);
+		int					r		=	weights.size() / 2;
+		int					a		=	int(std::min(std::max(amount, -65536.0f), 65536.0f) * 256.0f + 0.5f);
+		int					t		=	std::min(threshold, 255u) * 256;
+
+		p.passes	=	1;
+		p.reach		=	{r, r, r, r};
+		p.pass		=	[=](unsigned int, const image& in, const image& out, const frame& f)
+		{
+			filters::parallel::for_bands(out.height, [&](int, int begin, int end)
+			{
+				unsharp_rows(in, out, f, edge, weights, a, t, begin, end);
+			});
+		};
+		return	p;
+	}
+
+	/*
+	 *	Point filters, fn(in, out) of map_pixels.
+	 */
+	struct gray_pixel
+	{
+		unsigned char
+		level(const unsigned char* in) const
+		{
+			return	(in[0] + in[1] + in[2]) / 3;
+		}
+
+		void
+		operator()(const unsigned char* in, unsigned char* out) const
+		{
+			out[0]	=	out[1]	=	out[2]	=	level(in);
+			out[3]	=	255;
+		}
+	};
+
+	struct black_white_pixel
+	{
+		unsigned char
+		level(const unsigned char* in) const
+		{
+			return	(in[0] + in[1] + in[2]) / 3 > 127 ? 255 : 0;
+		}
+
+		void
+		operator()(const unsigned char* in, unsigned char* out) const
+		{
+			out[0]	=	out[1]	=	out[2]	=	level(in);
+			out[3]	=	255;
+		}
+	};
+
+	/*
+	 *	map_pixels into single channel output, fn.level(in) per pixel.
+	 */
+	template <typename Fn>
+	bool
+	map_levels(const filters::view& source, const filters::view& output, Fn fn)
+	{
+		image	in	=	filters::raster::open(source);
+		image	out	=	filters::gray::open(output);
+		if (!in.data || !out.data || in.width != out.width || in.height != out.height)
+			return	false;
+
+		filters::parallel::for_bands(in.height, [&](int, int begin, int end)
+		{
+			for (int y = begin; y < end; ++y)
+			{
+				const unsigned char*	src	=	filters::raster::row(in, y);
+				unsigned char*			dst	=	filters::raster::row(out, y);
+				for (int x = 0; x < in.width; ++x)
+					dst[x]	=	fn.level(src + x * 4);
+			}
+		});
+		return	true;
+	}
+
+	struct tint_pixel
+	{
+		void
+		operator()(const unsigned char* in, unsigned char* out) const
+		{
+			unsigned char	r	=	in[0];
+			unsigned char	g	=	in[1];
+			unsigned char	b	=	in[2];
+			out[0]	=	b;
+			out[1]	=	r;
+			out[2]	=	g;
+			out[3]	=	255;
+		}
+	};
+
+	struct lighten_pixel
+	{
+		int	n;
+
+		void
+		operator()(const unsigned char* in, unsigned char* out) const
+		{
+			for (int c = 0; c < 3; ++c)
+				out[c]	=	std::min(std::max(in[c] + n, 0), 255);
+			out[3]	=	255;
+		}
+	};
+
+	struct contrast_pixel
+	{
+		float	n;
+
+		void
+		operator()(const unsigned char* in, unsigned char* out) const
+		{
+			for (int c = 0; c < 3; ++c)
+				out[c]	=	(in[c] * n) <= 255 ? std::max(int(in[c] * n), 0) : 255;
+			out[3]	=	255;
+		}
+	};
+}
+
+// działa
+ALLEGRO_BITMAP*
+filters::grayscale(ALLEGRO_BITMAP* source, region roi)
+{
+	return	map_pixels(source, roi, gray_pixel());
+}
+
+bool
+filters::grayscale(const view& source, const view& output)
+{
+	if (output.format == gray::format)	return map_levels(source, output, gray_pixel());
+	return	map_pixels(source, output, gray_pixel());
+}
+
+// działa
+ALLEGRO_BITMAP*
+filters::black_white(ALLEGRO_BITMAP* source, region roi)
+{
+	return	map_pixels(source, roi, black_white_pixel());
+}
+
+bool
+filters::black_white(const view& source, const view& output)
+{
+	if (output.format == gray::format)	return map_levels(source, output, black_white_pixel());
+	return	map_pixels(source, output, black_white_pixel());
+}
+
+// działa
+ALLEGRO_BITMAP*
+filters::gaussian_blur(ALLEGRO_BITMAP* source, unsigned int n, border edge, region roi)
+{
+	if (!n)	return unchanged(source, roi);
+	return	run_plan(source, gaussian_plan(n, edge), roi, edge.mode);
+}
+
+bool
+filters::gaussian_blur(const view& source, const view& output, unsigned int n, border edge)
+{
+	return	run_plan(source, output, gaussian_plan(n, edge));
+}
+
+ALLEGRO_BITMAP*
+filters::gaussian_blur_optimized(ALLEGRO_BITMAP* source, unsigned int n, border edge, region roi)
+{
+	if (!n)	return unchanged(source, roi);
+	return	run_plan(source, gaussian_optimized_plan(n, edge), roi, edge.mode);
+}
+
+bool
+filters::gaussian_blur_optimized(const view& source, const view& output, unsigned int n, border edge)
+{
+	return	run_plan(source, output, gaussian_optimized_plan(n, edge));
+}
+
+// działa
+ALLEGRO_BITMAP*
+filters::gaussian_blur_sampling(ALLEGRO_BITMAP* source, unsigned int n, unsigned int samples, border edge, region roi)
+{
+	if (!n)	return unchanged(source, roi);
+	return	run_plan(source, gaussian_sampling_plan(n, samples, edge), roi, edge.mode);
+}
+
+bool
+filters::gaussian_blur_sampling(const view& source, const view& output, unsigned int n, unsigned int samples, border edge)
+{
+	return	run_plan(source, output, gaussian_sampling_plan(n, samples, edge));
+}
+
+// działa
+ALLEGRO_BITMAP*
+filters::box_blur(ALLEGRO_BITMAP* source, unsigned int n, border edge, region roi)
+{
+	if (!n)	return unchanged(source, roi);
+	return	run_plan(source, box_plan(n, edge), roi, edge.mode);
+}
+
+bool
+filters::box_blur(const view& source, const view& output, unsigned int n, border edge)
+{
+	return	run_plan(source, output, box_plan(n, edge));
+}
+
+ALLEGRO_BITMAP*
+filters::median(ALLEGRO_BITMAP* source, unsigned int radius, border edge, region roi)
+{
+	if (!radius)	return unchanged(source, roi);
+	return	run_plan(source, median_plan(radius, edge), roi, edge.mode);
+}
+
+bool
+filters::median(const view& source, const view& output, unsigned int radius, border edge)
+{
+	return	run_plan(source, output, median_plan(radius, edge));
+}
+
+// działa
+ALLEGRO_BITMAP*
+filters::box_blur_sampling(ALLEGRO_BITMAP* source, unsigned int n, unsigned int samples, border edge, region roi)
+{
+	if (!n)	return unchanged(source, roi);
+	return	run_plan(source, box_sampling_plan(n, samples, edge), roi, edge.mode);
+}
+
+bool
+filters::box_blur_sampling(const view& source, const view& output, unsigned int n, unsigned int samples, border edge)
+{
+	return	run_plan(source, output, box_sampling_plan(n, samples, edge));
+}
+
+ALLEGRO_BITMAP*
+filters::alpha_blending(ALLEGRO_BITMAP* background, ALLEGRO_BITMAP* foreground, ALLEGRO_BITMAP* mask, region roi)
+{
+	return	composite(background, std::vector<layer>(1, layer(foreground, mask)), roi);
+}
+
+// działa
+ALLEGRO_BITMAP*
+filters::alpha_blending(ALLEGRO_BITMAP* background, ALLEGRO_BITMAP* foreground, float alpha, region roi)
+{
+	if (al_get_bitmap_width(background)		!=	al_get_bitmap_width(foreground)	||
+		al_get_bitmap_height(background)	!=	al_get_bitmap_height(foreground))
+		return	nullptr;
+
+	if (roi.whole() && alpha	==	1.0)	return	foreground;
+	if (roi.whole() && alpha	==	0.0)	return	background;
+
+	return	composite(background, std::vector<layer>(1, layer(foreground, alpha)), roi);
+}
+
+//działa
+ALLEGRO_BITMAP*
+filters::detect_edges(ALLEGRO_BITMAP* source, border edge, region roi)
+{
+	return	run_plan(source, edges_plan(edge), roi, edge.mode);
+}
+
+bool
+filters::detect_edges(const view& source, const view& output, border edge)
+{
+	return	run_plan(source, output, edges_plan(edge));
+}
+
+//działa
+ALLEGRO_BITMAP*
+filters::sharpen(ALLEGRO_BITMAP* source, border edge, region roi)
+{
+	return	run_plan(source, sharpen_plan(edge), roi, edge.mode);
+}
+
+bool
+filters::sharpen(const view& source, const view& output, border edge)
+{
+	return	run_plan(source, output, sharpen_plan(edge));
+}
+
+ALLEGRO_BITMAP*
+filters::unsharp_mask(ALLEGRO_BITMAP* source, float radius, float amount, unsigned int threshold, border edge, region roi)
+{
+	if (radius <= 0.0f || amount == 0.0f)	return unchanged(source, roi);
+	return	run_plan(source, unsharp_plan(radius, amount, threshold, edge), roi, edge.mode);
+}
+
+bool
+filters::unsharp_mask(const view& source, const view& output, float radius, float amount, unsigned int threshold, border edge)
+{
+	return	run_plan(source, output, unsharp_plan(radius, amount, threshold, edge));
+}
+
+ALLEGRO_BITMAP*
+filters::tint(ALLEGRO_BITMAP* source, region roi)
+{
+	return	map_pixels(source, roi, tint_pixel());
+}
+
+bool
+filters::tint(const view& source, const view& output)
+{
+	return	map_pixels(source, output, tint_pixel());
+}
+
+// działa
+ALLEGRO_BITMAP*
+filters::lighten(ALLEGRO_BITMAP* source, int n, region roi)
+{
+	if (!n)	return unchanged(source, roi);
+
+	lighten_pixel	fn	=	{n};
+	return	map_pixels(source, roi, fn);
+}
+
+bool
+filters::lighten(const view& source, const view& output, int n)
+{
+	if (!n)	return unchanged(source, output);
+
+	lighten_pixel	fn	=	{n};
+	return	map_pixels(source, output, fn);
+}
+
+// działa
+ALLEGRO_BITMAP*
+filters::contrast(ALLEGRO_BITMAP* source, float n, region roi)
+{
+	if (n == 1.0)	return unchanged(source, roi);
+
+	contrast_pixel	fn	=	{n};
+	return	map_pixels(source, roi, fn);
+}
+
+bool
+filters::contrast(const view& source, const view& output, float n)
+{
+	if (n == 1.0)	return unchanged(source, output);
+
+	contrast_pixel	fn	=	{n};
+	return	map_pixels(source, output, fn);
+}
+
+filters::gradient_stop::gradient_stop(float position, ALLEGRO_COLOR color)
+	:	position(position), color(color)
+{
+}
+
+// działa
+ALLEGRO_BITMAP*
+filters::gradient(unsigned int width, unsigned int height, ALLEGRO_COLOR from, ALLEGRO_COLOR to)
+{
+	ALLEGRO_BITMAP*	output	=	al_create_bitmap(width, height);
+	if (!output)	return nullptr;
+
+	raster::image	out	=	raster::lock(output, ALLEGRO_LOCK_WRITEONLY);
+	if (!out.data)	return output;
+
+	gradient(raster::view_of(out), from, to);
+
+	al_unlock_bitmap(output);
+	return output;
+}
+
+bool
+filters::gradient(const view& output, ALLEGRO_COLOR from, ALLEGRO_COLOR to)
+{
+	raster::image	out	=	raster::open(output);
+	if (!out.data)	return false;
+
+	unsigned char	from_pxl[3];
+	unsigned char	to_pxl[3];
+
+	al_unmap_rgb(	from,
+					&from_pxl[0],
+					&from_pxl[1],
+					&from_pxl[2]
+				);
+
+	al_unmap_rgb(	to,
+					&to_pxl[0],
+					&to_pxl[1],
+					&to_pxl[2]
+				);
+
+	// every row is the same, only the first one is computed
+	unsigned char*	first	=	raster::row(out, 0);
+	for (int x = 0; x < out.width; ++x)
+	{
+		for (int c = 0; c < 3; ++c)
+			first[x * 4 + c]	=	(int) lerp(from_pxl[c], to_pxl[c], x / (float) out.width);
+		first[x * 4 + 3]	=	255;
+	}
+
+	for (int y = 1; y < out.height; ++y)
+		std::memcpy(raster::row(out, y), first, out.width * 4);
+
+	return	true;
+}
+
+ALLEGRO_BITMAP*
+filters::gradient(	unsigned int width, unsigned int height, const std::vector<gradient_stop>& stops,
+					gradient_mode mode, float angle)
+{
+	if (stops.empty())	return nullptr;
+
+	ALLEGRO_BITMAP*	output	=	al_create_bitmap(width, height);
+	if (!output)	return nullptr;
+
+	raster::image	out	=	raster::lock(output, ALLEGRO_LOCK_WRITEONLY);
+	if (!out.data)	return output;
+
+	gradient(raster::view_of(out), stops, mode, angle);
+
+	al_unlock_bitmap(output);
+	return output;
+}
+
+bool
+filters::gradient(const view& output, const std::vector<gradient_stop>& stops, gradient_mode mode, float angle)
+{
+	raster::image	out	=	raster::open(output);
+	if (stops.empty() || !out.data)	return false;
+
+	std::vector<unsigned char>	lut	=	bake_gradient(stops);
+	const int					w	=	out.width;
+	const int					h	=	out.height;
+	const float					top	=	gradient_steps - 1;
+	const float					c	=	std::cos(angle);
+	const float					s	=	std::sin(angle);
+
+	if (mode == GRADIENT_LINEAR)
+	{
+		// t = (x c + y s - lo) / span; image corners give the range
+		float	lo		=	std::min(0.0f, c * (w - 1))	+	std::min(0.0f, s * (h - 1));
+		float	hi		=	std::max(0.0f, c * (w - 1))	+	std::max(0.0f, s * (h - 1));
+		float	scale	=	hi > lo ? top / (hi - lo) : 0.0f;
+		float	dx		=	c * scale;
+		float	dy		=	s * scale;
+
+		// rows only shift, a horizontal gradient is the same row again and again
+		bool	same	=	std::fabs(dy * (h - 1)) < 0.5f;
+		parallel::for_bands(same ? 1 : h, [&](int, int begin, int end)
+		{
+			for (int y = begin; y < end; ++y)
+			{
+				unsigned char*	dst	=	raster::row(out, y);
+				float			t	=	(y * s - lo) * scale;
+				for (int x = 0; x < w; ++x, t += dx)
+					gradient_pixel(dst + x * 4, lut, t);
+			}
+		});
+
+		if (same)
+			for (int y = 1; y < h; ++y)
+				std::memcpy(raster::row(out, y), raster::row(out, 0), w * 4);
+	}
+	else
+	{
+		// centre of the image, radial reaches 1 at the corners
+		float	cx		=	(w - 1) * 0.5f;
+		float	cy		=	(h - 1) * 0.5f;
+		float	radius	=	std::max(std::sqrt(cx * cx + cy * cy), 1.0f);
+
+		parallel::for_bands(h, [&](int, int begin, int end)
+		{
+			for (int y = begin; y < end; ++y)
+			{
+				unsigned char*	dst		=	raster::row(out, y);
+				float			ry		=	y - cy;
+				float			rx		=	-cx;
+
+				if (mode == GRADIENT_RADIAL)
+				{
+					// squared distance grows by 2 rx + 1 per pixel, ry^2 is fixed for the row
+					float	d2		=	rx * rx + ry * ry;
+					float	k		=	top / radius;
+					for (int x = 0; x < w; ++x, d2 += 2.0f * rx + 1.0f, rx += 1.0f)
+						gradient_pixel(dst + x * 4, lut, std::sqrt(std::max(d2, 0.0f)) * k);
+				}
+				else
+				{
+					// direction rotated back by angle, so angle sets where the stops start
+					float	ux		=	rx * c + ry * s;
+					float	uy		=	ry * c - rx * s;
+					for (int x = 0; x < w; ++x, ux += c, uy -= s)
+						gradient_pixel(dst + x * 4, lut, turn(uy, ux) * top);
+				}
+			}
+		});
+	}
+
+	return	true;
+}
+
+ALLEGRO_BITMAP*
+filters::file_to_img(std::string filename, unsigned int width)
+{
+	std::ifstream	file(filename, std::ios::binary | std::ios::in);
+	if (!file || !width)	return nullptr;
+
+	std::vector<char>	bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	unsigned int		height	=	bytes.size() / width / 3;
+	if (!height)	return nullptr;
+
+	ALLEGRO_BITMAP*	output	=	al_create_bitmap(width, height);
+	if (!output)	return nullptr;
+
+	raster::image	out	=	raster::lock(output, ALLEGRO_LOCK_WRITEONLY);
+	if (!out.data)
+	{
+		al_destroy_bitmap(output);
+		return nullptr;
+	}
+
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		const char*		src	=	&bytes[(std::size_t) y * width * 3];
+		unsigned char*	dst	=	raster::row(out, y);
+		for (unsigned int x = 0; x < width; ++x, src += 3, dst += 4)
+		{
+			dst[0]	=	src[0];
+			dst[1]	=	src[1];
+			dst[2]	=	src[2];
+			dst[3]	=	255;
+		}
+	}
+
+	al_unlock_bitmap(output);
+	return output;
+}
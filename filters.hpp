@@ -1,249 +1,739 @@
-#pragma once
-
-#include <allegro5/allegro.h>
-#include <allegro5/allegro_image.h>
-#include <allegro5/allegro_primitives.h>
-#include <algorithm>
-#include <string>
-#include <random>
-#include <iterator>
-
-/**
- *	funkcje zazwyczaj przyjmują 1 argument (bitmapę do obróbki), ewentualnie
- *	opcjonalny argument, np w przypadku rozmycia jest to ilość iteracji.
- *	zwracają przetworzoną bitmapę (oryginał pozostaje niezmieniony)
-*/
-
-namespace filters
-{
-	namespace perlin
-	{
-		inline float	interpolated_noise_1d(float x);
-		inline float	interpolated_noise_2d(float x, float y);
-		
-		/*
-		 */
-		float
-		perlin_noise_1d(float x);
-
-		/*
-		 */
-		float
-		perlin_noise_2d(float x, float y, float p);
-		
-		/*
-		 *			clouds width,	clouds height,	amplitude
-		 *	ARGS:	unsigned int,	unsigned int,	float
-		 *	RET:	ALLEGRO_BITMAP*
-		 *	Generates clouds using perlin noise.
-		 *	Returns generated clouds image with given resolution.
-		 */
-		ALLEGRO_BITMAP*
-		clouds(unsigned int width, unsigned int height, float p);
-
-		ALLEGRO_BITMAP*
-		heightmap(ALLEGRO_BITMAP* source);
-	}
-
-	/*
-	 *			from	,	to		,	time
-	 *	ARGS:	double	,	double	,	double
-	 *	RET:	double
-	 *	Linear interpolation. Interpolates between two values with given time.
-	 *	Returns interpolated value.
-	 */
-	double
-	lerp(double a, double b, double x);
-
-	/*
-	 *			from	,	to		,	time
-	 *	ARGS:	double	,	double	,	double
-	 *	RET:	double
-	 *	Cosine interpolation. Interpolates between two values with given time.
-	 *	Returns interpolated value.
-	 */
-	double
-	cosrp(double a, double b, double x);
-
-	/*
-	 *			before	,	from	,	to		,	after	,	time
-	 *	ARGS:	double	,	double	,	double	,	double	,	double
-	 *	RET:	double
-	 *	Cubic interpolation. Interpolates between two values with given time.
-	 *	Returns interpolated value.
-	 */	
-	double
-	cubrp(double v0, double v1, double v2, double v3, double x);
-	
-	float	noise_1d(int x);
-	float	noise_2d(int x, int y);
-	float	smooth_noise1d(int x);
-	float	smooth_noise2d(int x, int y);
-
-	/*
-	 *			source bitmap
-	 *	ARGS: 	ALLEGRO_BITMAP*
-	 *	RET:	ALLEGRO_BITMAP*
-	 *	Turns source img to grayscale.
-	 *	Returns grayscale image.
-	 */
-	ALLEGRO_BITMAP*
-	grayscale(ALLEGRO_BITMAP* source);
-
-	/*
-	 *			source bitmap
-	 *	ARGS: 	ALLEGRO_BITMAP*
-	 *	RET:	ALLEGRO_BITMAP*
-	 *	Turns source img to black/white.
-	 *	Returns b/w image.
-	 */
- 	ALLEGRO_BITMAP*
- 	black_white(ALLEGRO_BITMAP* source);
- 	
- 	/*
-	 *			source bitmap	,	# of iterations
- 	 *	ARGS:	ALLEGRO_BITMAP*	, 	[int]
- 	 *	RET:	ALLEGRO_BITMAP*
- 	 *	Gaussian blur using convolution matrix, weights build with Gaussian curve.
- 	 *	Returns blurred image.
-	 */
-	ALLEGRO_BITMAP*
- 	gaussian_blur(ALLEGRO_BITMAP* source, unsigned int n = 1);
-	
-	/*
-	 *			source bitmap	,	# of iterations
- 	 *	ARGS:	ALLEGRO_BITMAP*	, 	[int]
- 	 *	RET:	ALLEGRO_BITMAP*
- 	 *	Gaussian blur using convolution matrix, weights build with Gaussian curve.
- 	 *	Returns blurred image.
-	 */
-	ALLEGRO_BITMAP*
- 	gaussian_blur_optimized(ALLEGRO_BITMAP* source, unsigned int n = 1);
-
- 	/*
-	 *			source bitmap	,	# of iterations	,	# of samples
- 	 *	ARGS:	ALLEGRO_BITMAP*	, 	[int]			,	[int]
- 	 *	RET:	ALLEGRO_BITMAP*
- 	 *	Gaussian blur using convolution matrix, weights build with Gaussian curve.
- 	 *	Optimized with two-pass filter. Returns blurred image.
-	 */
-	ALLEGRO_BITMAP*
-	gaussian_blur_sampling(ALLEGRO_BITMAP* source, unsigned int n = 1, unsigned int samples = 2);
-
- 	/*
-	 *			source bitmap	,	# of iterations
- 	 *	ARGS:	ALLEGRO_BITMAP*	, 	[int]
- 	 *	RET:	ALLEGRO_BITMAP*
- 	 *	Gaussian blur using convolution matrix, weights are . Returns blurred image.
-	 */
-	ALLEGRO_BITMAP*
-	box_blur(ALLEGRO_BITMAP* source, unsigned int n = 1);
-
- 	/*
-	 *			source bitmap	,	# of iterations	,	# of samples
- 	 *	ARGS:	ALLEGRO_BITMAP*	, 	[int]			,	[int]
- 	 *	RET:	ALLEGRO_BITMAP*
- 	 *	Gaussian blur using convolution matrix, weights are .
- 	 *	Optimized by sampling image. Returns blurred image.
-	 */
-	ALLEGRO_BITMAP*
-	box_blur_sampling(ALLEGRO_BITMAP* source, unsigned int n = 1, unsigned int samples = 2);
-	
-	/*
-	 *			background image,	foreground image,	alpha value
- 	 *	ARGS:	ALLEGRO_BITMAP*	, 	ALLEGRO_BITMAP*	,	float
- 	 *	RET:	ALLEGRO_BITMAP*
- 	 *	Blends two images with given alpha. Returns blended image.
-	 */
-	ALLEGRO_BITMAP*
-	alpha_blending(ALLEGRO_BITMAP* background, ALLEGRO_BITMAP* foreground, float alpha);
-
-	/*
-	 *			background image,	foreground image,	grayscale mask
- 	 *	ARGS:	ALLEGRO_BITMAP*	, 	ALLEGRO_BITMAP*	,	ALLEGRO_BITMAP*
- 	 *	RET:	ALLEGRO_BITMAP*
- 	 *	Blends two images basing on grayscale mask. Returns blended image.
-	 */
-	ALLEGRO_BITMAP*
-	alpha_blending(ALLEGRO_BITMAP* background, ALLEGRO_BITMAP* foreground, ALLEGRO_BITMAP* mask);
-
-	/*
-	 *			source image
- 	 *	ARGS:	ALLEGRO_BITMAP*
- 	 *	RET:	ALLEGRO_BITMAP*
- 	 *	Sharpens source image. 
- 	 *	Returns sharpened image
-	 */
-	ALLEGRO_BITMAP*
-	sharpen(ALLEGRO_BITMAP* source);
- 	
-	/*
-	 *			source image	,	light value
- 	 *	ARGS:	ALLEGRO_BITMAP*	,	[int]
- 	 *	RET:	ALLEGRO_BITMAP*
- 	 *	Lighten/darken source image.
- 	 *	Returns image with changed lighting.
-	 */
- 	ALLEGRO_BITMAP*
- 	lighten(ALLEGRO_BITMAP* source, int n = 1);
-	
- 	/*
- 	 *			source image	,	contrast value
- 	 *	ARGS:	ALLEGRO_BITMAP*	,	[float]
- 	 *	RET:	ALLEGRO_BITMAP*
- 	 *	Changes image contrast with given value.
- 	 *	Returns image with changed contrast.
- 	 */
-	ALLEGRO_BITMAP*
-	contrast(ALLEGRO_BITMAP* source, float n = 1.0);
- 	
- 	/*
- 	 *			source image
- 	 *	ARGS:	ALLEGRO_BITMAP*
- 	 *	RET:	ALLEGRO_BITMAP*
- 	 *	Changes source image channels.
- 	 *	Returns image with changed channels.
- 	 */
- 	ALLEGRO_BITMAP*
- 	tint(ALLEGRO_BITMAP* source);
-
- 	/*
- 	 *			source image
- 	 *	ARGS:	ALLEGRO_BITMAP*
- 	 *	RET:	ALLEGRO_BITMAP*
- 	 *	Edge detection using convolution matrix.
- 	 *	Returns edge detected image.
- 	 */
- 	ALLEGRO_BITMAP*
- 	detect_edges(ALLEGRO_BITMAP* source);
-	ALLEGRO_BITMAP*	gradient(	unsigned int width,
-								unsigned int height,
-								ALLEGRO_COLOR from,
-								ALLEGRO_COLOR to);
-	
-	/*
- 	 *			filename of binary file	,	width of output image
- 	 *	ARGS:	std::string				,	unsigned int
- 	 *	RET:	ALLEGRO_BITMAP*
- 	 *	Opens binary file, then takes 3 x 8 bits per pixel.
- 	 *	Returns image made from binary file
-	 */
-	ALLEGRO_BITMAP*
-	file_to_img(std::string filename, unsigned int width);
-	
-	/*
-	 *			source image	,	power of glitch
-	 *	ARGS:	ALLEGRO_BITMAP*	,	unsigned int
-	 *	RET:	ALLEGRO_BITMAP*
-	 *	Glitches image using various effects.
-	 *	Returns glitched image.
-	 */
-	ALLEGRO_BITMAP*
-	glitch(ALLEGRO_BITMAP* source, unsigned int power);
-}
-
-namespace fractals
-{
-	void	draw_circle(int x, int y, float radius, ALLEGRO_BITMAP* background);
-	void	draw_line(int x, int y, float length, ALLEGRO_BITMAP* background);
-}
+#pragma once
+
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_image.h>
+#include <allegro5/allegro_primitives.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <random>
+#include <iterator>
+#include <vector>
+
+/**
+ *	funkcje zazwyczaj przyjmują 1 argument (bitmapę do obróbki), ewentualnie
+ *	opcjonalny argument, np w przypadku rozmycia jest to ilość iteracji.
+ *	zwracają przetworzoną bitmapę (oryginał pozostaje niezmieniony)
+ *
+ *	żadna funkcja nie korzysta z docelowej bitmapy allegro ani jej nie
+ *	zmienia, więc niezależne obrazy można filtrować w wielu wątkach naraz.
+*/
+
+namespace filters
+{
+	/*
+	 *	Threads: every function of filters is reentrant. None reads or sets
+	 *	the target bitmap (al_set_target_bitmap) or any other global state,
+	 *	so calls on different images may run on any threads at once. What
+	 *	callers still have to keep apart:
+	 *	-	bitmaps are locked for the whole call, and a locked bitmap can't
+	 *		be locked again: one bitmap can't go to two calls running at
+	 *		once, not even as a read-only source (the later call fails).
+	 *		Views have no lock, a view only read may be shared freely,
+	 *	-	outputs (returned bitmaps aside) belong to the call until it
+	 *		returns,
+	 *	-	video bitmaps can only be locked on the thread whose display
+	 *		they belong to, memory bitmaps on any thread,
+	 *	-	new bitmaps follow the calling thread's al_set_new_bitmap_*
+	 *		settings,
+	 *	-	a session or pyramid object is used by one thread at a time;
+	 *		cache locks itself and may be shared.
+	 */
+
+	/*
+	 *	What convolution filters read outside of the image:
+	 *	WRAP		-	pixels from the opposite edge,
+	 *	CLAMP		-	nearest edge pixel,
+	 *	MIRROR		-	image reflected at the edge (edge pixel not repeated),
+	 *	CONSTANT	-	given color.
+	 */
+	enum border_mode
+	{
+		BORDER_WRAP,
+		BORDER_CLAMP,
+		BORDER_MIRROR,
+		BORDER_CONSTANT
+	};
+
+	/*
+	 *	How resize computes output pixels:
+	 *	BOX			-	average of covered source area,
+	 *	BILINEAR	-	linear interpolation (lerp),
+	 *	BICUBIC		-	cubic interpolation (cubrp), sharper, may ring a little.
+	 */
+	enum resize_mode
+	{
+		RESIZE_BOX,
+		RESIZE_BILINEAR,
+		RESIZE_BICUBIC
+	};
+
+	/*
+	 *	Shape of gradient:
+	 *	LINEAR		-	colour changes along one direction,
+	 *	RADIAL		-	with distance from the centre,
+	 *	ANGULAR		-	with angle around the centre.
+	 */
+	enum gradient_mode
+	{
+		GRADIENT_LINEAR,
+		GRADIENT_RADIAL,
+		GRADIENT_ANGULAR
+	};
+
+	/*
+	 *	Colour at position 0 - 1 of gradient.
+	 */
+	struct gradient_stop
+	{
+		float			position;
+		ALLEGRO_COLOR	color;
+
+		gradient_stop(float position, ALLEGRO_COLOR color);
+	};
+
+	/*
+	 *			border mode	,	color for BORDER_CONSTANT
+	 *	ARGS:	border_mode	,	[ALLEGRO_COLOR]
+	 *	Border handling passed to convolution filters.
+	 *	Constant color defaults to black.
+	 */
+	struct border
+	{
+		border_mode		mode;
+		unsigned char	color[4];
+
+		border(border_mode mode = BORDER_WRAP);
+		border(border_mode mode, ALLEGRO_COLOR color);
+	};
+
+	/*
+	 *			x	,	y	,	width	,	height	,	bitmap to write into
+	 *	ARGS:	int	,	int	,	int		,	int		,	[ALLEGRO_BITMAP*]
+	 *	Region of interest passed to filters. Only pixels of the region and
+	 *	those its kernel needs around it are read from the source; filters
+	 *	whose pixels depend on the whole image (histograms, bilateral grid,
+	 *	pyramid, glitch) read all of it and write only the region.
+	 *	Without target filtered region is returned as new bitmap of region
+	 *	size. With target region is written into target at the same position
+	 *	and target is returned; target may be the source itself.
+	 *	Default constructed region means whole image, filters then return
+	 *	new bitmap of source size.
+	 */
+	struct region
+	{
+		int				x;
+		int				y;
+		int				width;
+		int				height;
+		ALLEGRO_BITMAP*	target;
+
+		region();
+		region(int x, int y, int width, int height, ALLEGRO_BITMAP* target = nullptr);
+
+		bool	whole() const;
+	};
+
+	/*
+	 *			pixels	,	width	,	height	,	bytes between rows	,	[pixel format]
+	 *	ARGS:	void*	,	int		,	int		,	int					,	[int]
+	 *	Caller's pixel buffer. View overloads of filters read and write it
+	 *	directly: no bitmap is created and nothing is copied in or out.
+	 *	Pitch may be negative for bottom-up buffers. Filters work on
+	 *	ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE (bytes R G B A); single channel
+	 *	views (ALLEGRO_PIXEL_FORMAT_SINGLE_CHANNEL_8, see gray.hpp) are
+	 *	taken where noted, views of other formats are refused.
+	 */
+	struct view
+	{
+		unsigned char*	data;
+		int				width;
+		int				height;
+		int				pitch;
+		int				format;
+
+		view();
+		view(void* data, int width, int height, int pitch, int format = ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE);
+
+		/*
+		 *	Rectangle of the same buffer, clipped to the view; this is
+		 *	how view overloads take a region of interest.
+		 */
+		view	part(int x, int y, int width, int height) const;
+	};
+
+	namespace perlin
+	{
+		inline float	interpolated_noise_1d(float x);
+		inline float	interpolated_noise_2d(float x, float y);
+		
+		/*
+		 */
+		float
+		perlin_noise_1d(float x);
+
+		/*
+		 */
+		float
+		perlin_noise_2d(float x, float y, float p);
+		
+		/*
+		 *			clouds width,	clouds height,	amplitude
+		 *	ARGS:	unsigned int,	unsigned int,	float
+		 *	RET:	ALLEGRO_BITMAP*
+		 *	Generates clouds using perlin noise.
+		 *	Returns generated clouds image with given resolution.
+		 */
+		ALLEGRO_BITMAP*
+		clouds(unsigned int width, unsigned int height, float p);
+
+		/*
+		 *	Colour of given height, heights between stops are interpolated.
+		 */
+		struct color_stop
+		{
+			unsigned char	height;
+			ALLEGRO_COLOR	color;
+
+			color_stop(unsigned char height, ALLEGRO_COLOR color);
+		};
+
+		/*
+		 *			height image	,	region of interest
+		 *	ARGS:	ALLEGRO_BITMAP*	,	[region]
+		 *	RET:	ALLEGRO_BITMAP*
+		 *	Colours heights (red channel, e.g. from clouds) as terrain:
+		 *	blue water up to 85, land from green to red above.
+		 *	Returns coloured map.
+		 */
+		ALLEGRO_BITMAP*
+		heightmap(ALLEGRO_BITMAP* source, region roi = region());
+
+		/*
+		 *			height image	,	palette					,	region of interest
+		 *	ARGS:	ALLEGRO_BITMAP*	,	std::vector<color_stop>	,	[region]
+		 *	RET:	ALLEGRO_BITMAP*
+		 *	Same with own palette. Two stops at neighbouring heights make
+		 *	a sharp edge. Heights below first / above last stop take its colour.
+		 *	Returns coloured map.
+		 */
+		ALLEGRO_BITMAP*
+		heightmap(ALLEGRO_BITMAP* source, const std::vector<color_stop>& stops, region roi = region());
+
+		/*
+		 *	View versions of the above, see the end of filters namespace.
+		 */
+		bool	clouds(const view& output, float p);
+		bool	heightmap(const view& source, const view& output);
+		bool	heightmap(const view& source, const view& output, const std::vector<color_stop>& stops);
+	}
+
+	/*
+	 *			from	,	to		,	time
+	 *	ARGS:	double	,	double	,	double
+	 *	RET:	double
+	 *	Linear interpolation. Interpolates between two values with given time.
+	 *	Returns interpolated value.
+	 */
+	inline double
+	lerp(double a, double b, double x)
+	{
+		return a * (1 - x) + b * x;
+	}
+
+	/*
+	 *			from	,	to		,	time
+	 *	ARGS:	double	,	double	,	double
+	 *	RET:	double
+	 *	Cosine interpolation. Interpolates between two values with given time.
+	 *	Returns interpolated value.
+	 */
+	inline double
+	cosrp(double a, double b, double x)
+	{
+		double 	ft	=	x	*	3.1415927;
+		double	f	=	(1	-	cos(ft))	*	0.5;
+		return	a	*	(1	-	f)	+	b	*	f;
+	}
+
+	/*
+	 *			before	,	from	,	to		,	after	,	time
+	 *	ARGS:	double	,	double	,	double	,	double	,	double
+	 *	RET:	double
+	 *	Cubic interpolation. Interpolates between two values with given time.
+	 *	Returns interpolated value.
+	 */	
+	inline double
+	cubrp(double v0, double v1, double v2, double v3, double x)
+	{
+		double	P	=	(v3	-	v2)	-	(v0	-	v1);
+		double	Q	=	(v0	-	v1)	-	P;
+		double	R	=	v2	-	v0;
+		double	S	=	v1;
+
+		// Horner form, pow(x, 3) and pow(x, 2) cost a library call each
+		return	((P	*	x	+	Q)	*	x	+	R)	*	x	+	S;
+	}
+	
+	float	noise_1d(int x);
+	float	noise_2d(int x, int y);
+	float	smooth_noise1d(int x);
+	float	smooth_noise2d(int x, int y);
+
+	/*
+	 *			source bitmap	,	region of interest
+	 *	ARGS: 	ALLEGRO_BITMAP*	,	[region]
+	 *	RET:	ALLEGRO_BITMAP*
+	 *	Turns source img to grayscale.
+	 *	Returns grayscale image.
+	 */
+	ALLEGRO_BITMAP*
+	grayscale(ALLEGRO_BITMAP* source, region roi = region());
+
+	/*
+	 *			source bitmap	,	region of interest
+	 *	ARGS: 	ALLEGRO_BITMAP*	,	[region]
+	 *	RET:	ALLEGRO_BITMAP*
+	 *	Turns source img to black/white.
+	 *	Returns b/w image.
+	 */
+ 	ALLEGRO_BITMAP*
+ 	black_white(ALLEGRO_BITMAP* source, region roi = region());
+
+	/*
+	 *			source bitmap	,	new width	,	new height	,	interpolation
+	 *	ARGS:	ALLEGRO_BITMAP*	,	int			,	int			,	[resize_mode]
+	 *	RET:	ALLEGRO_BITMAP*
+	 *	Scales source to given size. When shrinking every mode averages all
+	 *	covered pixels, so small images don't alias. Edges are clamped.
+	 *	The only filter without region: output has another size, so a
+	 *	region of source has no place in it; resize a view part instead.
+	 *	Returns resized image, nullptr for empty size.
+	 */
+	ALLEGRO_BITMAP*
+	resize(ALLEGRO_BITMAP* source, int width, int height, resize_mode mode = RESIZE_BILINEAR);
+ 	
+ 	/*
+	 *			source bitmap	,	# of iterations	,	border handling	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	, 	[int]			,	[border]		,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Gaussian blur using convolution matrix, weights build with Gaussian curve.
+ 	 *	Returns blurred image.
+	 */
+	ALLEGRO_BITMAP*
+ 	gaussian_blur(ALLEGRO_BITMAP* source, unsigned int n = 1, border edge = BORDER_WRAP, region roi = region());
+	
+	/*
+	 *			source bitmap	,	# of iterations	,	border handling	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	, 	[int]			,	[border]		,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Gaussian blur using convolution matrix, weights build with Gaussian curve.
+ 	 *	Separable, horizontal passes followed by vertical passes.
+ 	 *	Returns blurred image.
+	 */
+	ALLEGRO_BITMAP*
+ 	gaussian_blur_optimized(ALLEGRO_BITMAP* source, unsigned int n = 1, border edge = BORDER_WRAP, region roi = region());
+
+ 	/*
+	 *			source bitmap	,	blur strength	,	quality			,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	, 	float			,	[unsigned int]	,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Gaussian blur of any strength in about constant time. Image is
+ 	 *	halved (see pyramid.hpp) until remaining sigma is 1 + quality pixels
+ 	 *	of the small level, blurred there and scaled back up.
+ 	 *	sigma = 1.08 * sqrt(n) matches n iterations of gaussian_blur.
+ 	 *	Edges are clamped. Levels depend on the whole image, so with region
+ 	 *	all of it is read and only the region written.
+ 	 *	Returns blurred image.
+	 */
+	ALLEGRO_BITMAP*
+	gaussian_blur_pyramid(ALLEGRO_BITMAP* source, float sigma, unsigned int quality = 1, region roi = region());
+
+ 	/*
+	 *			source bitmap	,	# of iterations	,	# of samples	,	border handling	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	, 	[int]			,	[int]			,	[border]		,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Gaussian blur using convolution matrix, weights build with Gaussian curve.
+ 	 *	Optimized by sampling image: every pixel sums samples taps drawn
+ 	 *	at random from the non-zero weights of the 7x7 matrix, divided by
+ 	 *	the sum of their weights. The original drew from all 49 cells, so
+ 	 *	its corners added nothing and a pixel whose samples all fell on
+ 	 *	zeros divided by zero; results differ from it for that reason.
+ 	 *	Returns blurred image.
+	 */
+	ALLEGRO_BITMAP*
+	gaussian_blur_sampling(ALLEGRO_BITMAP* source, unsigned int n = 1, unsigned int samples = 2, border edge = BORDER_WRAP, region roi = region());
+
+ 	/*
+	 *			source bitmap	,	# of iterations	,	border handling	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	, 	[int]			,	[border]		,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Box blur using convolution matrix, all weights are equal. Returns blurred image.
+	 */
+	ALLEGRO_BITMAP*
+	box_blur(ALLEGRO_BITMAP* source, unsigned int n = 1, border edge = BORDER_WRAP, region roi = region());
+
+ 	/*
+	 *			source bitmap	,	radius		,	border handling	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	, 	[int]		,	[border]		,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Median of (2 radius + 1)^2 neighbourhood per channel, removes noise
+ 	 *	and keeps edges. Cost per pixel is the same for any radius (up to 127).
+ 	 *	Returns denoised image.
+	 */
+	ALLEGRO_BITMAP*
+	median(ALLEGRO_BITMAP* source, unsigned int radius = 1, border edge = BORDER_CLAMP, region roi = region());
+
+ 	/*
+	 *			source bitmap	,	spatial sigma	,	range sigma	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	, 	[float]			,	[float]		,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Edge preserving smoothing: averages pixels up to about spatial sigma
+ 	 *	pixels away whose luma differs by up to about range sigma (0 - 255).
+ 	 *	Computed on bilateral grid downsampled by both sigmas, so cost
+ 	 *	doesn't grow with spatial sigma. The grid covers the whole image,
+ 	 *	with region all of it is read and only the region written.
+ 	 *	Returns smoothed image.
+	 */
+	ALLEGRO_BITMAP*
+	bilateral(ALLEGRO_BITMAP* source, float spatial_sigma = 16.0f, float range_sigma = 20.0f, region roi = region());
+
+ 	/*
+	 *			source bitmap	,	# of iterations	,	# of samples	,	border handling	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	, 	[int]			,	[int]			,	[border]		,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Box blur using convolution matrix, all weights are equal.
+ 	 *	Optimized by sampling image, taps drawn like gaussian_blur_sampling
+ 	 *	(all 9 weights are non-zero, so it draws as the original did).
+ 	 *	Returns blurred image.
+	 */
+	ALLEGRO_BITMAP*
+	box_blur_sampling(ALLEGRO_BITMAP* source, unsigned int n = 1, unsigned int samples = 2, border edge = BORDER_WRAP, region roi = region());
+	
+	/*
+	 *			background image,	foreground image,	alpha value	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	, 	ALLEGRO_BITMAP*	,	float		,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Blends two images with given alpha. Returns blended image.
+	 */
+	ALLEGRO_BITMAP*
+	alpha_blending(ALLEGRO_BITMAP* background, ALLEGRO_BITMAP* foreground, float alpha, region roi = region());
+
+	/*
+	 *			background image,	foreground image,	grayscale mask	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	, 	ALLEGRO_BITMAP*	,	ALLEGRO_BITMAP*	,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Blends two images basing on grayscale mask. Returns blended image.
+	 */
+	ALLEGRO_BITMAP*
+	alpha_blending(ALLEGRO_BITMAP* background, ALLEGRO_BITMAP* foreground, ALLEGRO_BITMAP* mask, region roi = region());
+
+	/*
+	 *			layer image		,	[grayscale mask]	,	[opacity]
+	 *	ARGS:	ALLEGRO_BITMAP*	,	[ALLEGRO_BITMAP*]	,	[float]
+	 *	Single layer for composite. Without mask the whole layer is blended
+	 *	with given opacity, with mask the mask value is scaled by opacity.
+	 */
+	struct layer
+	{
+		ALLEGRO_BITMAP*	image;
+		ALLEGRO_BITMAP*	mask;
+		float			opacity;
+
+		layer(ALLEGRO_BITMAP* image, float opacity = 1.0);
+		layer(ALLEGRO_BITMAP* image, ALLEGRO_BITMAP* mask, float opacity = 1.0);
+	};
+
+	/*
+	 *			background image,	layers, bottom to top	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	, 	std::vector<layer>		,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Blends all layers over background in one pass over memory.
+ 	 *	Same result as chain of alpha_blending calls, without intermediate
+ 	 *	bitmaps. Alpha is 8-bit, masks are read from blue channel.
+ 	 *	Returns composited image, nullptr if sizes differ.
+	 */
+	ALLEGRO_BITMAP*
+	composite(ALLEGRO_BITMAP* background, const std::vector<layer>& layers, region roi = region());
+
+	/*
+	 *			source image	,	border handling	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	,	[border]		,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Sharpens source image. 
+ 	 *	Returns sharpened image
+	 */
+	ALLEGRO_BITMAP*
+	sharpen(ALLEGRO_BITMAP* source, border edge = BORDER_WRAP, region roi = region());
+
+	/*
+	 *			source image	,	blur sigma	,	strength	,	least difference	,	border handling	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	,	[float]		,	[float]		,	[unsigned int]		,	[border]		,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Sharpens source by amount times its difference from gaussian blur
+ 	 *	of given sigma. Channel differences below threshold (0 - 255) are
+ 	 *	not sharpened, so flat noisy areas stay flat. Returns sharpened image.
+	 */
+	ALLEGRO_BITMAP*
+	unsharp_mask(	ALLEGRO_BITMAP* source, float radius = 2.0f, float amount = 1.0f, unsigned int threshold = 0,
+					border edge = BORDER_CLAMP, region roi = region());
+ 	
+	/*
+	 *			source image	,	light value	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	,	[int]		,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Lighten/darken source image.
+ 	 *	Returns image with changed lighting.
+	 */
+ 	ALLEGRO_BITMAP*
+ 	lighten(ALLEGRO_BITMAP* source, int n = 1, region roi = region());
+	
+ 	/*
+ 	 *			source image	,	contrast value	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	,	[float]			,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Changes image contrast with given value.
+ 	 *	Returns image with changed contrast.
+ 	 */
+	ALLEGRO_BITMAP*
+	contrast(ALLEGRO_BITMAP* source, float n = 1.0, region roi = region());
+
+	/*
+	 *	Counts of every value of R, G, B and luma (0.299 R + 0.587 G + 0.114 B).
+	 */
+	struct histogram
+	{
+		std::uint32_t	channel[3][256];
+		std::uint32_t	luma[256];
+		std::uint64_t	pixels;
+	};
+
+	/*
+	 *			source image	,	region of interest
+	 *	ARGS:	ALLEGRO_BITMAP*	,	[region]
+	 *	RET:	histogram
+	 *	Counts pixels in parallel, each thread into its own bins.
+	 */
+	histogram
+	compute_histogram(ALLEGRO_BITMAP* source, region roi = region());
+
+	/*
+	 *			source image	,	table for R, G and B	,	region of interest
+	 *	ARGS:	ALLEGRO_BITMAP*	,	unsigned char[3][256]	,	[region]
+	 *	RET:	ALLEGRO_BITMAP*
+	 *	Replaces every channel value by its table entry.
+	 *	Returns mapped image.
+	 */
+	ALLEGRO_BITMAP*
+	apply_lut(ALLEGRO_BITMAP* source, const unsigned char lut[3][256], region roi = region());
+
+	/*
+	 *			source image	,	ignored part of darkest and brightest pixels	,	region of interest
+	 *	ARGS:	ALLEGRO_BITMAP*	,	[float]											,	[region]
+	 *	RET:	ALLEGRO_BITMAP*
+	 *	Stretches every channel so its range (without clip part of pixels
+	 *	on each end) covers 0 - 255.
+	 *	Returns image with adjusted levels.
+	 */
+	ALLEGRO_BITMAP*
+	auto_levels(ALLEGRO_BITMAP* source, float clip = 0.005f, region roi = region());
+
+	/*
+	 *			source image	,	region of interest
+	 *	ARGS:	ALLEGRO_BITMAP*	,	[region]
+	 *	RET:	ALLEGRO_BITMAP*
+	 *	Histogram equalisation: luma histogram is flattened and the same
+	 *	mapping is applied to R, G and B, so colours don't shift.
+	 *	Returns equalised image.
+	 */
+	ALLEGRO_BITMAP*
+	equalize(ALLEGRO_BITMAP* source, region roi = region());
+
+	/*
+	 *			source image	,	# of tiles across	,	# of tiles down	,	clip limit	,	region of interest
+	 *	ARGS:	ALLEGRO_BITMAP*	,	[int]				,	[int]			,	[float]		,	[region]
+	 *	RET:	ALLEGRO_BITMAP*
+	 *	Contrast limited adaptive histogram equalisation. Every tile is
+	 *	equalised on its own, with histogram bins clipped to limit times
+	 *	the average bin, and mappings of the 4 nearest tiles are blended.
+	 *	Returns equalised image.
+	 */
+	ALLEGRO_BITMAP*
+	clahe(ALLEGRO_BITMAP* source, int tiles_x = 8, int tiles_y = 8, float limit = 2.0f, region roi = region());
+ 	
+ 	/*
+ 	 *			source image	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Changes source image channels.
+ 	 *	Returns image with changed channels.
+ 	 */
+ 	ALLEGRO_BITMAP*
+ 	tint(ALLEGRO_BITMAP* source, region roi = region());
+
+ 	/*
+ 	 *			source image	,	border handling	,	region of interest
+ 	 *	ARGS:	ALLEGRO_BITMAP*	,	[border]		,	[region]
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Edge detection using convolution matrix.
+ 	 *	Returns edge detected image.
+ 	 */
+ 	ALLEGRO_BITMAP*
+ 	detect_edges(ALLEGRO_BITMAP* source, border edge = BORDER_WRAP, region roi = region());
+
+	/*
+	 *			width		,	height		,	left colour		,	right colour
+	 *	ARGS:	unsigned int,	unsigned int,	ALLEGRO_COLOR	,	ALLEGRO_COLOR
+	 *	RET:	ALLEGRO_BITMAP*
+	 *	Horizontal gradient between two colours.
+	 *	Returns gradient image.
+	 */
+	ALLEGRO_BITMAP*	gradient(	unsigned int width,
+								unsigned int height,
+								ALLEGRO_COLOR from,
+								ALLEGRO_COLOR to);
+
+	/*
+	 *			width		,	height		,	colour stops				,	shape			,	angle in radians
+	 *	ARGS:	unsigned int,	unsigned int,	std::vector<gradient_stop>	,	[gradient_mode]	,	[float]
+	 *	RET:	ALLEGRO_BITMAP*
+	 *	Gradient through any number of stops. LINEAR runs along angle
+	 *	(0 is left to right) across the whole image, RADIAL from the centre
+	 *	to the corners, ANGULAR once around the centre starting at angle.
+	 *	Returns gradient image, nullptr without stops.
+	 */
+	ALLEGRO_BITMAP*	gradient(	unsigned int width,
+								unsigned int height,
+								const std::vector<gradient_stop>& stops,
+								gradient_mode mode = GRADIENT_LINEAR,
+								float angle = 0.0f);
+	
+	/*
+ 	 *			filename of binary file	,	width of output image
+ 	 *	ARGS:	std::string				,	unsigned int
+ 	 *	RET:	ALLEGRO_BITMAP*
+ 	 *	Opens binary file, then takes 3 x 8 bits per pixel.
+ 	 *	Returns image made from binary file, nullptr if the file can't
+ 	 *	be read or doesn't hold a whole row.
+	 */
+	ALLEGRO_BITMAP*
+	file_to_img(std::string filename, unsigned int width);
+	
+	/*
+	 *			source image	,	power of glitch	,	random seed		,	region of interest
+	 *	ARGS:	ALLEGRO_BITMAP*	,	unsigned int	,	[unsigned int]	,	[region]
+	 *	RET:	ALLEGRO_BITMAP*
+	 *	Glitches image using various effects.
+	 *	The same seed gives the same glitch.
+	 *	Returns glitched image.
+	 */
+	ALLEGRO_BITMAP*
+	glitch(ALLEGRO_BITMAP* source, unsigned int power, unsigned int seed = 5489, region roi = region());
+
+	/*
+	 *	Filters on views, for buffers owned by the caller. Arguments and
+	 *	results are those of the bitmap versions above, but the result is
+	 *	written into output, which must have the size of source (resize:
+	 *	any size). Region of interest is source.part() and output.part().
+	 *	Point filters may have output == source; the others then work on
+	 *	a copy of source. Border modes treat the view as the whole image.
+	 *	Single channel views are taken as output of grayscale, black_white
+	 *	and perlin::clouds, as source of perlin::heightmap and as mask of
+	 *	alpha_blending.
+	 *	Return false for refused formats or mismatched sizes.
+	 */
+	bool	grayscale(const view& source, const view& output);
+	bool	black_white(const view& source, const view& output);
+	bool	tint(const view& source, const view& output);
+	bool	lighten(const view& source, const view& output, int n = 1);
+	bool	contrast(const view& source, const view& output, float n = 1.0);
+
+	bool	resize(const view& source, const view& output, resize_mode mode = RESIZE_BILINEAR);
+
+	bool	gaussian_blur(const view& source, const view& output, unsigned int n = 1, border edge = BORDER_WRAP);
+	bool	gaussian_blur_optimized(const view& source, const view& output, unsigned int n = 1, border edge = BORDER_WRAP);
+	bool	gaussian_blur_pyramid(const view& source, const view& output, float sigma, unsigned int quality = 1);
+	bool	gaussian_blur_sampling(const view& source, const view& output, unsigned int n = 1, unsigned int samples = 2, border edge = BORDER_WRAP);
+	bool	box_blur(const view& source, const view& output, unsigned int n = 1, border edge = BORDER_WRAP);
+	bool	box_blur_sampling(const view& source, const view& output, unsigned int n = 1, unsigned int samples = 2, border edge = BORDER_WRAP);
+	bool	median(const view& source, const view& output, unsigned int radius = 1, border edge = BORDER_CLAMP);
+	bool	bilateral(const view& source, const view& output, float spatial_sigma = 16.0f, float range_sigma = 20.0f);
+	bool	sharpen(const view& source, const view& output, border edge = BORDER_WRAP);
+	bool	unsharp_mask(	const view& source, const view& output, float radius = 2.0f, float amount = 1.0f,
+							unsigned int threshold = 0, border edge = BORDER_CLAMP);
+	bool	detect_edges(const view& source, const view& output, border edge = BORDER_WRAP);
+
+	bool	alpha_blending(const view& background, const view& foreground, float alpha, const view& output);
+	bool	alpha_blending(const view& background, const view& foreground, const view& mask, const view& output);
+
+	histogram	compute_histogram(const view& source);
+	bool		apply_lut(const view& source, const view& output, const unsigned char lut[3][256]);
+	bool		auto_levels(const view& source, const view& output, float clip = 0.005f);
+	bool		equalize(const view& source, const view& output);
+	bool		clahe(const view& source, const view& output, int tiles_x = 8, int tiles_y = 8, float limit = 2.0f);
+
+	bool	gradient(const view& output, ALLEGRO_COLOR from, ALLEGRO_COLOR to);
+	bool	gradient(	const view& output, const std::vector<gradient_stop>& stops,
+						gradient_mode mode = GRADIENT_LINEAR, float angle = 0.0f);
+
+	bool	glitch(const view& source, const view& output, unsigned int power, unsigned int seed = 5489);
+}
+
+namespace fractals
+{
+	/*
+	 *	Primitives fractals are made of, in bitmap coordinates
+	 *	(pixel centres at +0.5, like Allegro drawing).
+	 */
+	struct circle
+	{
+		float	x;
+		float	y;
+		float	radius;
+	};
+
+	struct segment
+	{
+		float	x0;
+		float	y0;
+		float	x1;
+		float	y1;
+	};
+
+	/*
+	 *			centre		,	radius
+	 *	ARGS:	int, int	,	float
+	 *	RET:	std::vector<circle>
+	 *	Circle with 4 half size circles around, each again, down to radius 8.
+	 *	Generated level by level into one array, no recursion.
+	 */
+	std::vector<circle>		circles(int x, int y, float radius);
+
+	/*
+	 *			left end	,	length
+	 *	ARGS:	int, int	,	float
+	 *	RET:	std::vector<segment>
+	 *	Cantor set: line, 20 px lower its outer thirds, each again,
+	 *	down to length 1.
+	 */
+	std::vector<segment>	lines(int x, int y, float length);
+
+	/*
+	 *			target bitmap	,	primitives				,	colour
+	 *	ARGS:	ALLEGRO_BITMAP*	,	std::vector<circle / segment>,	[ALLEGRO_COLOR]
+	 *	Draws 1 px wide anti-aliased outlines straight into bitmap memory.
+	 *	Bitmap is split into tiles drawn in parallel, every tile draws only
+	 *	primitives touching it.
+	 */
+	void	rasterise(ALLEGRO_BITMAP* target, const std::vector<circle>& shapes, ALLEGRO_COLOR color = al_map_rgb(255, 255, 255));
+	void	rasterise(ALLEGRO_BITMAP* target, const std::vector<segment>& shapes, ALLEGRO_COLOR color = al_map_rgb(255, 255, 255));
+	bool	rasterise(const filters::view& target, const std::vector<circle>& shapes, ALLEGRO_COLOR color = al_map_rgb(255, 255, 255));
+	bool	rasterise(const filters::view& target, const std::vector<segment>& shapes, ALLEGRO_COLOR color = al_map_rgb(255, 255, 255));
+
+	/*
+	 *	Whole fractal drawn in white into background.
+	 */
+	void	draw_circle(int x, int y, float radius, ALLEGRO_BITMAP* background);
+	void	draw_line(int x, int y, float length, ALLEGRO_BITMAP* background);
+}
@@ -0,0 +1,312 @@
+#include "filters.hpp"
+#include "raster.hpp"
+#include "parallel.hpp"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	using filters::raster::image;
+
+	const int	tile_size	=	64;
+
+	/*
+	 *	Source over with coverage 0 - 256 of colour c.
+	 */
+	inline void
+	blend(unsigned char* p, const unsigned char* c, int coverage)
+	{
+		for (int i = 0; i < 4; ++i)
+			p[i]	=	p[i] + (((c[i] - p[i]) * coverage + 128) >> 8);
+	}
+
+	/*
+	 *	Coverage of pixel whose centre is d away from the middle of 1 px
+	 *	wide outline: full on it, falling to zero 1 px away.
+	 */
+	inline int
+	coverage(float d)
+	{
+		return	d < 1.0f ? int((1.0f - d) * 256.0f + 0.5f) : 0;
+	}
+
+	struct tile
+	{
+		int	x0;
+		int	y0;
+		int	x1;
+		int	y1;
+	};
+
+	bool
+	touches(const tile& t, const fractals::circle& c)
+	{
+		// nearest and farthest point of tile must straddle the ring
+		float	nx	=	std::max(t.x0 - c.x, std::max(0.0f, c.x - t.x1));
+		float	ny	=	std::max(t.y0 - c.y, std::max(0.0f, c.y - t.y1));
+		float	fx	=	std::max(std::fabs(t.x0 - c.x), std::fabs(t.x1 - c.x));
+		float	fy	=	std::max(std::fabs(t.y0 - c.y), std::fabs(t.y1 - c.y));
+		float	in	=	c.radius - 1.0f;
+		float	out	=	c.radius + 1.0f;
+
+		return	nx * nx + ny * ny <= out * out	&&	(in <= 0.0f || fx * fx + fy * fy >= in * in);
+	}
+
+	bool
+	touches(const tile& t, const fractals::segment& s)
+	{
+		return	std::min(s.x0, s.x1) - 1.0f <= t.x1	&&	std::max(s.x0, s.x1) + 1.0f >= t.x0	&&
+				std::min(s.y0, s.y1) - 1.0f <= t.y1	&&	std::max(s.y0, s.y1) + 1.0f >= t.y0;
+	}
+
+	/*
+	 *	Ring is drawn row by row, only in the two spans where it crosses
+	 *	the row, so cost follows the outline, not the area.
+	 */
+	void
+	draw(const image& img, const tile& t, const fractals::circle& c, const unsigned char* color)
+	{
+		float	out	=	c.radius + 1.0f;
+		float	in	=	c.radius - 1.0f;
+
+		int	y0	=	std::max(t.y0, int(std::floor(c.y - out)));
+		int	y1	=	std::min(t.y1, int(std::ceil(c.y + out)));
+		for (int y = y0; y < y1; ++y)
+		{
+			float	dy	=	y + 0.5f - c.y;
+			if (std::fabs(dy) >= out)	continue;
+
+			float	wo	=	std::sqrt(out * out - dy * dy);
+			float	wi	=	in > std::fabs(dy) ? std::sqrt(in * in - dy * dy) : 0.0f;
+
+			int	spans[2][2]	=	{	{int(std::floor(c.x - wo)), int(std::ceil(c.x - wi))},
+									{int(std::floor(c.x + wi)), int(std::ceil(c.x + wo))}	};
+			if (spans[0][1] >= spans[1][0])
+				spans[0][1]	=	spans[1][0]	=	spans[1][1];
+
+			unsigned char*	row	=	filters::raster::row(img, y);
+			for (int k = 0; k < 2; ++k)
+				for (int x = std::max(spans[k][0], t.x0); x < std::min(spans[k][1], t.x1); ++x)
+				{
+					float	dx	=	x + 0.5f - c.x;
+					int		a	=	coverage(std::fabs(std::sqrt(dx * dx + dy * dy) - c.radius));
+					if (a)	blend(row + x * 4, color, a);
+				}
+		}
+	}
+
+	void
+	draw(const image& img, const tile& t, const fractals::segment& s, const unsigned char* color)
+	{
+		int	x0	=	std::max(t.x0, int(std::floor(std::min(s.x0, s.x1) - 1.0f)));
+		int	x1	=	std::min(t.x1, int(std::ceil(std::max(s.x0, s.x1) + 1.0f)));
+		int	y0	=	std::max(t.y0, int(std::floor(std::min(s.y0, s.y1) - 1.0f)));
+		int	y1	=	std::min(t.y1, int(std::ceil(std::max(s.y0, s.y1) + 1.0f)));
+
+		float	ex	=	s.x1 - s.x0;
+		float	ey	=	s.y1 - s.y0;
+		float	len	=	ex * ex + ey * ey;
+
+		for (int y = y0; y < y1; ++y)
+		{
+			unsigned char*	row	=	filters::raster::row(img, y);
+			for (int x = x0; x < x1; ++x)
+			{
+				// distance to the nearest point of segment
+				float	px	=	x + 0.5f - s.x0;
+				float	py	=	y + 0.5f - s.y0;
+				float	k	=	len > 0.0f ? std::min(std::max((px * ex + py * ey) / len, 0.0f), 1.0f) : 0.0f;
+				float	dx	=	px - k * ex;
+				float	dy	=	py - k * ey;
+				int		a	=	coverage(std::sqrt(dx * dx + dy * dy));
+				if (a)	blend(row + x * 4, color, a);
+			}
+		}
+	}
+
+	void
+	bounds(const fractals::circle& c, tile& box)
+	{
+		box.x0	=	int(std::floor(c.x - c.radius - 1.0f));
+		box.y0	=	int(std::floor(c.y - c.radius - 1.0f));
+		box.x1	=	int(std::ceil(c.x + c.radius + 1.0f));
+		box.y1	=	int(std::ceil(c.y + c.radius + 1.0f));
+	}
+
+	void
+	bounds(const fractals::segment& s, tile& box)
+	{
+		box.x0	=	int(std::floor(std::min(s.x0, s.x1) - 1.0f));
+		box.y0	=	int(std::floor(std::min(s.y0, s.y1) - 1.0f));
+		box.x1	=	int(std::ceil(std::max(s.x0, s.x1) + 1.0f));
+		box.y1	=	int(std::ceil(std::max(s.y0, s.y1) + 1.0f));
+	}
+
+	/*
+	 *	Every tile gets list of primitives touching it, in array order,
+	 *	then tiles are drawn in parallel. Tiles don't share pixels, so
+	 *	no locking is needed and the result doesn't depend on threads.
+	 */
+	template <typename Shape>
+	void
+	rasterise_tiles(const image& img, const std::vector<Shape>& shapes, ALLEGRO_COLOR color)
+	{
+		unsigned char	rgba[4];
+		al_unmap_rgba(color, &rgba[0], &rgba[1], &rgba[2], &rgba[3]);
+
+		int	tiles_x	=	(img.width + tile_size - 1) / tile_size;
+		int	tiles_y	=	(img.height + tile_size - 1) / tile_size;
+
+		std::vector<tile>				tiles(tiles_x * tiles_y);
+		std::vector<std::vector<int> >	bins(tiles.size());
+		for (int ty = 0; ty < tiles_y; ++ty)
+			for (int tx = 0; tx < tiles_x; ++tx)
+			{
+				tile&	t	=	tiles[ty * tiles_x + tx];
+				t.x0	=	tx * tile_size;
+				t.y0	=	ty * tile_size;
+				t.x1	=	std::min(t.x0 + tile_size, img.width);
+				t.y1	=	std::min(t.y0 + tile_size, img.height);
+			}
+
+		// binning walks only tiles under primitive's bounding box
+		for (std::size_t i = 0; i < shapes.size(); ++i)
+		{
+			tile	box	=	{0, 0, 0, 0};
+			bounds(shapes[i], box);
+			int	tx0	=	std::max(box.x0 / tile_size, 0);
+			int	ty0	=	std::max(box.y0 / tile_size, 0);
+			int	tx1	=	std::min(box.x1 / tile_size, tiles_x - 1);
+			int	ty1	=	std::min(box.y1 / tile_size, tiles_y - 1);
+
+			for (int ty = ty0; ty <= ty1; ++ty)
+				for (int tx = tx0; tx <= tx1; ++tx)
+					if (touches(tiles[ty * tiles_x + tx], shapes[i]))
+						bins[ty * tiles_x + tx].push_back(i);
+		}
+
+		filters::parallel::for_bands(tiles.size(), [&](int, int begin, int end)
+		{
+			for (int t = begin; t < end; ++t)
+				for (std::size_t i = 0; i < bins[t].size(); ++i)
+					draw(img, tiles[t], shapes[bins[t][i]], rgba);
+		}, 1);
+	}
+
+	template <typename Shape>
+	void
+	rasterise_bitmap(ALLEGRO_BITMAP* target, const std::vector<Shape>& shapes, ALLEGRO_COLOR color)
+	{
+		image	img	=	filters::raster::lock(target, ALLEGRO_LOCK_READWRITE);
+		if (!img.data)	return;
+
+		rasterise_tiles(img, shapes, color);
+		al_unlock_bitmap(target);
+	}
+
+	template <typename Shape>
+	bool
+	rasterise_view(const filters::view& target, const std::vector<Shape>& shapes, ALLEGRO_COLOR color)
+	{
+		image	img	=	filters::raster::open(target);
+		if (!img.data)	return false;
+
+		rasterise_tiles(img, shapes, color);
+		return	true;
+	}
+}
+
+std::vector<fractals::circle>
+fractals::circles(int x, int y, float radius)
+{
+	std::vector<circle>	shapes;
+	circle				first	=	{float(x), float(y), radius};
+	shapes.push_back(first);
+
+	// every circle bigger than 8 px gets 4 children; array itself is the work queue.
+	// centres are whole pixels, like int arguments of the old recursion
+	for (std::size_t i = 0; i < shapes.size(); ++i)
+	{
+		circle	c	=	shapes[i];
+		if (c.radius <= 8)	continue;
+
+		float	r	=	c.radius / 2;
+		circle	children[4]	=	{	{float(int(c.x + r)), c.y, r},
+									{float(int(c.x - r)), c.y, r},
+									{c.x, float(int(c.y + r)), r},
+									{c.x, float(int(c.y - r)), r}	};
+		shapes.insert(shapes.end(), children, children + 4);
+	}
+
+	return	shapes;
+}
+
+std::vector<fractals::segment>
+fractals::lines(int x, int y, float length)
+{
+	struct part
+	{
+		int		x;
+		int		y;
+		float	length;
+	};
+
+	std::vector<segment>	shapes;
+	std::vector<part>		parts;
+	part					first	=	{x, y, length};
+	if (length >= 1)	parts.push_back(first);
+
+	for (std::size_t i = 0; i < parts.size(); ++i)
+	{
+		part	p	=	parts[i];
+		segment	s	=	{float(p.x), float(p.y), p.x + p.length, float(p.y)};
+		shapes.push_back(s);
+
+		if (p.length / 3 >= 1)
+		{
+			part	left	=	{p.x, p.y + 20, p.length / 3};
+			part	right	=	{int(p.x + p.length * 2.0 / 3.0), p.y + 20, p.length / 3};
+			parts.push_back(left);
+			parts.push_back(right);
+		}
+	}
+
+	return	shapes;
+}
+
+void
+fractals::rasterise(ALLEGRO_BITMAP* target, const std::vector<circle>& shapes, ALLEGRO_COLOR color)
+{
+	rasterise_bitmap(target, shapes, color);
+}
+
+bool
+fractals::rasterise(const filters::view& target, const std::vector<circle>& shapes, ALLEGRO_COLOR color)
+{
+	return	rasterise_view(target, shapes, color);
+}
+
+void
+fractals::rasterise(ALLEGRO_BITMAP* target, const std::vector<segment>& shapes, ALLEGRO_COLOR color)
+{
+	rasterise_bitmap(target, shapes, color);
+}
+
+bool
+fractals::rasterise(const filters::view& target, const std::vector<segment>& shapes, ALLEGRO_COLOR color)
+{
+	return	rasterise_view(target, shapes, color);
+}
+
+void
+fractals::draw_circle(int x, int y, float radius, ALLEGRO_BITMAP* background)
+{
+	rasterise(background, circles(x, y, radius));
+}
+
+void
+fractals::draw_line(int x, int y, float length, ALLEGRO_BITMAP* background)
+{
+	rasterise(background, lines(x, y, length));
+}
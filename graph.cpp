@@ -0,0 +1,296 @@
+#include "graph.hpp"
+#include "raster.hpp"
+#include "parallel.hpp"
+
+#include <atomic>
+#include <map>
+#include <memory>
+
+namespace
+{
+	/*
+	 *	State of one node during run.
+	 */
+	struct task
+	{
+		std::vector<unsigned char>		buffer;		// intermediate result
+		filters::view					image;
+		std::vector<filters::graph::node>	readers;	// once per edge
+		std::atomic<int>				waiting;	// inputs not done yet
+		std::atomic<int>				unread;		// readers not done yet
+		bool							owned;		// image is buffer
+		bool							ok;
+
+		task()
+			:	waiting(0), unread(0), owned(false), ok(false)
+		{
+		}
+	};
+}
+
+filters::graph::node
+filters::graph::add(const vertex& v)
+{
+	if (v.width <= 0 || v.height <= 0)	return -1;
+	for (std::size_t i = 0; i < v.inputs.size(); ++i)
+		if (v.inputs[i] < 0 || v.inputs[i] >= (node) nodes_.size())
+			return	-1;
+
+	nodes_.push_back(v);
+	return	nodes_.size() - 1;
+}
+
+filters::graph::node
+filters::graph::input(ALLEGRO_BITMAP* bitmap)
+{
+	if (!bitmap)	return -1;
+
+	vertex	v;
+	v.bitmap	=	bitmap;
+	v.width		=	al_get_bitmap_width(bitmap);
+	v.height	=	al_get_bitmap_height(bitmap);
+	return	add(v);
+}
+
+filters::graph::node
+filters::graph::input(const view& image)
+{
+	if (!raster::open(image).data)	return -1;
+
+	vertex	v;
+	v.bitmap	=	nullptr;
+	v.image		=	image;
+	v.width		=	image.width;
+	v.height	=	image.height;
+	return	add(v);
+}
+
+filters::graph::node
+filters::graph::generate(source_fn fn, int width, int height)
+{
+	vertex	v;
+	v.bitmap	=	nullptr;
+	v.fn		=	[fn](const std::vector<view>&, const view& output) { return fn(output); };
+	v.width		=	width;
+	v.height	=	height;
+	return	add(v);
+}
+
+filters::graph::node
+filters::graph::filter(filter_fn fn, node input)
+{
+	if (input < 0 || input >= (node) nodes_.size())	return -1;
+	return	filter(fn, input, nodes_[input].width, nodes_[input].height);
+}
+
+filters::graph::node
+filters::graph::filter(filter_fn fn, node input, int width, int height)
+{
+	vertex	v;
+	v.bitmap	=	nullptr;
+	v.fn		=	[fn](const std::vector<view>& inputs, const view& output) { return fn(inputs[0], output); };
+	v.inputs.push_back(input);
+	v.width		=	width;
+	v.height	=	height;
+	return	add(v);
+}
+
+filters::graph::node
+filters::graph::join(join_fn fn, const std::vector<node>& inputs)
+{
+	if (inputs.empty() || inputs[0] < 0 || inputs[0] >= (node) nodes_.size())	return -1;
+
+	vertex	v;
+	v.bitmap	=	nullptr;
+	v.fn		=	fn;
+	v.inputs	=	inputs;
+	v.width		=	nodes_[inputs[0]].width;
+	v.height	=	nodes_[inputs[0]].height;
+	return	add(v);
+}
+
+int
+filters::graph::width(node n) const
+{
+	return	n >= 0 && n < (node) nodes_.size() ? nodes_[n].width : 0;
+}
+
+int
+filters::graph::height(node n) const
+{
+	return	n >= 0 && n < (node) nodes_.size() ? nodes_[n].height : 0;
+}
+
+std::vector<bool>
+filters::graph::execute(const std::vector<node>& outputs, const std::vector<view>& targets)
+{
+	const int	n	=	nodes_.size();
+
+	// nodes the outputs depend on; inputs are added before their readers,
+	// so one backward sweep finds them all
+	std::vector<bool>	needed(n, false);
+	for (std::size_t i = 0; i < outputs.size(); ++i)
+		if (outputs[i] >= 0 && outputs[i] < n)
+			needed[outputs[i]]	=	true;
+	for (int v = n - 1; v >= 0; --v)
+		if (needed[v])
+			for (std::size_t i = 0; i < nodes_[v].inputs.size(); ++i)
+				needed[nodes_[v].inputs[i]]	=	true;
+
+	std::vector<task>	tasks(n);
+	std::vector<bool>	wanted(n, false);
+
+	// first target of a node receives it directly, later ones get a copy
+	for (std::size_t i = 0; i < outputs.size(); ++i)
+	{
+		if (outputs[i] < 0 || outputs[i] >= n)	continue;
+		wanted[outputs[i]]	=	true;
+		if (!tasks[outputs[i]].image.data)
+			tasks[outputs[i]].image	=	targets[i];
+	}
+
+	// every bitmap is locked once, however many input nodes it has
+	std::map<ALLEGRO_BITMAP*, view>	locked;
+	int								running	=	0;
+	for (int v = 0; v < n; ++v)
+	{
+		if (!needed[v])	continue;
+		const vertex&	vx	=	nodes_[v];
+		task&			t	=	tasks[v];
+
+		if (vx.fn)
+		{
+			++running;
+			for (std::size_t i = 0; i < vx.inputs.size(); ++i)
+			{
+				tasks[vx.inputs[i]].readers.push_back(v);
+				++tasks[vx.inputs[i]].unread;
+				if (nodes_[vx.inputs[i]].fn)
+					++t.waiting;
+			}
+			continue;
+		}
+
+		view	image	=	vx.image;
+		if (vx.bitmap)
+		{
+			if (!locked.count(vx.bitmap))
+				locked[vx.bitmap]	=	raster::view_of(raster::lock(vx.bitmap, ALLEGRO_LOCK_READONLY));
+			image	=	locked[vx.bitmap];
+		}
+
+		// an input wanted as output is copied at the end
+		t.ok	=	image.data != nullptr;
+		t.image	=	image;
+	}
+
+	std::atomic<int>	left(running);
+
+	std::function<void (node)>	start;
+	start	=	[&](node v)
+	{
+		parallel::submit([&, v]()
+		{
+			const vertex&	vx	=	nodes_[v];
+			task&			t	=	tasks[v];
+
+			std::vector<view>	inputs;
+			bool				ok	=	true;
+			for (std::size_t i = 0; i < vx.inputs.size(); ++i)
+			{
+				ok	=	ok && tasks[vx.inputs[i]].ok;
+				inputs.push_back(tasks[vx.inputs[i]].image);
+			}
+
+			if (ok && !t.image.data)
+			{
+				t.buffer.resize((std::size_t) vx.width * vx.height * 4);
+				t.image	=	view(t.buffer.data(), vx.width, vx.height, vx.width * 4, raster::format);
+				t.owned	=	!wanted[v];
+			}
+			t.ok	=	ok && vx.fn(inputs, t.image);
+
+			for (std::size_t i = 0; i < vx.inputs.size(); ++i)
+			{
+				task&	in	=	tasks[vx.inputs[i]];
+				if (--in.unread == 0 && in.owned)
+					std::vector<unsigned char>().swap(in.buffer);
+			}
+
+			for (std::size_t i = 0; i < t.readers.size(); ++i)
+				if (--tasks[t.readers[i]].waiting == 0)
+					start(t.readers[i]);
+
+			if (--left == 0)
+				parallel::notify();
+		});
+	};
+
+	// nodes are started by their last input once any job runs, so ready
+	// ones are all picked before the first is started
+	std::vector<node>	ready;
+	for (int v = 0; v < n; ++v)
+		if (needed[v] && nodes_[v].fn && tasks[v].waiting == 0)
+			ready.push_back(v);
+	for (std::size_t i = 0; i < ready.size(); ++i)
+		start(ready[i]);
+	parallel::wait([&]() { return left == 0; });
+
+	std::vector<bool>	ok(outputs.size(), false);
+	for (std::size_t i = 0; i < outputs.size(); ++i)
+	{
+		if (outputs[i] < 0 || outputs[i] >= n || !tasks[outputs[i]].ok || !targets[i].data)	continue;
+		if (targets[i].data != tasks[outputs[i]].image.data)
+			raster::copy(raster::open(tasks[outputs[i]].image), raster::open(targets[i]));
+		ok[i]	=	true;
+	}
+
+	for (std::map<ALLEGRO_BITMAP*, view>::iterator it = locked.begin(); it != locked.end(); ++it)
+		if (it->second.data)
+			al_unlock_bitmap(it->first);
+	return	ok;
+}
+
+std::vector<ALLEGRO_BITMAP*>
+filters::graph::run(const std::vector<node>& outputs)
+{
+	std::vector<ALLEGRO_BITMAP*>	bitmaps(outputs.size(), nullptr);
+	std::vector<view>				targets(outputs.size());
+	for (std::size_t i = 0; i < outputs.size(); ++i)
+	{
+		if (outputs[i] < 0 || outputs[i] >= (node) nodes_.size())	continue;
+
+		bitmaps[i]	=	al_create_bitmap(nodes_[outputs[i]].width, nodes_[outputs[i]].height);
+		if (!bitmaps[i])	continue;
+		targets[i]	=	raster::view_of(raster::lock(bitmaps[i], ALLEGRO_LOCK_READWRITE));
+	}
+
+	std::vector<bool>	ok	=	execute(outputs, targets);
+
+	for (std::size_t i = 0; i < outputs.size(); ++i)
+	{
+		if (!bitmaps[i])	continue;
+		if (targets[i].data)
+			al_unlock_bitmap(bitmaps[i]);
+		if (!ok[i])
+		{
+			al_destroy_bitmap(bitmaps[i]);
+			bitmaps[i]	=	nullptr;
+		}
+	}
+	return	bitmaps;
+}
+
+ALLEGRO_BITMAP*
+filters::graph::run(node output)
+{
+	return	run(std::vector<node>(1, output))[0];
+}
+
+bool
+filters::graph::run(node output, const view& target)
+{
+	if (!raster::open(target).data || target.width != width(output) || target.height != height(output))
+		return	false;
+	return	execute(std::vector<node>(1, output), std::vector<view>(1, target))[0];
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "filters.hpp"
+
+/**
+ *	graf filtrów: węzły to obrazy wejściowe albo filtry na wynikach
+ *	innych węzłów. niezależne gałęzie liczą się naraz na puli wątków,
+ *	a sploty, filtry punktowe, mediana i mieszanie dzielą jeszcze swój
+ *	obraz na pasy wierszy na tej samej puli.
+ *
+ *	filters::graph			g;
+ *	filters::graph::node	photo	=	g.input(bitmap);
+ *	filters::graph::node	mask	=	g.input(mask_bitmap);
+ *	filters::graph::node	blurred	=	g.filter([](const filters::view& in, const filters::view& out)
+ *										{ return filters::gaussian_blur(in, out, 2); }, photo);
+ *	filters::graph::node	gray	=	g.filter([](const filters::view& in, const filters::view& out)
+ *										{ return filters::grayscale(in, out); }, photo);
+ *	filters::graph::node	both	=	g.join([](const std::vector<filters::view>& in, const filters::view& out)
+ *										{ return filters::alpha_blending(in[0], in[1], in[2], out); }, {blurred, gray, mask});
+ *	ALLEGRO_BITMAP*			result	=	g.run(both);
+*/
+
+namespace filters
+{
+	class graph
+	{
+	public:
+		/*
+		 *	Node of the graph, -1 for a node that couldn't be added.
+		 */
+		typedef	int	node;
+
+		typedef	std::function<bool (const view& output)>									source_fn;
+		typedef	std::function<bool (const view& input, const view& output)>				filter_fn;
+		typedef	std::function<bool (const std::vector<view>& inputs, const view& output)>	join_fn;
+
+		/*
+		 *			image
+		 *	ARGS:	ALLEGRO_BITMAP* / view
+		 *	RET:	node
+		 *	Input of the graph. Not owned; a bitmap is locked read-only
+		 *	on the thread calling run, for the whole run, and read by
+		 *	any number of nodes at once.
+		 */
+		node	input(ALLEGRO_BITMAP* bitmap);
+		node	input(const view& image);
+
+		/*
+		 *			filter		,	width	,	height
+		 *	ARGS:	source_fn	,	int		,	int
+		 *	RET:	node
+		 *	Node with no inputs, e.g. perlin::clouds or gradient.
+		 */
+		node	generate(source_fn fn, int width, int height);
+
+		/*
+		 *			filter		,	input	,	[width	,	height]
+		 *	ARGS:	filter_fn	,	node	,	[int	,	int]
+		 *	RET:	node
+		 *	Node computing fn(input, output). Output has the input's size
+		 *	unless given (resize).
+		 */
+		node	filter(filter_fn fn, node input);
+		node	filter(filter_fn fn, node input, int width, int height);
+
+		/*
+		 *			filter	,	inputs
+		 *	ARGS:	join_fn	,	std::vector<node>
+		 *	RET:	node
+		 *	Node computing fn(inputs, output), e.g. alpha_blending of
+		 *	background, foreground and mask. Output has the first
+		 *	input's size.
+		 */
+		node	join(join_fn fn, const std::vector<node>& inputs);
+
+		/*
+		 *			node(s) wanted
+		 *	ARGS:	node / std::vector<node>
+		 *	RET:	ALLEGRO_BITMAP* / std::vector<ALLEGRO_BITMAP*>
+		 *	Computes nodes the wanted ones depend on, every node once.
+		 *	A node starts when all its inputs are done; buffers of
+		 *	intermediate nodes are freed once their last reader is done.
+		 *	Returns new bitmaps, nullptr for a node whose filter (or any
+		 *	filter before it) failed. Graph may be run again.
+		 */
+		ALLEGRO_BITMAP*					run(node output);
+		std::vector<ALLEGRO_BITMAP*>	run(const std::vector<node>& outputs);
+
+		/*
+		 *			node	,	memory for result
+		 *	ARGS:	node	,	view
+		 *	RET:	bool
+		 *	Like run, writing the result to target of the node's size.
+		 */
+		bool	run(node output, const view& target);
+
+		/*
+		 *			node
+		 *	ARGS:	node
+		 *	RET:	int
+		 *	Size of node's output.
+		 */
+		int	width(node n) const;
+		int	height(node n) const;
+
+	private:
+		struct vertex
+		{
+			ALLEGRO_BITMAP*		bitmap;		// input nodes
+			view				image;		// input nodes
+			join_fn				fn;			// other nodes
+			std::vector<node>	inputs;
+			int					width;
+			int					height;
+		};
+
+		node	add(const vertex& v);
+
+		std::vector<bool>
+		execute(const std::vector<node>& outputs, const std::vector<view>& targets);
+
+		std::vector<vertex>	nodes_;
+	};
+}
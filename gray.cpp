@@ -0,0 +1,214 @@
+#include "gray.hpp"
+#include "parallel.hpp"
+
+namespace
+{
+	using filters::gray::image;
+
+	image
+	empty()
+	{
+		image	img;
+		img.width	=	img.height	=	0;
+		return	img;
+	}
+
+	/*
+	 *	Locks source and calls fn(in, out) with single channel view of
+	 *	a new image of source size. Empty image if anything failed.
+	 */
+	template <typename Fn>
+	image
+	from_locked(ALLEGRO_BITMAP* source, Fn fn)
+	{
+		image	img	=	empty();
+		filters::raster::image	in	=	filters::raster::lock(source, ALLEGRO_LOCK_READONLY);
+		if (!in.data)	return img;
+
+		filters::gray::allocate(img, in.width, in.height);
+		bool	ok	=	fn(filters::raster::view_of(in), filters::gray::view_of(img));
+		al_unlock_bitmap(source);
+		return	ok ? img : empty();
+	}
+}
+
+void
+filters::gray::allocate(image& img, int width, int height)
+{
+	img.width	=	width;
+	img.height	=	height;
+	img.data.resize((std::size_t) width * height);
+}
+
+filters::view
+filters::gray::view_of(const image& img)
+{
+	return	view(const_cast<unsigned char*>(img.data.data()), img.width, img.height, img.width, format);
+}
+
+filters::raster::image
+filters::gray::open(const view& v)
+{
+	raster::image	img	=	{nullptr, 0, 0, 0};
+	if (!v.data || v.format != format || v.width <= 0 || v.height <= 0)	return img;
+
+	img.data	=	v.data;
+	img.width	=	v.width;
+	img.height	=	v.height;
+	img.pitch	=	v.pitch;
+	return img;
+}
+
+bool
+filters::gray::expand(const view& source, const view& output)
+{
+	raster::image	in	=	open(source);
+	raster::image	out	=	raster::open(output);
+	if (!in.data || !out.data || in.width != out.width || in.height != out.height)
+		return	false;
+
+	parallel::for_bands(in.height, [&](int, int begin, int end)
+	{
+		for (int y = begin; y < end; ++y)
+		{
+			const unsigned char*	src	=	raster::row(in, y);
+			unsigned char*			dst	=	raster::row(out, y);
+			for (int x = 0; x < in.width; ++x)
+			{
+				dst[x * 4]	=	dst[x * 4 + 1]	=	dst[x * 4 + 2]	=	src[x];
+				dst[x * 4 + 3]	=	255;
+			}
+		}
+	});
+	return	true;
+}
+
+bool
+filters::gray::extract(const view& source, const view& output, int channel)
+{
+	raster::image	in	=	raster::open(source);
+	raster::image	out	=	open(output);
+	if (!in.data || !out.data || in.width != out.width || in.height != out.height || channel < 0 || channel > 3)
+		return	false;
+
+	parallel::for_bands(in.height, [&](int, int begin, int end)
+	{
+		for (int y = begin; y < end; ++y)
+		{
+			const unsigned char*	src	=	raster::row(in, y) + channel;
+			unsigned char*			dst	=	raster::row(out, y);
+			for (int x = 0; x < in.width; ++x)
+				dst[x]	=	src[x * 4];
+		}
+	});
+	return	true;
+}
+
+filters::gray::image
+filters::gray::from_bitmap(ALLEGRO_BITMAP* source, int channel)
+{
+	return	from_locked(source, [channel](const view& in, const view& out)
+	{
+		return	extract(in, out, channel);
+	});
+}
+
+ALLEGRO_BITMAP*
+filters::gray::to_bitmap(const image& source)
+{
+	if (source.width <= 0 || source.height <= 0)	return nullptr;
+
+	ALLEGRO_BITMAP*	output	=	al_create_bitmap(source.width, source.height);
+	if (!output)	return nullptr;
+
+	raster::image	out	=	raster::lock(output, ALLEGRO_LOCK_WRITEONLY);
+	if (!out.data)
+	{
+		al_destroy_bitmap(output);
+		return nullptr;
+	}
+
+	expand(view_of(source), raster::view_of(out));
+	al_unlock_bitmap(output);
+	return	output;
+}
+
+filters::gray::image
+filters::gray::grayscale(ALLEGRO_BITMAP* source)
+{
+	return	from_locked(source, [](const view& in, const view& out)
+	{
+		return	filters::grayscale(in, out);
+	});
+}
+
+filters::gray::image
+filters::gray::black_white(ALLEGRO_BITMAP* source)
+{
+	return	from_locked(source, [](const view& in, const view& out)
+	{
+		return	filters::black_white(in, out);
+	});
+}
+
+filters::gray::image
+filters::gray::clouds(unsigned int width, unsigned int height, float p)
+{
+	image	img	=	empty();
+	allocate(img, width, height);
+	if (!width || !height || !perlin::clouds(view_of(img), p))
+		return	empty();
+	return	img;
+}
+
+ALLEGRO_BITMAP*
+filters::gray::heightmap(const image& source, const std::vector<perlin::color_stop>& stops)
+{
+	if (source.width <= 0 || source.height <= 0)	return nullptr;
+
+	ALLEGRO_BITMAP*	output	=	al_create_bitmap(source.width, source.height);
+	if (!output)	return nullptr;
+
+	raster::image	out	=	raster::lock(output, ALLEGRO_LOCK_WRITEONLY);
+	bool			ok	=	out.data && perlin::heightmap(view_of(source), raster::view_of(out), stops);
+	if (out.data)	al_unlock_bitmap(output);
+
+	if (!ok)
+	{
+		al_destroy_bitmap(output);
+		return nullptr;
+	}
+	return	output;
+}
+
+ALLEGRO_BITMAP*
+filters::gray::alpha_blending(ALLEGRO_BITMAP* background, ALLEGRO_BITMAP* foreground, const image& mask)
+{
+	const int	img_w	=	al_get_bitmap_width(background);
+	const int	img_h	=	al_get_bitmap_height(background);
+	if (img_w	!=	al_get_bitmap_width(foreground)	||	img_h	!=	al_get_bitmap_height(foreground)	||
+		img_w	!=	mask.width						||	img_h	!=	mask.height)
+		return	nullptr;
+
+	ALLEGRO_BITMAP*	output	=	al_create_bitmap(img_w, img_h);
+	if (!output)	return nullptr;
+
+	// the same bitmap may be both background and foreground, it's locked once
+	raster::image	bg	=	raster::lock(background, ALLEGRO_LOCK_READONLY);
+	raster::image	fg	=	foreground == background ? bg : raster::lock(foreground, ALLEGRO_LOCK_READONLY);
+	raster::image	out	=	raster::lock(output, ALLEGRO_LOCK_WRITEONLY);
+
+	bool	ok	=	bg.data && fg.data && out.data &&
+					filters::alpha_blending(raster::view_of(bg), raster::view_of(fg), view_of(mask), raster::view_of(out));
+
+	if (out.data)								al_unlock_bitmap(output);
+	if (fg.data && foreground != background)	al_unlock_bitmap(foreground);
+	if (bg.data)								al_unlock_bitmap(background);
+
+	if (!ok)
+	{
+		al_destroy_bitmap(output);
+		return nullptr;
+	}
+	return	output;
+}
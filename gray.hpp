@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "filters.hpp"
+#include "raster.hpp"
+
+/**
+ *	obrazy jednokanałowe: jeden bajt na piksel, dla odcieni szarości
+ *	i masek. grayscale, black_white i clouds zapisują je wprost,
+ *	heightmap i alpha_blending je czytają, bez powielania wartości
+ *	na R, G i B. na kolor zamienia się je dopiero gdy trzeba.
+*/
+
+namespace filters
+{
+	namespace gray
+	{
+		/*
+		 *	Pixel format of single channel views: 1 byte per pixel.
+		 */
+		const int	format	=	ALLEGRO_PIXEL_FORMAT_SINGLE_CHANNEL_8;
+
+		/*
+		 *	Single channel image, rows of width bytes one after another.
+		 *	Empty (width == 0) when a function couldn't make it.
+		 */
+		struct image
+		{
+			int							width;
+			int							height;
+			std::vector<unsigned char>	data;
+
+			unsigned char*
+			row(int y)
+			{
+				return	&data[(std::size_t) y * width];
+			}
+
+			const unsigned char*
+			row(int y) const
+			{
+				return	&data[(std::size_t) y * width];
+			}
+		};
+
+		/*
+		 *			image	,	width	,	height
+		 *	ARGS:	image&	,	int		,	int
+		 *	Sizes img, storage is reused when it's big enough.
+		 */
+		void
+		allocate(image& img, int width, int height);
+
+		/*
+		 *			image
+		 *	ARGS:	const image&
+		 *	RET:	view
+		 *	Single channel view of img's pixels, for view overloads of
+		 *	filters. A view of a const image may only be read.
+		 */
+		view
+		view_of(const image& img);
+
+		/*
+		 *			caller's view
+		 *	ARGS:	const view&
+		 *	RET:	raster::image
+		 *	Same memory as raster::image of 1 byte pixels (raster::row
+		 *	applies, raster::pixel doesn't). Returns image with
+		 *	data == nullptr for views of other format or without pixels.
+		 */
+		raster::image
+		open(const view& v);
+
+		/*
+		 *			single channel view	,	RGBA view
+		 *	ARGS:	const view&			,	const view&
+		 *	RET:	bool
+		 *	Writes every value into R, G and B, alpha is 255.
+		 *	Returns false for other formats or mismatched sizes.
+		 */
+		bool
+		expand(const view& source, const view& output);
+
+		/*
+		 *			RGBA view	,	single channel view	,	[channel]
+		 *	ARGS:	const view&	,	const view&			,	[int]
+		 *	RET:	bool
+		 *	Takes one channel (0 - 3 for R, G, B, A) of every pixel, blue
+		 *	by default, the one masks of alpha_blending are read from.
+		 *	Returns false for other formats or mismatched sizes.
+		 */
+		bool
+		extract(const view& source, const view& output, int channel = 2);
+
+		/*
+		 *			source bitmap	,	[channel]
+		 *	ARGS:	ALLEGRO_BITMAP*	,	[int]
+		 *	RET:	image
+		 *	extract of a bitmap, e.g. a mask kept as RGBA.
+		 *	Empty image if bitmap can't be locked.
+		 */
+		image
+		from_bitmap(ALLEGRO_BITMAP* source, int channel = 2);
+
+		/*
+		 *			image
+		 *	ARGS:	const image&
+		 *	RET:	ALLEGRO_BITMAP*
+		 *	New colour bitmap of image (expand), owned by caller.
+		 *	nullptr for empty image.
+		 */
+		ALLEGRO_BITMAP*
+		to_bitmap(const image& source);
+
+		/*
+		 *			source bitmap
+		 *	ARGS:	ALLEGRO_BITMAP*
+		 *	RET:	image
+		 *	filters::grayscale / black_white written as single channel,
+		 *	same values. Empty image if bitmap can't be locked.
+		 */
+		image
+		grayscale(ALLEGRO_BITMAP* source);
+
+		image
+		black_white(ALLEGRO_BITMAP* source);
+
+		/*
+		 *			clouds width,	clouds height,	amplitude
+		 *	ARGS:	unsigned int,	unsigned int,	float
+		 *	RET:	image
+		 *	perlin::clouds written as single channel.
+		 */
+		image
+		clouds(unsigned int width, unsigned int height, float p);
+
+		/*
+		 *			height image,	[palette]
+		 *	ARGS:	const image&,	[std::vector<perlin::color_stop>]
+		 *	RET:	ALLEGRO_BITMAP*
+		 *	perlin::heightmap of single channel heights, default palette
+		 *	without stops. Returns coloured map, nullptr for empty image.
+		 */
+		ALLEGRO_BITMAP*
+		heightmap(const image& source, const std::vector<perlin::color_stop>& stops = std::vector<perlin::color_stop>());
+
+		/*
+		 *			background image,	foreground image,	mask
+		 *	ARGS:	ALLEGRO_BITMAP*	,	ALLEGRO_BITMAP*	,	const image&
+		 *	RET:	ALLEGRO_BITMAP*
+		 *	filters::alpha_blending with single channel mask, whole image.
+		 *	Mask rows are blended straight from the image, nothing is
+		 *	unpacked. Returns blended image, nullptr if sizes differ.
+		 */
+		ALLEGRO_BITMAP*
+		alpha_blending(ALLEGRO_BITMAP* background, ALLEGRO_BITMAP* foreground, const image& mask);
+	}
+}
@@ -0,0 +1,356 @@
+#include "filters.hpp"
+#include "raster.hpp"
+#include "parallel.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	using filters::raster::image;
+	using filters::raster::luma;
+
+	/*
+	 *	Bins of one band. Each thread counts into its own, so there is
+	 *	no sharing of cache lines until the merge.
+	 */
+	struct bins
+	{
+		std::uint32_t	count[4][256];
+	};
+
+	void
+	count_rows(const image& in, int begin, int end, bins& b)
+	{
+		for (int y = begin; y < end; ++y)
+		{
+			const unsigned char*	p	=	filters::raster::row(in, y);
+			for (int x = 0; x < in.width; ++x, p += 4)
+			{
+				++b.count[0][p[0]];
+				++b.count[1][p[1]];
+				++b.count[2][p[2]];
+				++b.count[3][luma(p)];
+			}
+		}
+	}
+
+	filters::histogram
+	count(const image& in)
+	{
+		std::vector<bins>	local(filters::parallel::bands(in.height));
+		std::memset(local.data(), 0, local.size() * sizeof(bins));
+
+		filters::parallel::for_bands(in.height, [&](int band, int begin, int end)
+		{
+			count_rows(in, begin, end, local[band]);
+		});
+
+		filters::histogram	h;
+		std::memset(&h, 0, sizeof(h));
+		for (std::size_t i = 0; i < local.size(); ++i)
+			for (int v = 0; v < 256; ++v)
+			{
+				for (int c = 0; c < 3; ++c)
+					h.channel[c][v]	+=	local[i].count[c][v];
+				h.luma[v]	+=	local[i].count[3][v];
+			}
+
+		h.pixels	=	(std::uint64_t) in.width * in.height;
+		return	h;
+	}
+
+	/*
+	 *	Runs fn(in, out, begin, end) on row bands of in in parallel.
+	 */
+	template <typename Fn>
+	void
+	map_bands(const image& in, const image& out, Fn fn)
+	{
+		filters::parallel::for_bands(in.height, [&](int, int begin, int end)
+		{
+			fn(in, out, begin, end);
+		});
+	}
+
+	void
+	map_lut(const image& in, const image& out, const unsigned char lut[3][256])
+	{
+		map_bands(in, out, [lut](const image& in, const image& out, int begin, int end)
+		{
+			for (int y = begin; y < end; ++y)
+			{
+				const unsigned char*	src	=	filters::raster::row(in, y);
+				unsigned char*			dst	=	filters::raster::row(out, y);
+				for (int x = 0; x < in.width; ++x, src += 4, dst += 4)
+				{
+					dst[0]	=	lut[0][src[0]];
+					dst[1]	=	lut[1][src[1]];
+					dst[2]	=	lut[2][src[2]];
+					dst[3]	=	255;
+				}
+			}
+		});
+	}
+
+	/*
+	 *	Source and output of a view filter, false if refused.
+	 */
+	bool
+	open_pair(const filters::view& source, const filters::view& output, image& in, image& out)
+	{
+		in	=	filters::raster::open(source);
+		out	=	filters::raster::open(output);
+		return	in.data && out.data && in.width == out.width && in.height == out.height;
+	}
+
+	/*
+	 *	Equalising table of one histogram: cumulative count scaled to 0 - 255,
+	 *	starting at the first used value.
+	 */
+	void
+	equalizing_lut(const std::uint32_t* hist, std::uint64_t total, unsigned char* lut)
+	{
+		std::uint64_t	first	=	0;
+		for (int v = 0; v < 256 && !first; ++v)
+			first	=	hist[v];
+
+		std::uint64_t	cdf	=	0;
+		for (int v = 0; v < 256; ++v)
+		{
+			cdf	+=	hist[v];
+			lut[v]	=	total > first	?	(unsigned char) (((cdf - std::min(cdf, first)) * 255 + (total - first) / 2) / (total - first))
+										:	(unsigned char) v;
+		}
+	}
+}
+
+filters::histogram
+filters::compute_histogram(ALLEGRO_BITMAP* source, region roi)
+{
+	histogram	h;
+	std::memset(&h, 0, sizeof(h));
+
+	raster::rect	r	=	raster::clip(roi, al_get_bitmap_width(source), al_get_bitmap_height(source));
+	if (r.w <= 0 || r.h <= 0)	return h;
+
+	image	in	=	raster::lock(source, r, ALLEGRO_LOCK_READONLY);
+	if (!in.data)	return h;
+
+	h	=	count(in);
+	al_unlock_bitmap(source);
+	return	h;
+}
+
+filters::histogram
+filters::compute_histogram(const view& source)
+{
+	histogram	h;
+	std::memset(&h, 0, sizeof(h));
+
+	image	in	=	raster::open(source);
+	if (in.data)	h	=	count(in);
+	return	h;
+}
+
+ALLEGRO_BITMAP*
+filters::apply_lut(ALLEGRO_BITMAP* source, const unsigned char lut[3][256], region roi)
+{
+	return	raster::into_region(source, roi, false, [&](const view& in, const view& out)
+	{
+		return	apply_lut(in, out, lut);
+	});
+}
+
+bool
+filters::apply_lut(const view& source, const view& output, const unsigned char lut[3][256])
+{
+	image	in;
+	image	out;
+	if (!open_pair(source, output, in, out))	return false;
+
+	map_lut(in, out, lut);
+	return	true;
+}
+
+ALLEGRO_BITMAP*
+filters::auto_levels(ALLEGRO_BITMAP* source, float clip, region roi)
+{
+	// levels come from the histogram of the whole image
+	return	raster::into_region(source, roi, true, [&](const view& in, const view& out)
+	{
+		return	auto_levels(in, out, clip);
+	});
+}
+
+bool
+filters::auto_levels(const view& source, const view& output, float clip)
+{
+	image	in;
+	image	out;
+	if (!open_pair(source, output, in, out))	return false;
+
+	histogram		h		=	count(in);
+	std::uint64_t	skip	=	(std::uint64_t) (h.pixels * std::max(clip, 0.0f));
+	unsigned char	lut[3][256];
+
+	for (int c = 0; c < 3; ++c)
+	{
+		int				lo	=	0;
+		int				hi	=	255;
+		std::uint64_t	sum	=	h.channel[c][0];
+		while (lo < 255 && sum <= skip)
+			sum	+=	h.channel[c][++lo];
+
+		sum	=	h.channel[c][255];
+		while (hi > 0 && sum <= skip)
+			sum	+=	h.channel[c][--hi];
+
+		for (int v = 0; v < 256; ++v)
+			lut[c][v]	=	hi > lo	?	(unsigned char) std::min(std::max(((v - lo) * 255 + (hi - lo) / 2) / (hi - lo), 0), 255)
+									:	(unsigned char) v;
+	}
+
+	map_lut(in, out, lut);
+	return	true;
+}
+
+ALLEGRO_BITMAP*
+filters::equalize(ALLEGRO_BITMAP* source, region roi)
+{
+	return	raster::into_region(source, roi, true, [&](const view& in, const view& out)
+	{
+		return	equalize(in, out);
+	});
+}
+
+bool
+filters::equalize(const view& source, const view& output)
+{
+	image	in;
+	image	out;
+	if (!open_pair(source, output, in, out))	return false;
+
+	histogram		h	=	count(in);
+	unsigned char	lut[3][256];
+	equalizing_lut(h.luma, h.pixels, lut[0]);
+	std::memcpy(lut[1], lut[0], 256);
+	std::memcpy(lut[2], lut[0], 256);
+
+	map_lut(in, out, lut);
+	return	true;
+}
+
+ALLEGRO_BITMAP*
+filters::clahe(ALLEGRO_BITMAP* source, int tiles_x, int tiles_y, float limit, region roi)
+{
+	// tiles are laid over the whole image
+	return	raster::into_region(source, roi, true, [&](const view& in, const view& out)
+	{
+		return	clahe(in, out, tiles_x, tiles_y, limit);
+	});
+}
+
+bool
+filters::clahe(const view& source, const view& output, int tiles_x, int tiles_y, float limit)
+{
+	image	in;
+	image	out;
+	if (!open_pair(source, output, in, out))	return false;
+
+	tiles_x	=	std::max(1, std::min(tiles_x, in.width));
+	tiles_y	=	std::max(1, std::min(tiles_y, in.height));
+
+	// one equalising table per tile, tiles are independent so they are counted in parallel
+	std::vector<unsigned char>	luts(tiles_x * tiles_y * 256);
+	parallel::for_bands(tiles_x * tiles_y, [&](int, int begin, int end)
+	{
+		std::uint32_t	hist[256];
+		for (int t = begin; t < end; ++t)
+		{
+			int	tx	=	t % tiles_x;
+			int	ty	=	t / tiles_x;
+			int	x0	=	tx * in.width / tiles_x;
+			int	x1	=	(tx + 1) * in.width / tiles_x;
+			int	y0	=	ty * in.height / tiles_y;
+			int	y1	=	(ty + 1) * in.height / tiles_y;
+
+			std::memset(hist, 0, sizeof(hist));
+			for (int y = y0; y < y1; ++y)
+			{
+				const unsigned char*	p	=	raster::pixel(in, x0, y);
+				for (int x = x0; x < x1; ++x, p += 4)
+					++hist[luma(p)];
+			}
+
+			// clipped counts are spread evenly over all bins
+			std::uint64_t	total	=	(std::uint64_t) (x1 - x0) * (y1 - y0);
+			std::uint32_t	cap		=	std::max<std::uint32_t>(1, (std::uint32_t) (limit * total / 256));
+			std::uint32_t	excess	=	0;
+			for (int v = 0; v < 256; ++v)
+				if (hist[v] > cap)
+				{
+					excess	+=	hist[v] - cap;
+					hist[v]	=	cap;
+				}
+			for (int v = 0; v < 256; ++v)
+				hist[v]	+=	excess / 256 + (v < int(excess % 256) ? 1 : 0);
+
+			equalizing_lut(hist, total, &luts[t * 256]);
+		}
+	}, 1);
+
+	// tile and 8-bit weight of the next tile for every column and row,
+	// pixels between tile centres blend mappings of the 4 nearest tiles
+	std::vector<int>	col0(in.width), col1(in.width), wx(in.width);
+	std::vector<int>	row0(in.height), row1(in.height), wy(in.height);
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		int					n		=	pass ? in.height : in.width;
+		int					tiles	=	pass ? tiles_y : tiles_x;
+		std::vector<int>&	t0		=	pass ? row0 : col0;
+		std::vector<int>&	t1		=	pass ? row1 : col1;
+		std::vector<int>&	w		=	pass ? wy : wx;
+
+		for (int i = 0; i < n; ++i)
+		{
+			float	g	=	(i + 0.5f) * tiles / n - 0.5f;
+			int		k	=	std::min(std::max((int) std::floor(g), 0), tiles - 1);
+			t0[i]	=	k;
+			t1[i]	=	std::min(k + 1, tiles - 1);
+			w[i]	=	(int) (std::min(std::max(g - k, 0.0f), 1.0f) * 256.0f + 0.5f);
+		}
+	}
+
+	map_bands(in, out, [&](const image& in, const image& out, int begin, int end)
+	{
+		for (int y = begin; y < end; ++y)
+		{
+			const unsigned char*	src		=	raster::row(in, y);
+			unsigned char*			dst		=	raster::row(out, y);
+			const unsigned char*	top		=	&luts[row0[y] * tiles_x * 256];
+			const unsigned char*	bottom	=	&luts[row1[y] * tiles_x * 256];
+			int						b		=	wy[y];
+
+			for (int x = 0; x < in.width; ++x, src += 4, dst += 4)
+			{
+				const unsigned char*	tl	=	top		+	col0[x] * 256;
+				const unsigned char*	tr	=	top		+	col1[x] * 256;
+				const unsigned char*	bl	=	bottom	+	col0[x] * 256;
+				const unsigned char*	br	=	bottom	+	col1[x] * 256;
+				int						a	=	wx[x];
+
+				for (int c = 0; c < 3; ++c)
+				{
+					int	v	=	src[c];
+					int	t	=	tl[v] * (256 - a)	+	tr[v] * a;
+					int	u	=	bl[v] * (256 - a)	+	br[v] * a;
+					dst[c]	=	(unsigned char) ((t * (256 - b) + u * b + (1 << 15)) >> 16);
+				}
+				dst[3]	=	255;
+			}
+		}
+	});
+
+	return	true;
+}
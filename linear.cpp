@@ -0,0 +1,394 @@
+#include "linear.hpp"
+#include "raster.hpp"
+#include "parallel.hpp"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	using filters::linear::image;
+
+	const int	strip_width	=	32;
+
+	float
+	srgb_decode(float v)
+	{
+		return	v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float
+	srgb_encode(float v)
+	{
+		return	v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+	}
+
+	const std::uint16_t*
+	decode_table()
+	{
+		static const std::vector<std::uint16_t>	table	=	[]()
+		{
+			std::vector<std::uint16_t>	t(256);
+			for (int v = 0; v < 256; ++v)
+				t[v]	=	(std::uint16_t) (srgb_decode(v / 255.0f) * 65535.0f + 0.5f);
+			return	t;
+		}();
+		return	table.data();
+	}
+
+	const unsigned char*
+	encode_table()
+	{
+		static const std::vector<unsigned char>	table	=	[]()
+		{
+			std::vector<unsigned char>	t(65536);
+			for (int v = 0; v < 65536; ++v)
+				t[v]	=	(unsigned char) (srgb_encode(v / 65535.0f) * 255.0f + 0.5f);
+			return	t;
+		}();
+		return	table.data();
+	}
+
+	/*
+	 *	sRGB values kept at 16 bits, for point filters whose 8-bit
+	 *	versions work on sRGB values: linear light to sRGB and back.
+	 */
+	const std::uint16_t*
+	srgb16_table()
+	{
+		static const std::vector<std::uint16_t>	table	=	[]()
+		{
+			std::vector<std::uint16_t>	t(65536);
+			for (int v = 0; v < 65536; ++v)
+				t[v]	=	(std::uint16_t) (srgb_encode(v / 65535.0f) * 65535.0f + 0.5f);
+			return	t;
+		}();
+		return	table.data();
+	}
+
+	const std::uint16_t*
+	linear16_table()
+	{
+		static const std::vector<std::uint16_t>	table	=	[]()
+		{
+			std::vector<std::uint16_t>	t(65536);
+			for (int v = 0; v < 65536; ++v)
+				t[v]	=	(std::uint16_t) (srgb_decode(v / 65535.0f) * 65535.0f + 0.5f);
+			return	t;
+		}();
+		return	table.data();
+	}
+
+	/*
+	 *	Runs fn(srgb, linear, pixel) for every pixel of img, in bands;
+	 *	srgb and linear are the two tables above.
+	 */
+	template <typename Fn>
+	void
+	map_pixels(image& img, Fn fn)
+	{
+		const std::uint16_t*	srgb	=	srgb16_table();
+		const std::uint16_t*	linear	=	linear16_table();
+		filters::parallel::for_bands(img.height, [&](int, int begin, int end)
+		{
+			for (int y = begin; y < end; ++y)
+			{
+				std::uint16_t*	p	=	img.row(y);
+				for (int x = 0; x < img.width; ++x, p += 4)
+					fn(srgb, linear, p);
+			}
+		});
+	}
+
+	inline std::uint16_t
+	mix(std::uint32_t bg, std::uint32_t fg, std::uint32_t a)
+	{
+		return	(std::uint16_t) ((bg * (65535 - a) + fg * a + 32767) / 65535);
+	}
+
+	/*
+	 *	Blends foreground over background in place, alpha of pixel x of
+	 *	row y from alpha(y, x) in 0 - 65535.
+	 */
+	template <typename Alpha>
+	bool
+	blend(image& background, const image& foreground, Alpha alpha)
+	{
+		if (background.width != foreground.width || background.height != foreground.height)
+			return	false;
+
+		filters::parallel::for_bands(background.height, [&](int, int begin, int end)
+		{
+			for (int y = begin; y < end; ++y)
+			{
+				std::uint16_t*			bg	=	background.row(y);
+				const std::uint16_t*	fg	=	foreground.row(y);
+				for (int x = 0; x < background.width; ++x, bg += 4, fg += 4)
+				{
+					std::uint32_t	a	=	alpha(y, x);
+					bg[0]	=	mix(bg[0], fg[0], a);
+					bg[1]	=	mix(bg[1], fg[1], a);
+					bg[2]	=	mix(bg[2], fg[2], a);
+					bg[3]	=	65535;
+				}
+			}
+		});
+		return	true;
+	}
+
+	/*
+	 *	Convolves count values of line, whose neighbours are stride apart,
+	 *	into out. line starts r neighbours before the first output value.
+	 */
+	inline void
+	convolve_line(const std::uint16_t* line, std::uint16_t* out, int count, int stride, const std::vector<int>& taps)
+	{
+		const int	span	=	taps.size();
+		for (int i = 0; i < count; ++i)
+		{
+			std::uint32_t	acc	=	0;
+			for (int k = 0; k < span; ++k)
+				acc	+=	line[i + k * stride] * (std::uint32_t) taps[k];
+			out[i]	=	(std::uint16_t) ((acc + (1 << 13)) >> 14);
+		}
+	}
+
+	/*
+	 *	n passes of separable kernel. Horizontal passes run row by row,
+	 *	vertical ones on strips of columns copied into a scratch buffer,
+	 *	so each row / strip gets all n passes while it's in cache.
+	 */
+	void
+	separable(image& img, const std::vector<int>& taps, unsigned int n, const filters::border& edge)
+	{
+		const int	w	=	img.width;
+		const int	h	=	img.height;
+		const int	r	=	taps.size() / 2;
+		if (!n || w <= 0 || h <= 0)	return;
+
+		std::uint16_t	constant[4];
+		for (int c = 0; c < 3; ++c)
+			constant[c]	=	filters::linear::to_linear(edge.color[c]);
+		constant[3]	=	edge.color[3] * 257;
+
+		std::vector<int>	xs(w + 2 * r);
+		for (int x = 0; x < w + 2 * r; ++x)
+			xs[x]	=	filters::raster::border_coord(x - r, w, edge.mode);
+
+		std::vector<int>	ys(h + 2 * r);
+		for (int y = 0; y < h + 2 * r; ++y)
+			ys[y]	=	filters::raster::border_coord(y - r, h, edge.mode);
+
+		filters::parallel::for_bands(h, [&](int, int begin, int end)
+		{
+			std::vector<std::uint16_t>	padded((w + 2 * r) * 4);
+			for (int y = begin; y < end; ++y)
+			{
+				std::uint16_t*	row	=	img.row(y);
+				for (unsigned int i = 0; i < n; ++i)
+				{
+					for (int x = 0; x < w + 2 * r; ++x)
+						std::memcpy(&padded[x * 4], xs[x] < 0 ? constant : row + xs[x] * 4, 8);
+					convolve_line(padded.data(), row, w * 4, 4, taps);
+				}
+			}
+		});
+
+		const int	strips	=	(w + strip_width - 1) / strip_width;
+		filters::parallel::for_bands(strips, [&](int, int begin, int end)
+		{
+			std::vector<std::uint16_t>	padded((h + 2 * r) * strip_width * 4);
+			std::vector<std::uint16_t>	strip(h * strip_width * 4);
+			for (int s = begin; s < end; ++s)
+			{
+				int	x0		=	s * strip_width;
+				int	sw		=	std::min(strip_width, w - x0);
+				int	stride	=	sw * 4;
+
+				for (int y = 0; y < h; ++y)
+					std::memcpy(&strip[y * stride], img.row(y) + x0 * 4, stride * 2);
+
+				for (unsigned int i = 0; i < n; ++i)
+				{
+					for (int y = 0; y < h + 2 * r; ++y)
+						for (int x = 0; x < sw; ++x)
+							std::memcpy(&padded[y * stride + x * 4], ys[y] < 0 ? constant : &strip[ys[y] * stride + x * 4], 8);
+					for (int y = 0; y < h; ++y)
+						convolve_line(&padded[y * stride], &strip[y * stride], stride, stride, taps);
+				}
+
+				for (int y = 0; y < h; ++y)
+					std::memcpy(img.row(y) + x0 * 4, &strip[y * stride], stride * 2);
+			}
+		}, 1);
+	}
+}
+
+std::uint16_t
+filters::linear::to_linear(unsigned char value)
+{
+	return	decode_table()[value];
+}
+
+unsigned char
+filters::linear::to_srgb(std::uint16_t value)
+{
+	return	encode_table()[value];
+}
+
+bool
+filters::linear::decode(ALLEGRO_BITMAP* source, image& target)
+{
+	raster::image	in	=	raster::lock(source, ALLEGRO_LOCK_READONLY);
+	if (!in.data)	return false;
+
+	target.width	=	in.width;
+	target.height	=	in.height;
+	target.data.resize((std::size_t) in.width * in.height * 4);
+
+	const std::uint16_t*	table	=	decode_table();
+	parallel::for_bands(in.height, [&](int, int begin, int end)
+	{
+		for (int y = begin; y < end; ++y)
+		{
+			const unsigned char*	src	=	raster::row(in, y);
+			std::uint16_t*			dst	=	target.row(y);
+			for (int x = 0; x < in.width; ++x, src += 4, dst += 4)
+			{
+				dst[0]	=	table[src[0]];
+				dst[1]	=	table[src[1]];
+				dst[2]	=	table[src[2]];
+				dst[3]	=	src[3] * 257;
+			}
+		}
+	});
+
+	al_unlock_bitmap(source);
+	return	true;
+}
+
+filters::linear::image
+filters::linear::decode(ALLEGRO_BITMAP* source)
+{
+	image	img;
+	img.width	=	img.height	=	0;
+	decode(source, img);
+	return	img;
+}
+
+bool
+filters::linear::encode(const image& source, ALLEGRO_BITMAP* target)
+{
+	if (al_get_bitmap_width(target) != source.width || al_get_bitmap_height(target) != source.height)
+		return	false;
+
+	raster::image	out	=	raster::lock(target, ALLEGRO_LOCK_WRITEONLY);
+	if (!out.data)	return false;
+
+	const unsigned char*	table	=	encode_table();
+	parallel::for_bands(source.height, [&](int, int begin, int end)
+	{
+		for (int y = begin; y < end; ++y)
+		{
+			const std::uint16_t*	src	=	source.row(y);
+			unsigned char*			dst	=	raster::row(out, y);
+			for (int x = 0; x < source.width; ++x, src += 4, dst += 4)
+			{
+				dst[0]	=	table[src[0]];
+				dst[1]	=	table[src[1]];
+				dst[2]	=	table[src[2]];
+				dst[3]	=	(src[3] + 128) / 257;
+			}
+		}
+	});
+
+	al_unlock_bitmap(target);
+	return	true;
+}
+
+ALLEGRO_BITMAP*
+filters::linear::encode(const image& source)
+{
+	ALLEGRO_BITMAP*	output	=	al_create_bitmap(source.width, source.height);
+	if (!output)	return nullptr;
+
+	if (!encode(source, output))
+	{
+		al_destroy_bitmap(output);
+		return nullptr;
+	}
+	return	output;
+}
+
+void
+filters::linear::gaussian_blur(image& img, unsigned int n, border edge)
+{
+	const int	weights[7]	=	{5,	32,	100,	100,	100,	32,	5};
+	separable(img, raster::fixed_weights(weights, 7), n, edge);
+}
+
+void
+filters::linear::box_blur(image& img, unsigned int n, border edge)
+{
+	const int	weights[3]	=	{1,	1,	1};
+	separable(img, raster::fixed_weights(weights, 3), n, edge);
+}
+
+void
+filters::linear::lighten(image& img, int n)
+{
+	const int	step	=	n * 257;
+	map_pixels(img, [step](const std::uint16_t* srgb, const std::uint16_t* linear, std::uint16_t* p)
+	{
+		for (int c = 0; c < 3; ++c)
+			p[c]	=	linear[std::min(std::max(srgb[p[c]] + step, 0), 65535)];
+		p[3]	=	65535;
+	});
+}
+
+void
+filters::linear::contrast(image& img, float n)
+{
+	map_pixels(img, [n](const std::uint16_t* srgb, const std::uint16_t* linear, std::uint16_t* p)
+	{
+		for (int c = 0; c < 3; ++c)
+			p[c]	=	linear[(int) std::min(std::max(srgb[p[c]] * n, 0.0f), 65535.0f)];
+		p[3]	=	65535;
+	});
+}
+
+void
+filters::linear::grayscale(image& img)
+{
+	map_pixels(img, [](const std::uint16_t* srgb, const std::uint16_t* linear, std::uint16_t* p)
+	{
+		p[0]	=	p[1]	=	p[2]	=	linear[(srgb[p[0]] + srgb[p[1]] + srgb[p[2]]) / 3];
+		p[3]	=	65535;
+	});
+}
+
+bool
+filters::linear::alpha_blending(image& background, const image& foreground, float alpha)
+{
+	const std::uint32_t	a	=	(std::uint32_t) (std::min(std::max(alpha, 0.0f), 1.0f) * 65535.0f + 0.5f);
+	return	blend(background, foreground, [a](int, int) { return a; });
+}
+
+bool
+filters::linear::alpha_blending(image& background, const image& foreground, const image& mask)
+{
+	if (mask.width != background.width || mask.height != background.height)
+		return	false;
+
+	const std::uint16_t*	srgb	=	srgb16_table();
+	return	blend(background, foreground, [&](int y, int x) { return srgb[mask.row(y)[x * 4 + 2]]; });
+}
+
+bool
+filters::linear::alpha_blending(image& background, const image& foreground, const gray::image& mask)
+{
+	if (mask.width != background.width || mask.height != background.height)
+		return	false;
+
+	return	blend(background, foreground, [&](int y, int x) { return mask.row(y)[x] * 257u; });
+}
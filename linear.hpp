@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "filters.hpp"
+#include "gray.hpp"
+
+/**
+ *	obraz roboczy w liniowym świetle, 16 bitów na kanał.
+ *	bitmapa jest zamieniana raz na początku łańcucha filtrów i raz
+ *	na końcu, przejścia pomiędzy nie tracą precyzji na 8 bitach:
+ *	rozmycia, filtry punktowe i mieszanie działają na tym samym obrazie.
+*/
+
+namespace filters
+{
+	namespace linear
+	{
+		/*
+		 *	Linear light RGBA, 0 - 65535 per channel, channels of pixel
+		 *	next to each other, rows tightly packed. Alpha is linear
+		 *	already, it's only widened.
+		 */
+		struct image
+		{
+			int							width;
+			int							height;
+			std::vector<std::uint16_t>	data;
+
+			std::uint16_t*
+			row(int y)
+			{
+				return	&data[(std::size_t) y * width * 4];
+			}
+
+			const std::uint16_t*
+			row(int y) const
+			{
+				return	&data[(std::size_t) y * width * 4];
+			}
+		};
+
+		/*
+		 *			sRGB value
+		 *	ARGS:	unsigned char
+		 *	RET:	std::uint16_t
+		 *	Linear light of 8-bit sRGB value, from 256 entry table.
+		 */
+		std::uint16_t
+		to_linear(unsigned char value);
+
+		/*
+		 *			linear light
+		 *	ARGS:	std::uint16_t
+		 *	RET:	unsigned char
+		 *	Nearest 8-bit sRGB value, from 65536 entry table.
+		 */
+		unsigned char
+		to_srgb(std::uint16_t value);
+
+		/*
+		 *			source bitmap	,	working image
+		 *	ARGS:	ALLEGRO_BITMAP*	,	image&
+		 *	RET:	bool
+		 *	Converts bitmap into working image. Storage of target is reused
+		 *	when it's big enough, so chains run on a sequence of frames
+		 *	don't allocate. Returns false if bitmap can't be locked.
+		 */
+		bool
+		decode(ALLEGRO_BITMAP* source, image& target);
+
+		image
+		decode(ALLEGRO_BITMAP* source);
+
+		/*
+		 *			working image	,	target bitmap
+		 *	ARGS:	const image&	,	ALLEGRO_BITMAP*
+		 *	RET:	bool
+		 *	Converts working image back into bitmap of the same size.
+		 *	Returns false if sizes differ or bitmap can't be locked.
+		 */
+		bool
+		encode(const image& source, ALLEGRO_BITMAP* target);
+
+		/*
+		 *	Same as above, into a new bitmap owned by caller.
+		 */
+		ALLEGRO_BITMAP*
+		encode(const image& source);
+
+		/*
+		 *			working image	,	# of iterations	,	border handling
+		 *	ARGS:	image&			,	[unsigned int]	,	[border]
+		 *	Separable gaussian_blur_optimized in place. All iterations of a
+		 *	row (then of a strip of columns) run while it's in cache, and
+		 *	nothing is rounded to 8 bits in between.
+		 */
+		void
+		gaussian_blur(image& img, unsigned int n = 1, border edge = BORDER_WRAP);
+
+		/*
+		 *			working image	,	# of iterations	,	border handling
+		 *	ARGS:	image&			,	[unsigned int]	,	[border]
+		 *	Separable 3x3 box_blur in place.
+		 */
+		void
+		box_blur(image& img, unsigned int n = 1, border edge = BORDER_WRAP);
+
+		/*
+		 *			working image	,	[light value]
+		 *	ARGS:	image&			,	[int]
+		 *	filters::lighten in place: n (in 8-bit steps) is added to the
+		 *	sRGB value of every channel, kept at 16 bits, and the result
+		 *	goes back to linear light.
+		 */
+		void
+		lighten(image& img, int n = 1);
+
+		/*
+		 *			working image	,	[contrast value]
+		 *	ARGS:	image&			,	[float]
+		 *	filters::contrast in place, sRGB values times n, 16 bits.
+		 */
+		void
+		contrast(image& img, float n = 1.0);
+
+		/*
+		 *			working image
+		 *	ARGS:	image&
+		 *	filters::grayscale in place, average of sRGB values, 16 bits.
+		 */
+		void
+		grayscale(image& img);
+
+		/*
+		 *			background	,	foreground	,	alpha value / mask
+		 *	ARGS:	image&		,	const image&,	float / const image& / const gray::image&
+		 *	RET:	bool
+		 *	filters::alpha_blending in place on background, mixed in linear
+		 *	light. Mask of a working image is read from its blue channel
+		 *	as sRGB, like the 8-bit mask it was decoded from; a single
+		 *	channel mask is taken as it is. Alpha is set opaque.
+		 *	Returns false if sizes differ.
+		 */
+		bool
+		alpha_blending(image& background, const image& foreground, float alpha);
+
+		bool
+		alpha_blending(image& background, const image& foreground, const image& mask);
+
+		bool
+		alpha_blending(image& background, const image& foreground, const gray::image& mask);
+	}
+}
@@ -1,48 +1,136 @@
-#include <allegro5/allegro.h>
-#include <allegro5/allegro_image.h>
-#include <string>
-#include <iostream>
-#include <chrono>
-#include <fstream>
-
-#include "filters.hpp"
-
-/*
- * jak korzystać programu: w linuxie jest prosto, nazwę pliku do obróbki
- * należy podać jako argument programu np: ./main nazwa_pliku.jpg
- * na windowsie pewnie trzeba jakoś nawigować do folderu ze skompilowanym
- * programem i włączyć analogicznie. jeśli to się nie powiedzie to
- * można wpisać nazwę pliku w kodzie przy wywołaniu funkcji al_load_bitmap(char*);
- * Do działania wymagana jest biblioteka Allegro5.
- * Wywołanie funkcji ogranicza się do filters::nazwa_funkcji(ALLEGRO_BITMAP*);
- * Allegro obsługuje tylko niektóre rozszerzenia plików: BMP, PCX, TGA, JPEG, PNG
- */
-
-int main(int argc, char const *argv[])
-{
-	// wzór do losowania zmiennej p
-	//1.0 / ((filters::noise_1d(rand()) + 1) / 2.0 + 1
-	// inicjalizacja biblioteki
-	al_init();
-	al_init_image_addon();
-	al_init_primitives_addon();
-
-	std::chrono::system_clock::time_point	start_timer;
-	std::chrono::system_clock::time_point	end_timer;
-
-	ALLEGRO_BITMAP*	source		=	al_load_bitmap(argv[1]);
-	start_timer	=	std::chrono::high_resolution_clock::now();
-	ALLEGRO_BITMAP*	output		=	filters::gaussian_blur_optimized(source, 2);
-	end_timer	=	std::chrono::high_resolution_clock::now();
-	std::cout	<<	std::chrono::duration_cast<std::chrono::seconds>(end_timer - start_timer).count()	<<	std::endl;
-
-	start_timer	=	std::chrono::high_resolution_clock::now();
-	ALLEGRO_BITMAP*	gauss_old	=	filters::gaussian_blur(source, 2);
-	end_timer	=	std::chrono::high_resolution_clock::now();
-	std::cout	<<	std::chrono::duration_cast<std::chrono::seconds>(end_timer - start_timer).count()	<<	std::endl;
-	
-	al_save_bitmap("gauss.jpg", output);
-	al_save_bitmap("gauss_old.jpg", gauss_old);
-
-	return 0;
-}
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_image.h>
+#include <string>
+#include <iostream>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include "filters.hpp"
+#include "stream.hpp"
+
+/*
+ * jak korzystać programu: w linuxie jest prosto, nazwę pliku do obróbki
+ * należy podać jako argument programu np: ./main nazwa_pliku.jpg
+ * na windowsie pewnie trzeba jakoś nawigować do folderu ze skompilowanym
+ * programem i włączyć analogicznie. jeśli to się nie powiedzie to
+ * można wpisać nazwę pliku w kodzie przy wywołaniu funkcji al_load_bitmap(char*);
+ * Do działania wymagana jest biblioteka Allegro5.
+ * Wywołanie funkcji ogranicza się do filters::nazwa_funkcji(ALLEGRO_BITMAP*);
+ * Allegro obsługuje tylko niektóre rozszerzenia plików: BMP, PCX, TGA, JPEG, PNG
+ *
+ * tryb strumienia: ./main stream y4m|SZEROKOŚĆxWYSOKOŚĆ [filtr wartość]...
+ * czyta klatki z stdin, pisze je na stdout, np:
+ * ffmpeg -i film.mp4 -f yuv4mpegpipe - | ./main stream y4m gauss 2 lighten 10 > wynik.y4m
+ * filtry: gauss N, box N, lighten N, contrast X
+ */
+
+/*
+ *	Most passes gauss and box take in stream mode.
+ */
+const double	max_stream_passes	=	1000.0;
+
+/*
+ *	Prints stream mode usage. Returns process exit code.
+ */
+int
+stream_usage(char const *program)
+{
+	std::cerr	<<	"usage: "	<<	program	<<	" stream y4m|WIDTHxHEIGHT [filter value]..."	<<	std::endl;
+	std::cerr	<<	"gauss and box take 0 - "	<<	max_stream_passes	<<	" passes"	<<	std::endl;
+	return 1;
+}
+
+/*
+ *	Stream mode: parses frame format and filter chain from arguments,
+ *	filters stdin to stdout. Returns process exit code.
+ */
+int
+stream_main(int argc, char const *argv[])
+{
+	if (argc < 3)	return stream_usage(argv[0]);
+
+	filters::stream::frame_format	format	=	filters::stream::FRAME_Y4M;
+	int								width	=	0;
+	int								height	=	0;
+	if (std::string(argv[2]) != "y4m")
+	{
+		format	=	filters::stream::FRAME_RGB;
+		if (std::sscanf(argv[2], "%dx%d", &width, &height) != 2)
+		{
+			std::cerr	<<	"bad frame size: "	<<	argv[2]	<<	std::endl;
+			return 1;
+		}
+	}
+
+	filters::stream::chain	chain;
+	for (int i = 3; i + 1 < argc; i += 2)
+	{
+		std::string	name	=	argv[i];
+		double		value	=	std::atof(argv[i + 1]);
+		// pass counts are unsigned, a negative one would wrap to billions
+		if ((name == "gauss" || name == "box") && !(value >= 0.0 && value <= max_stream_passes))
+			return stream_usage(argv[0]);
+
+		if (name == "gauss")			chain.gaussian_blur(value);
+		else if (name == "box")			chain.box_blur(value);
+		else if (name == "lighten")		chain.lighten(value);
+		else if (name == "contrast")	chain.contrast(value);
+		else
+		{
+			std::cerr	<<	"unknown filter: "	<<	name	<<	std::endl;
+			return 1;
+		}
+	}
+
+#ifdef _WIN32
+	_setmode(_fileno(stdin), _O_BINARY);
+	_setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+	long	frames	=	filters::stream::run(stdin, stdout, chain, format, width, height);
+	if (frames < 0)
+	{
+		std::cerr	<<	"bad stream header or frame size"	<<	std::endl;
+		return 1;
+	}
+	std::cerr	<<	frames	<<	" frames"	<<	std::endl;
+	return 0;
+}
+
+int main(int argc, char const *argv[])
+{
+	if (argc > 1 && std::string(argv[1]) == "stream")
+		return	stream_main(argc, argv);
+
+	// wzór do losowania zmiennej p
+	//1.0 / ((filters::noise_1d(rand()) + 1) / 2.0 + 1
+	// inicjalizacja biblioteki
+	al_init();
+	al_init_image_addon();
+	al_init_primitives_addon();
+
+	std::chrono::system_clock::time_point	start_timer;
+	std::chrono::system_clock::time_point	end_timer;
+
+	ALLEGRO_BITMAP*	source		=	al_load_bitmap(argv[1]);
+	start_timer	=	std::chrono::high_resolution_clock::now();
+	ALLEGRO_BITMAP*	output		=	filters::gaussian_blur_optimized(source, 2);
+	end_timer	=	std::chrono::high_resolution_clock::now();
+	std::cout	<<	std::chrono::duration_cast<std::chrono::seconds>(end_timer - start_timer).count()	<<	std::endl;
+
+	start_timer	=	std::chrono::high_resolution_clock::now();
+	ALLEGRO_BITMAP*	gauss_old	=	filters::gaussian_blur(source, 2);
+	end_timer	=	std::chrono::high_resolution_clock::now();
+	std::cout	<<	std::chrono::duration_cast<std::chrono::seconds>(end_timer - start_timer).count()	<<	std::endl;
+	
+	al_save_bitmap("gauss.jpg", output);
+	al_save_bitmap("gauss_old.jpg", gauss_old);
+
+	return 0;
+}
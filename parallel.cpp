@@ -0,0 +1,237 @@
+#include "parallel.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+	typedef	std::function<void ()>	job;
+
+	// index of pool worker running on this thread, -1 for other threads
+	thread_local int	worker	=	-1;
+
+	/*
+	 *	Deque of one worker. Its owner pushes and pops at the back,
+	 *	thieves take from the front.
+	 */
+	struct queue
+	{
+		std::mutex			mutex;
+		std::deque<job>		jobs;
+	};
+
+	class pool
+	{
+	public:
+		pool()
+			:	pending_(0), stop_(false)
+		{
+			int	n	=	filters::parallel::threads();
+			for (int i = 0; i < n; ++i)
+				queues_.push_back(std::unique_ptr<queue>(new queue));
+			for (int i = 0; i < n; ++i)
+				workers_.push_back(std::thread(&pool::work, this, i));
+		}
+
+		~pool()
+		{
+			{
+				std::lock_guard<std::mutex>	guard(mutex_);
+				stop_	=	true;
+			}
+			wake_.notify_all();
+			for (std::size_t i = 0; i < workers_.size(); ++i)
+				workers_[i].join();
+		}
+
+		void
+		submit(job j)
+		{
+			if (worker >= 0)
+			{
+				std::lock_guard<std::mutex>	guard(queues_[worker]->mutex);
+				queues_[worker]->jobs.push_back(std::move(j));
+			}
+			else
+			{
+				std::lock_guard<std::mutex>	guard(mutex_);
+				shared_.push_back(std::move(j));
+			}
+
+			++pending_;
+			notify(false);
+		}
+
+		/*
+		 *	Wakes sleepers: one for a new job, all when something finished.
+		 *	Taking the mutex orders this after a sleeper's last check.
+		 */
+		void
+		notify(bool all)
+		{
+			{
+				std::lock_guard<std::mutex>	guard(mutex_);
+			}
+			if (all)	wake_.notify_all();
+			else		wake_.notify_one();
+		}
+
+		void
+		wait(const std::function<bool ()>& done)
+		{
+			while (!done())
+			{
+				job	j;
+				if (take(j))
+				{
+					j();
+					continue;
+				}
+
+				std::unique_lock<std::mutex>	lock(mutex_);
+				wake_.wait(lock, [&]() { return pending_ > 0 || done(); });
+			}
+		}
+
+	private:
+		/*
+		 *	Newest job of own deque, else oldest shared one, else oldest
+		 *	job of the next worker that has any.
+		 */
+		bool
+		take(job& j)
+		{
+			const int	n	=	queues_.size();
+			if (worker >= 0)
+			{
+				std::lock_guard<std::mutex>	guard(queues_[worker]->mutex);
+				if (!queues_[worker]->jobs.empty())
+				{
+					j	=	std::move(queues_[worker]->jobs.back());
+					queues_[worker]->jobs.pop_back();
+					--pending_;
+					return	true;
+				}
+			}
+
+			{
+				std::lock_guard<std::mutex>	guard(mutex_);
+				if (!shared_.empty())
+				{
+					j	=	std::move(shared_.front());
+					shared_.pop_front();
+					--pending_;
+					return	true;
+				}
+			}
+
+			for (int i = 1; i <= n; ++i)
+			{
+				queue&	victim	=	*queues_[(worker + i + n) % n];
+				std::lock_guard<std::mutex>	guard(victim.mutex);
+				if (!victim.jobs.empty())
+				{
+					j	=	std::move(victim.jobs.front());
+					victim.jobs.pop_front();
+					--pending_;
+					return	true;
+				}
+			}
+			return	false;
+		}
+
+		// workers leave only once stopped and out of jobs, so jobs queued
+		// by other jobs during shutdown still run
+		void
+		work(int self)
+		{
+			worker	=	self;
+			for (;;)
+			{
+				job	j;
+				if (take(j))
+				{
+					j();
+					continue;
+				}
+
+				std::unique_lock<std::mutex>	lock(mutex_);
+				if (stop_ && pending_ <= 0)	return;
+				wake_.wait(lock, [this]() { return stop_ || pending_ > 0; });
+			}
+		}
+
+		std::vector<std::unique_ptr<queue> >	queues_;
+		std::deque<job>							shared_;
+		std::atomic<int>						pending_;
+		std::mutex								mutex_;
+		std::condition_variable					wake_;
+		bool									stop_;
+		std::vector<std::thread>				workers_;
+	};
+
+	pool&
+	instance()
+	{
+		static pool	workers;
+		return	workers;
+	}
+
+	/*
+	 *	Bands of one run_bands call. Bands are claimed by number, so
+	 *	the caller and helper jobs take them in any mix; helpers that
+	 *	come late find none left and return.
+	 */
+	struct bands_state
+	{
+		std::atomic<int>	next;
+		std::atomic<int>	left;
+	};
+}
+
+void
+filters::parallel::submit(std::function<void ()> job)
+{
+	instance().submit(std::move(job));
+}
+
+void
+filters::parallel::wait(const std::function<bool ()>& done)
+{
+	instance().wait(done);
+}
+
+void
+filters::parallel::notify()
+{
+	instance().notify(true);
+}
+
+void
+filters::parallel::run_bands(int count, int n, const std::function<void (int, int, int)>& fn)
+{
+	std::shared_ptr<bands_state>	state	=	std::make_shared<bands_state>();
+	state->next	=	0;
+	state->left	=	n;
+
+	// fn is only touched for a claimed band, which keeps run_bands waiting
+	const std::function<void (int, int, int)>*	work	=	&fn;
+	auto	claim	=	[state, work, count, n]()
+	{
+		for (int band = state->next++; band < n; band = state->next++)
+		{
+			(*work)(band, int((long long) count * band / n), int((long long) count * (band + 1) / n));
+			if (--state->left == 0)
+				filters::parallel::notify();
+		}
+	};
+
+	for (int i = 1; i < n; ++i)
+		submit(claim);
+	claim();
+
+	wait([&]() { return state->left == 0; });
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/**
+ *	dzielenie pracy na pasy wierszy liczone w osobnych wątkach.
+ *	każdy pas dostaje swój numer, więc może mieć prywatne bufory.
+ *	pasy i zadania asynchroniczne idą do wspólnej puli wątków biblioteki,
+ *	wolne wątki podkradają zadania z kolejek zajętych.
+*/
+
+namespace filters
+{
+	namespace parallel
+	{
+		/*
+		 *	Number of threads work is split into, at least 1.
+		 */
+		inline int
+		threads()
+		{
+			return	std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		/*
+		 *			# of items	,	least items per band
+		 *	ARGS:	int			,	[int]
+		 *	RET:	int
+		 *	Number of bands for_bands splits count items into.
+		 */
+		inline int
+		bands(int count, int grain = 16)
+		{
+			return	std::max(1, std::min(threads(), count / std::max(grain, 1)));
+		}
+
+		/*
+		 *			job
+		 *	ARGS:	std::function<void ()>
+		 *	Queues job on the library's pool of threads() workers, started
+		 *	on first use. A worker keeps jobs it queues on its own deque and
+		 *	runs the newest first; idle workers steal the oldest job of
+		 *	another, jobs from other threads go to a shared queue.
+		 *	Jobs still queued when the program exits are run before workers
+		 *	are joined.
+		 */
+		void
+		submit(std::function<void ()> job);
+
+		/*
+		 *			condition
+		 *	ARGS:	std::function<bool ()>
+		 *	Returns once done() is true, running queued jobs meanwhile, so
+		 *	a job may wait for jobs it queued. Whoever makes done() true
+		 *	calls notify().
+		 */
+		void
+		wait(const std::function<bool ()>& done);
+
+		void
+		notify();
+
+		/*
+		 *			# of items	,	# of bands	,	work
+		 *	ARGS:	int			,	int			,	std::function
+		 *	for_bands without the split: n > 1 bands.
+		 */
+		void
+		run_bands(int count, int n, const std::function<void (int, int, int)>& fn);
+
+		/*
+		 *			# of items	,	work		,	least items per band
+		 *	ARGS:	int			,	Fn			,	[int]
+		 *	Calls fn(band, begin, end) for bands(count, grain) contiguous
+		 *	bands of [0, count). Bands are jobs of the pool, the calling
+		 *	thread takes bands too, so for_bands inside a band or a pool job
+		 *	shares the same workers. Returns when all bands are done.
+		 */
+		template <typename Fn>
+		void
+		for_bands(int count, Fn fn, int grain = 16)
+		{
+			int	n	=	bands(count, grain);
+			if (n == 1)
+			{
+				fn(0, 0, count);
+				return;
+			}
+
+			run_bands(count, n, fn);
+		}
+	}
+}
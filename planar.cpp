@@ -0,0 +1,543 @@
+#include "planar.hpp"
+#include "parallel.hpp"
+#include "cpu.hpp"
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef FILTERS_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	using filters::planar::image;
+
+	/*
+	 *	Plane row pointers moved x pixels on, for the tail of a row.
+	 */
+	struct plane_rows
+	{
+		unsigned char*	data[4];
+	};
+
+	inline plane_rows
+	planes_at(unsigned char* const* planes, int channels, int x)
+	{
+		plane_rows	rows	=	{{nullptr, nullptr, nullptr, nullptr}};
+		for (int i = 0; i < channels; ++i)
+			rows.data[i]	=	planes[i] + x;
+		return	rows;
+	}
+
+	/*
+	 *	One row of count pixels into up to 4 plane rows.
+	 */
+	void
+	split_row_sse2(const unsigned char* src, unsigned char* const* planes, int channels, int count)
+	{
+		int	x	=	0;
+#ifdef __SSE2__
+		// three rounds of byte unpacks halve the distance between values
+		// of a channel, 64-bit unpacks then join the halves of each plane
+		for (; x + 16 <= count; x += 16)
+		{
+			__m128i	p0	=	_mm_loadu_si128((const __m128i*) (src + x * 4));
+			__m128i	p1	=	_mm_loadu_si128((const __m128i*) (src + x * 4 + 16));
+			__m128i	p2	=	_mm_loadu_si128((const __m128i*) (src + x * 4 + 32));
+			__m128i	p3	=	_mm_loadu_si128((const __m128i*) (src + x * 4 + 48));
+
+			__m128i	t0	=	_mm_unpacklo_epi8(p0, p1);
+			__m128i	t1	=	_mm_unpackhi_epi8(p0, p1);
+			__m128i	t2	=	_mm_unpacklo_epi8(p2, p3);
+			__m128i	t3	=	_mm_unpackhi_epi8(p2, p3);
+
+			__m128i	u0	=	_mm_unpacklo_epi8(t0, t1);
+			__m128i	u1	=	_mm_unpackhi_epi8(t0, t1);
+			__m128i	u2	=	_mm_unpacklo_epi8(t2, t3);
+			__m128i	u3	=	_mm_unpackhi_epi8(t2, t3);
+
+			// R and G of 8 pixels, then B and A
+			__m128i	w0	=	_mm_unpacklo_epi8(u0, u1);
+			__m128i	w1	=	_mm_unpackhi_epi8(u0, u1);
+			__m128i	w2	=	_mm_unpacklo_epi8(u2, u3);
+			__m128i	w3	=	_mm_unpackhi_epi8(u2, u3);
+
+			__m128i	c[4]	=	{	_mm_unpacklo_epi64(w0, w2),	_mm_unpackhi_epi64(w0, w2),
+									_mm_unpacklo_epi64(w1, w3),	_mm_unpackhi_epi64(w1, w3)	};
+			for (int i = 0; i < channels; ++i)
+				_mm_storeu_si128((__m128i*) (planes[i] + x), c[i]);
+		}
+#endif
+		for (; x < count; ++x)
+			for (int i = 0; i < channels; ++i)
+				planes[i][x]	=	src[x * 4 + i];
+	}
+
+#ifdef FILTERS_DISPATCH
+	/*
+	 *	split_row, 32 pixels at once. pshufb gathers every channel of 4
+	 *	pixels into one dword of a lane, a dword permute puts 8 pixels of
+	 *	a channel into one qword, and a 4x4 qword transpose makes planes.
+	 */
+	FILTERS_AVX2 void
+	split_row_avx2(const unsigned char* src, unsigned char* const* planes, int channels, int count)
+	{
+		const __m256i	mask	=	_mm256_setr_epi8(	0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+														0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+		const __m256i	order	=	_mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+		int	x	=	0;
+		for (; x + 32 <= count; x += 32)
+		{
+			__m256i	q[4];
+			for (int i = 0; i < 4; ++i)
+				q[i]	=	_mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*) (src + x * 4 + i * 32)), mask), order);
+
+			// R and B of 16 pixels, then G and A
+			__m256i	lo01	=	_mm256_unpacklo_epi64(q[0], q[1]);
+			__m256i	hi01	=	_mm256_unpackhi_epi64(q[0], q[1]);
+			__m256i	lo23	=	_mm256_unpacklo_epi64(q[2], q[3]);
+			__m256i	hi23	=	_mm256_unpackhi_epi64(q[2], q[3]);
+
+			__m256i	c[4]	=	{	_mm256_permute2x128_si256(lo01, lo23, 0x20),	_mm256_permute2x128_si256(hi01, hi23, 0x20),
+									_mm256_permute2x128_si256(lo01, lo23, 0x31),	_mm256_permute2x128_si256(hi01, hi23, 0x31)	};
+			for (int i = 0; i < channels; ++i)
+				_mm256_storeu_si256((__m256i*) (planes[i] + x), c[i]);
+		}
+		split_row_sse2(src + x * 4, planes_at(planes, channels, x).data, channels, count - x);
+	}
+
+FILTERS_AVX512_BEGIN
+	/*
+	 *	split_row_avx2, 64 pixels at once. The dword permute gathers 16
+	 *	pixels of a channel into one lane, lanes are transposed after.
+	 */
+	FILTERS_AVX512 void
+	split_row_avx512(const unsigned char* src, unsigned char* const* planes, int channels, int count)
+	{
+		alignas(64) static const unsigned char	bytes[64]	=
+		{
+			0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+			0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+			0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+			0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15
+		};
+		const __m512i	mask	=	_mm512_load_si512(bytes);
+		const __m512i	order	=	_mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+
+		int	x	=	0;
+		for (; x + 64 <= count; x += 64)
+		{
+			__m512i	q[4];
+			for (int i = 0; i < 4; ++i)
+				q[i]	=	_mm512_permutexvar_epi32(order, _mm512_shuffle_epi8(_mm512_loadu_si512(src + x * 4 + i * 64), mask));
+
+			// R and G of 32 pixels, then B and A
+			__m512i	lo01	=	_mm512_shuffle_i64x2(q[0], q[1], _MM_SHUFFLE(1, 0, 1, 0));
+			__m512i	hi01	=	_mm512_shuffle_i64x2(q[0], q[1], _MM_SHUFFLE(3, 2, 3, 2));
+			__m512i	lo23	=	_mm512_shuffle_i64x2(q[2], q[3], _MM_SHUFFLE(1, 0, 1, 0));
+			__m512i	hi23	=	_mm512_shuffle_i64x2(q[2], q[3], _MM_SHUFFLE(3, 2, 3, 2));
+
+			__m512i	c[4]	=	{	_mm512_shuffle_i64x2(lo01, lo23, _MM_SHUFFLE(2, 0, 2, 0)),	_mm512_shuffle_i64x2(lo01, lo23, _MM_SHUFFLE(3, 1, 3, 1)),
+									_mm512_shuffle_i64x2(hi01, hi23, _MM_SHUFFLE(2, 0, 2, 0)),	_mm512_shuffle_i64x2(hi01, hi23, _MM_SHUFFLE(3, 1, 3, 1))	};
+			for (int i = 0; i < channels; ++i)
+				_mm512_storeu_si512(planes[i] + x, c[i]);
+		}
+		split_row_sse2(src + x * 4, planes_at(planes, channels, x).data, channels, count - x);
+	}
+FILTERS_AVX512_END
+#endif
+
+	typedef	void (*split_row_fn)(const unsigned char* src, unsigned char* const* planes, int channels, int count);
+
+	const split_row_fn	split_row	=	FILTERS_PICK(split_row_sse2, split_row_avx2, split_row_avx512);
+
+	/*
+	 *	Up to 4 plane rows into one row of count pixels,
+	 *	missing alpha plane is taken as 255.
+	 */
+	void
+	merge_row(const unsigned char* const* planes, unsigned char* dst, int channels, int count)
+	{
+		int	x	=	0;
+#ifdef __SSE2__
+		const __m128i	opaque	=	_mm_set1_epi8((char) 0xff);
+		for (; x + 16 <= count; x += 16)
+		{
+			__m128i	r	=	_mm_loadu_si128((const __m128i*) (planes[0] + x));
+			__m128i	g	=	_mm_loadu_si128((const __m128i*) (planes[1] + x));
+			__m128i	b	=	_mm_loadu_si128((const __m128i*) (planes[2] + x));
+			__m128i	a	=	channels == 4 ? _mm_loadu_si128((const __m128i*) (planes[3] + x)) : opaque;
+
+			__m128i	rg_lo	=	_mm_unpacklo_epi8(r, g);
+			__m128i	rg_hi	=	_mm_unpackhi_epi8(r, g);
+			__m128i	ba_lo	=	_mm_unpacklo_epi8(b, a);
+			__m128i	ba_hi	=	_mm_unpackhi_epi8(b, a);
+
+			_mm_storeu_si128((__m128i*) (dst + x * 4),		_mm_unpacklo_epi16(rg_lo, ba_lo));
+			_mm_storeu_si128((__m128i*) (dst + x * 4 + 16),	_mm_unpackhi_epi16(rg_lo, ba_lo));
+			_mm_storeu_si128((__m128i*) (dst + x * 4 + 32),	_mm_unpacklo_epi16(rg_hi, ba_hi));
+			_mm_storeu_si128((__m128i*) (dst + x * 4 + 48),	_mm_unpackhi_epi16(rg_hi, ba_hi));
+		}
+#endif
+		for (; x < count; ++x)
+		{
+			dst[x * 4]		=	planes[0][x];
+			dst[x * 4 + 1]	=	planes[1][x];
+			dst[x * 4 + 2]	=	planes[2][x];
+			dst[x * 4 + 3]	=	channels == 4 ? planes[3][x] : 255;
+		}
+	}
+
+	/*
+	 *	acc[x] += a[x] * wa + b[x] * wb, two taps at once: the loop every
+	 *	tap of both directions comes down to. SSE2 interleaves a and b
+	 *	so one pmaddwd does both products of 4 pixels.
+	 */
+	void
+	add_pair_sse2(int* acc, const unsigned char* a, const unsigned char* b, int count, int wa, int wb)
+	{
+		int	x	=	0;
+#ifdef __SSE2__
+		const __m128i	zero	=	_mm_setzero_si128();
+		const __m128i	w		=	_mm_set1_epi32((wb << 16) | (wa & 0xffff));
+		for (; x + 16 <= count; x += 16)
+		{
+			__m128i	va	=	_mm_loadu_si128((const __m128i*) (a + x));
+			__m128i	vb	=	_mm_loadu_si128((const __m128i*) (b + x));
+			__m128i	lo	=	_mm_unpacklo_epi8(va, vb);
+			__m128i	hi	=	_mm_unpackhi_epi8(va, vb);
+
+			__m128i	sums[4]	=	{	_mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), w),	_mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), w),
+									_mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), w),	_mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), w)	};
+			for (int i = 0; i < 4; ++i)
+			{
+				__m128i*	p	=	(__m128i*) (acc + x + i * 4);
+				_mm_storeu_si128(p, _mm_add_epi32(_mm_loadu_si128(p), sums[i]));
+			}
+		}
+#endif
+		for (; x < count; ++x)
+			acc[x]	+=	a[x] * wa + b[x] * wb;
+	}
+
+	/*
+	 *	Sums of 1 << 14 weights rounded back to bytes.
+	 */
+	void
+	store_row_sse2(unsigned char* out, const int* acc, int count)
+	{
+		int	x	=	0;
+#ifdef __SSE2__
+		const __m128i	half	=	_mm_set1_epi32(1 << 13);
+		for (; x + 16 <= count; x += 16)
+		{
+			__m128i	v[4];
+			for (int i = 0; i < 4; ++i)
+				v[i]	=	_mm_srai_epi32(_mm_add_epi32(_mm_loadu_si128((const __m128i*) (acc + x + i * 4)), half), 14);
+			_mm_storeu_si128((__m128i*) (out + x), _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3])));
+		}
+#endif
+		for (; x < count; ++x)
+			out[x]	=	(acc[x] + (1 << 13)) >> 14;
+	}
+
+#ifdef FILTERS_DISPATCH
+	/*
+	 *	add_pair, 16 pixels at once. Words of a and b interleave within
+	 *	128-bit lanes, so sums of pixels 0-3 and 8-11 come out in one
+	 *	register; lanes are swapped back before they're added to acc.
+	 */
+	FILTERS_AVX2 void
+	add_pair_avx2(int* acc, const unsigned char* a, const unsigned char* b, int count, int wa, int wb)
+	{
+		const __m256i	w	=	_mm256_set1_epi32((wb << 16) | (wa & 0xffff));
+
+		int	x	=	0;
+		for (; x + 16 <= count; x += 16)
+		{
+			__m256i	va	=	_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (a + x)));
+			__m256i	vb	=	_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (b + x)));
+			__m256i	lo	=	_mm256_madd_epi16(_mm256_unpacklo_epi16(va, vb), w);
+			__m256i	hi	=	_mm256_madd_epi16(_mm256_unpackhi_epi16(va, vb), w);
+
+			__m256i*	p0	=	(__m256i*) (acc + x);
+			__m256i*	p1	=	(__m256i*) (acc + x + 8);
+			_mm256_storeu_si256(p0, _mm256_add_epi32(_mm256_loadu_si256(p0), _mm256_permute2x128_si256(lo, hi, 0x20)));
+			_mm256_storeu_si256(p1, _mm256_add_epi32(_mm256_loadu_si256(p1), _mm256_permute2x128_si256(lo, hi, 0x31)));
+		}
+		for (; x < count; ++x)
+			acc[x]	+=	a[x] * wa + b[x] * wb;
+	}
+
+FILTERS_AVX512_BEGIN
+	/*
+	 *	add_pair_avx2, 32 pixels at once.
+	 */
+	FILTERS_AVX512 void
+	add_pair_avx512(int* acc, const unsigned char* a, const unsigned char* b, int count, int wa, int wb)
+	{
+		const __m512i	w		=	_mm512_set1_epi32((wb << 16) | (wa & 0xffff));
+		const __m512i	first	=	_mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11);
+		const __m512i	second	=	_mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15);
+
+		int	x	=	0;
+		for (; x + 32 <= count; x += 32)
+		{
+			__m512i	va	=	_mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*) (a + x)));
+			__m512i	vb	=	_mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*) (b + x)));
+			__m512i	lo	=	_mm512_madd_epi16(_mm512_unpacklo_epi16(va, vb), w);
+			__m512i	hi	=	_mm512_madd_epi16(_mm512_unpackhi_epi16(va, vb), w);
+
+			int*	p0	=	acc + x;
+			int*	p1	=	acc + x + 16;
+			_mm512_storeu_si512(p0, _mm512_add_epi32(_mm512_loadu_si512(p0), _mm512_permutex2var_epi64(lo, first, hi)));
+			_mm512_storeu_si512(p1, _mm512_add_epi32(_mm512_loadu_si512(p1), _mm512_permutex2var_epi64(lo, second, hi)));
+		}
+		for (; x < count; ++x)
+			acc[x]	+=	a[x] * wa + b[x] * wb;
+	}
+FILTERS_AVX512_END
+
+	/*
+	 *	store_row, 32 values at once. Packing works within lanes, so
+	 *	dwords of the result are put back in order by one permute.
+	 */
+	FILTERS_AVX2 void
+	store_row_avx2(unsigned char* out, const int* acc, int count)
+	{
+		const __m256i	half	=	_mm256_set1_epi32(1 << 13);
+		const __m256i	order	=	_mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+		int	x	=	0;
+		for (; x + 32 <= count; x += 32)
+		{
+			__m256i	v[4];
+			for (int i = 0; i < 4; ++i)
+				v[i]	=	_mm256_srai_epi32(_mm256_add_epi32(_mm256_loadu_si256((const __m256i*) (acc + x + i * 8)), half), 14);
+			__m256i	bytes	=	_mm256_packus_epi16(_mm256_packs_epi32(v[0], v[1]), _mm256_packs_epi32(v[2], v[3]));
+			_mm256_storeu_si256((__m256i*) (out + x), _mm256_permutevar8x32_epi32(bytes, order));
+		}
+		for (; x < count; ++x)
+			out[x]	=	(acc[x] + (1 << 13)) >> 14;
+	}
+
+FILTERS_AVX512_BEGIN
+	/*
+	 *	store_row, 16 values at once, narrowed with unsigned saturation.
+	 */
+	FILTERS_AVX512 void
+	store_row_avx512(unsigned char* out, const int* acc, int count)
+	{
+		const __m512i	half	=	_mm512_set1_epi32(1 << 13);
+		const __m512i	zero	=	_mm512_setzero_si512();
+
+		int	x	=	0;
+		for (; x + 16 <= count; x += 16)
+		{
+			__m512i	v	=	_mm512_srai_epi32(_mm512_add_epi32(_mm512_loadu_si512(acc + x), half), 14);
+			_mm_storeu_si128((__m128i*) (out + x), _mm512_cvtusepi32_epi8(_mm512_max_epi32(v, zero)));
+		}
+		for (; x < count; ++x)
+			out[x]	=	(acc[x] + (1 << 13)) >> 14;
+	}
+FILTERS_AVX512_END
+#endif
+
+	typedef	void (*add_pair_fn)(int* acc, const unsigned char* a, const unsigned char* b, int count, int wa, int wb);
+	typedef	void (*store_row_fn)(unsigned char* out, const int* acc, int count);
+
+	const add_pair_fn	add_pair	=	FILTERS_PICK(add_pair_sse2, add_pair_avx2, add_pair_avx512);
+	const store_row_fn	store_row	=	FILTERS_PICK(store_row_sse2, store_row_avx2, store_row_avx512);
+
+	/*
+	 *	acc[x] = sum of lines[k][x] * taps[k], taken two at a time.
+	 */
+	inline void
+	accumulate(int* acc, const unsigned char* const* lines, int count, const std::vector<int>& taps)
+	{
+		const std::size_t	span	=	taps.size();
+		std::fill(acc, acc + count, 0);
+		for (std::size_t k = 0; k + 1 < span; k += 2)
+			add_pair(acc, lines[k], lines[k + 1], count, taps[k], taps[k + 1]);
+		if (span & 1)
+			add_pair(acc, lines[span - 1], lines[span - 1], count, taps[span - 1], 0);
+	}
+
+	/*
+	 *	n horizontal passes, then n vertical ones, on planes R, G and B.
+	 *	Horizontal passes run on a padded copy of the row; vertical ones
+	 *	add whole rows of the previous pass, read through a table of row
+	 *	pointers that resolves the border once.
+	 */
+	void
+	separable(image& img, const std::vector<int>& taps, unsigned int n, const filters::border& edge)
+	{
+		const int	w		=	img.width;
+		const int	h		=	img.height;
+		const int	span	=	taps.size();
+		const int	r		=	span / 2;
+		if (!n || w <= 0 || h <= 0)	return;
+
+		std::vector<int>	xs(w + 2 * r);
+		for (int x = 0; x < w + 2 * r; ++x)
+			xs[x]	=	filters::raster::border_coord(x - r, w, edge.mode);
+
+		filters::parallel::for_bands(h, [&](int, int begin, int end)
+		{
+			std::vector<unsigned char>			padded(w + 2 * r);
+			std::vector<int>					acc(w);
+			std::vector<const unsigned char*>	shifted(span);
+			for (int k = 0; k < span; ++k)
+				shifted[k]	=	&padded[k];
+			for (int c = 0; c < 3; ++c)
+				for (int y = begin; y < end; ++y)
+				{
+					unsigned char*	row	=	img.row(c, y);
+					for (unsigned int i = 0; i < n; ++i)
+					{
+						// only the 2 r padding values need the border table
+						std::memcpy(&padded[r], row, w);
+						for (int x = 0; x < r; ++x)
+						{
+							padded[x]			=	xs[x] < 0 ? edge.color[c] : row[xs[x]];
+							padded[w + r + x]	=	xs[w + r + x] < 0 ? edge.color[c] : row[xs[w + r + x]];
+						}
+
+						accumulate(acc.data(), shifted.data(), w, taps);
+						store_row(row, acc.data(), w);
+					}
+				}
+		});
+
+		std::vector<unsigned char>	scratch((std::size_t) 3 * img.stride * h);
+		std::vector<unsigned char>	constant(3 * w);
+		for (int c = 0; c < 3; ++c)
+			std::memset(&constant[c * w], edge.color[c], w);
+
+		for (unsigned int i = 0; i < n; ++i)
+		{
+			// odd passes read scratch and write back to the image
+			bool	odd	=	i & 1;
+			filters::parallel::for_bands(h, [&](int, int begin, int end)
+			{
+				std::vector<int>					acc(w);
+				std::vector<const unsigned char*>	rows(span);
+				for (int c = 0; c < 3; ++c)
+				{
+					const unsigned char*	src	=	odd ? &scratch[(std::size_t) c * img.stride * h] : img.plane(c);
+					unsigned char*			dst	=	odd ? img.plane(c) : &scratch[(std::size_t) c * img.stride * h];
+
+					for (int y = begin; y < end; ++y)
+					{
+						for (int k = 0; k < span; ++k)
+						{
+							int	yy	=	filters::raster::border_coord(y - r + k, h, edge.mode);
+							rows[k]	=	yy < 0 ? &constant[c * w] : src + (std::size_t) yy * img.stride;
+						}
+
+						accumulate(acc.data(), rows.data(), w, taps);
+
+						store_row(dst + (std::size_t) y * img.stride, acc.data(), w);
+					}
+				}
+			});
+		}
+
+		if (n & 1)
+			for (int c = 0; c < 3; ++c)
+				std::memcpy(img.plane(c), &scratch[(std::size_t) c * img.stride * h], (std::size_t) img.stride * h);
+	}
+}
+
+void
+filters::planar::allocate(image& img, int width, int height, int channels)
+{
+	img.width		=	width;
+	img.height		=	height;
+	img.channels	=	channels;
+	img.stride		=	(width + 15) & ~15;
+	img.data.resize((std::size_t) channels * img.stride * height);
+}
+
+void
+filters::planar::split(const raster::image& source, image& target, bool alpha)
+{
+	allocate(target, source.width, source.height, alpha ? 4 : 3);
+
+	parallel::for_bands(source.height, [&](int, int begin, int end)
+	{
+		for (int y = begin; y < end; ++y)
+		{
+			unsigned char*	planes[4];
+			for (int c = 0; c < target.channels; ++c)
+				planes[c]	=	target.row(c, y);
+			split_row(raster::row(source, y), planes, target.channels, source.width);
+		}
+	});
+}
+
+void
+filters::planar::merge(const image& source, const raster::image& target)
+{
+	parallel::for_bands(source.height, [&](int, int begin, int end)
+	{
+		for (int y = begin; y < end; ++y)
+		{
+			const unsigned char*	planes[4]	=	{nullptr, nullptr, nullptr, nullptr};
+			for (int c = 0; c < source.channels; ++c)
+				planes[c]	=	source.row(c, y);
+			merge_row(planes, raster::row(target, y), source.channels, source.width);
+		}
+	});
+}
+
+filters::planar::image
+filters::planar::split(ALLEGRO_BITMAP* source, bool alpha)
+{
+	image	img;
+	img.width	=	img.height	=	img.stride	=	0;
+	img.channels	=	alpha ? 4 : 3;
+
+	raster::image	in	=	raster::lock(source, ALLEGRO_LOCK_READONLY);
+	if (!in.data)	return img;
+
+	split(in, img, alpha);
+	al_unlock_bitmap(source);
+	return	img;
+}
+
+ALLEGRO_BITMAP*
+filters::planar::merge(const image& source)
+{
+	ALLEGRO_BITMAP*	output	=	al_create_bitmap(source.width, source.height);
+	if (!output)	return nullptr;
+
+	raster::image	out	=	raster::lock(output, ALLEGRO_LOCK_WRITEONLY);
+	if (!out.data)
+	{
+		al_destroy_bitmap(output);
+		return nullptr;
+	}
+
+	merge(source, out);
+	al_unlock_bitmap(output);
+	return	output;
+}
+
+void
+filters::planar::gaussian_blur(image& img, unsigned int n, border edge)
+{
+	const int	weights[7]	=	{5,	32,	100,	100,	100,	32,	5};
+	separable(img, raster::fixed_weights(weights, 7), n, edge);
+}
+
+void
+filters::planar::box_blur(image& img, unsigned int n, border edge)
+{
+	const int	weights[3]	=	{1,	1,	1};
+	separable(img, raster::fixed_weights(weights, 3), n, edge);
+}
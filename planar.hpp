@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "filters.hpp"
+#include "raster.hpp"
+
+/**
+ *	obraz rozdzielony na płaszczyzny: osobno wszystkie R, G, B
+ *	(i opcjonalnie A). pętle filtrów idą po ciągłych bajtach
+ *	jednego kanału, bez zbierania ich z przeplecionych pikseli.
+*/
+
+namespace filters
+{
+	namespace planar
+	{
+		/*
+		 *	Planes of one image, each plane rows of stride bytes
+		 *	(width rounded up to 16). Plane 3 (alpha) exists only
+		 *	if channels == 4.
+		 */
+		struct image
+		{
+			int							width;
+			int							height;
+			int							channels;
+			int							stride;
+			std::vector<unsigned char>	data;
+
+			unsigned char*
+			plane(int c)
+			{
+				return	&data[(std::size_t) c * stride * height];
+			}
+
+			const unsigned char*
+			plane(int c) const
+			{
+				return	&data[(std::size_t) c * stride * height];
+			}
+
+			unsigned char*
+			row(int c, int y)
+			{
+				return	plane(c) + (std::size_t) y * stride;
+			}
+
+			const unsigned char*
+			row(int c, int y) const
+			{
+				return	plane(c) + (std::size_t) y * stride;
+			}
+		};
+
+		/*
+		 *			planar image,	width	,	height	,	# of planes
+		 *	ARGS:	image&		,	int		,	int		,	int
+		 *	Sizes img for given frame, storage is reused when it's big enough.
+		 */
+		void
+		allocate(image& img, int width, int height, int channels);
+
+		/*
+		 *			interleaved image	,	planar image	,	keep alpha
+		 *	ARGS:	raster::image		,	image&			,	[bool]
+		 *	Splits RGBA pixels into planes, 16 pixels per SSE2 step
+		 *	(32 with AVX2, 64 with AVX-512).
+		 *	Storage of target is reused when it's big enough.
+		 */
+		void
+		split(const raster::image& source, image& target, bool alpha = false);
+
+		/*
+		 *			planar image	,	interleaved image
+		 *	ARGS:	const image&	,	raster::image
+		 *	Interleaves planes back, 16 pixels per SSE2 step. Alpha is 255
+		 *	without alpha plane. Both images have to be of the same size.
+		 */
+		void
+		merge(const image& source, const raster::image& target);
+
+		/*
+		 *			source bitmap	,	[keep alpha]
+		 *	ARGS:	ALLEGRO_BITMAP*	,	[bool]
+		 *	RET:	image
+		 *	Planes of bitmap, empty image if it can't be locked.
+		 */
+		image
+		split(ALLEGRO_BITMAP* source, bool alpha = false);
+
+		/*
+		 *			planar image
+		 *	ARGS:	const image&
+		 *	RET:	ALLEGRO_BITMAP*
+		 *	New bitmap of planes, owned by caller.
+		 */
+		ALLEGRO_BITMAP*
+		merge(const image& source);
+
+		/*
+		 *			planar image,	# of iterations	,	border handling
+		 *	ARGS:	image&		,	[unsigned int]	,	[border]
+		 *	gaussian_blur_optimized on colour planes in place. Every tap is
+		 *	a whole row of one plane times a weight, so loops are
+		 *	straight streams the compiler vectorises.
+		 */
+		void
+		gaussian_blur(image& img, unsigned int n = 1, border edge = BORDER_WRAP);
+
+		/*
+		 *			planar image,	# of iterations	,	border handling
+		 *	ARGS:	image&		,	[unsigned int]	,	[border]
+		 *	Separable 3x3 box_blur on colour planes in place.
+		 */
+		void
+		box_blur(image& img, unsigned int n = 1, border edge = BORDER_WRAP);
+	}
+}
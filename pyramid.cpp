@@ -0,0 +1,372 @@
+#include "pyramid.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	using filters::raster::image;
+
+	inline int
+	clamp(int c, int n)
+	{
+		return c < 0 ? 0 : (c >= n ? n - 1 : c);
+	}
+
+	/*
+	 *	Separable gaussian with clamped edges. Horizontal pass keeps
+	 *	8 fractional bits in 16-bit intermediate, so two roundings
+	 *	don't add up to visible banding.
+	 */
+	void
+	blur(const image& in, const image& out, float sigma)
+	{
+		std::vector<int>			taps	=	filters::raster::gaussian_weights(sigma);
+		int							radius	=	(int) taps.size() / 2;
+		int							w		=	in.width;
+		int							h		=	in.height;
+		std::vector<std::uint16_t>	tmp(w * h * 4);
+
+		// column indices of taps are the same for every row
+		std::vector<int>	index(w + 2 * radius);
+		for (int x = -radius; x < w + radius; ++x)
+			index[x + radius]	=	clamp(x, w) * 4;
+
+		for (int y = 0; y < h; ++y)
+		{
+			const unsigned char*	src	=	filters::raster::row(in, y);
+			std::uint16_t*			dst	=	&tmp[y * w * 4];
+
+			for (int x = 0; x < w; ++x)
+			{
+				int	sum[4]	=	{0, 0, 0, 0};
+				for (int t = 0; t <= 2 * radius; ++t)
+				{
+					const unsigned char*	p	=	src + index[x + t];
+					for (int c = 0; c < 4; ++c)
+						sum[c]	+=	p[c] * taps[t];
+				}
+				for (int c = 0; c < 4; ++c)
+					dst[x * 4 + c]	=	(std::uint16_t) ((sum[c] + (1 << 5)) >> 6);
+			}
+		}
+
+		std::vector<int>	sum(w * 4);
+		for (int y = 0; y < h; ++y)
+		{
+			std::fill(sum.begin(), sum.end(), 0);
+			for (int t = -radius; t <= radius; ++t)
+			{
+				const std::uint16_t*	src		=	&tmp[clamp(y + t, h) * w * 4];
+				int						weight	=	taps[t + radius];
+				for (int i = 0; i < w * 4; ++i)
+					sum[i]	+=	src[i] * weight;
+			}
+
+			unsigned char*	dst	=	filters::raster::row(out, y);
+			for (int i = 0; i < w * 4; ++i)
+				dst[i]	=	(unsigned char) ((sum[i] + (1 << 21)) >> 22);
+		}
+	}
+}
+
+filters::pyramid::pyramid(ALLEGRO_BITMAP* source, unsigned int levels)
+{
+	raster::image	in	=	raster::lock(source, ALLEGRO_LOCK_READONLY);
+	if (!in.data)	return;
+
+	build(in, levels);
+	al_unlock_bitmap(source);
+}
+
+filters::pyramid::pyramid(const raster::image& source, unsigned int levels)
+{
+	build(source, levels);
+}
+
+void
+filters::pyramid::build(const raster::image& source, unsigned int levels)
+{
+	int	w	=	source.width;
+	int	h	=	source.height;
+
+	widths_.push_back(w);
+	heights_.push_back(h);
+	levels_.push_back(std::vector<unsigned char>(w * h * 4));
+	for (int y = 0; y < h; ++y)
+		std::memcpy(&levels_[0][y * w * 4], raster::row(source, y), w * 4);
+
+	while ((w > 1 || h > 1) && (levels == 0 || levels_.size() < levels))
+	{
+		w	=	(w + 1) / 2;
+		h	=	(h + 1) / 2;
+		widths_.push_back(w);
+		heights_.push_back(h);
+		levels_.push_back(std::vector<unsigned char>(w * h * 4));
+		downsample(level(levels_.size() - 2), level(levels_.size() - 1));
+	}
+}
+
+unsigned int
+filters::pyramid::size() const
+{
+	return levels_.size();
+}
+
+filters::raster::image
+filters::pyramid::level(unsigned int i) const
+{
+	// levels are only read through const pyramid, data stays non-const for raster::image
+	return raster::wrap(widths_[i], heights_[i], const_cast<unsigned char*>(levels_[i].data()));
+}
+
+ALLEGRO_BITMAP*
+filters::pyramid::bitmap(unsigned int i) const
+{
+	ALLEGRO_BITMAP*	output	=	al_create_bitmap(widths_[i], heights_[i]);
+	if (!output)	return nullptr;
+
+	raster::image	out	=	raster::lock(output, ALLEGRO_LOCK_WRITEONLY);
+	if (!out.data)
+	{
+		al_destroy_bitmap(output);
+		return nullptr;
+	}
+
+	for (int y = 0; y < heights_[i]; ++y)
+		std::memcpy(raster::row(out, y), &levels_[i][y * widths_[i] * 4], widths_[i] * 4);
+
+	al_unlock_bitmap(output);
+	return output;
+}
+
+void
+filters::pyramid::downsample(const raster::image& in, const raster::image& out)
+{
+	int							w	=	out.width;
+	std::vector<std::uint16_t>	tmp(w * in.height * 4);
+
+	// coarse pixel x covers fine pixels 2x and 2x + 1, taps reach one more on each side
+	std::vector<int>	index(w * 4);
+	for (int x = 0; x < w; ++x)
+		for (int t = 0; t < 4; ++t)
+			index[x * 4 + t]	=	clamp(2 * x - 1 + t, in.width) * 4;
+
+	for (int y = 0; y < in.height; ++y)
+	{
+		const unsigned char*	src	=	raster::row(in, y);
+		std::uint16_t*			dst	=	&tmp[y * w * 4];
+
+		for (int x = 0; x < w; ++x)
+		{
+			const unsigned char*	p0	=	src + index[x * 4];
+			const unsigned char*	p1	=	src + index[x * 4 + 1];
+			const unsigned char*	p2	=	src + index[x * 4 + 2];
+			const unsigned char*	p3	=	src + index[x * 4 + 3];
+			for (int c = 0; c < 4; ++c)
+				dst[x * 4 + c]	=	p0[c] + 3 * (p1[c] + p2[c]) + p3[c];
+		}
+	}
+
+	for (int y = 0; y < out.height; ++y)
+	{
+		const std::uint16_t*	r0	=	&tmp[clamp(2 * y - 1, in.height) * w * 4];
+		const std::uint16_t*	r1	=	&tmp[clamp(2 * y, in.height) * w * 4];
+		const std::uint16_t*	r2	=	&tmp[clamp(2 * y + 1, in.height) * w * 4];
+		const std::uint16_t*	r3	=	&tmp[clamp(2 * y + 2, in.height) * w * 4];
+		unsigned char*			dst	=	raster::row(out, y);
+
+		for (int i = 0; i < w * 4; ++i)
+			dst[i]	=	(unsigned char) ((r0[i] + 3 * (r1[i] + r2[i]) + r3[i] + 32) >> 6);
+	}
+}
+
+void
+filters::pyramid::upsample(const raster::image& in, const raster::image& out)
+{
+	// source position and 8-bit weight of the right neighbour for every column
+	std::vector<int>	x0(out.width);
+	std::vector<int>	x1(out.width);
+	std::vector<int>	fx(out.width);
+	for (int x = 0; x < out.width; ++x)
+	{
+		float	s	=	(x + 0.5f) * in.width / out.width - 0.5f;
+		if (s < 0.0f)	s = 0.0f;
+		int		i	=	(int) s;
+		x0[x]	=	i * 4;
+		x1[x]	=	std::min(i + 1, in.width - 1) * 4;
+		fx[x]	=	(int) ((s - i) * 256.0f + 0.5f);
+	}
+
+	for (int y = 0; y < out.height; ++y)
+	{
+		float	s	=	(y + 0.5f) * in.height / out.height - 0.5f;
+		if (s < 0.0f)	s = 0.0f;
+		int		i	=	(int) s;
+		int		fy	=	(int) ((s - i) * 256.0f + 0.5f);
+
+		const unsigned char*	top	=	raster::row(in, i);
+		const unsigned char*	bot	=	raster::row(in, std::min(i + 1, in.height - 1));
+		unsigned char*			dst	=	raster::row(out, y);
+
+		for (int x = 0; x < out.width; ++x)
+		{
+			int	a	=	256 - fx[x];
+			int	b	=	fx[x];
+			for (int c = 0; c < 4; ++c)
+			{
+				int	t	=	top[x0[x] + c] * a + top[x1[x] + c] * b;
+				int	u	=	bot[x0[x] + c] * a + bot[x1[x] + c] * b;
+				dst[x * 4 + c]	=	(unsigned char) ((t * (256 - fy) + u * fy + (1 << 15)) >> 16);
+			}
+		}
+	}
+}
+
+unsigned int
+filters::pyramid_level(float sigma, unsigned int quality)
+{
+	if (!std::isfinite(sigma) || sigma <= 0.0f)	return 0;
+
+	// variance in full resolution pixels: every [1 3 3 1] prefilter adds
+	// 0.75 of its level pixel, every bilinear step up about 1/6 of it
+	float	min_sigma	=	1.0f + quality;
+	float	variance	=	sigma * sigma;
+	float	scale		=	1.0f;
+	float	down		=	0.0f;
+	float	up			=	0.0f;
+
+	for (unsigned int level = 0; ; ++level)
+	{
+		float	next_scale	=	scale * 4.0f;
+		float	next_down	=	down + 0.75f * scale;
+		float	next_up		=	up + next_scale / 6.0f;
+		float	residual	=	(variance - next_down - next_up) / next_scale;
+
+		if (residual < min_sigma * min_sigma)	return level;
+
+		scale	=	next_scale;
+		down	=	next_down;
+		up		=	next_up;
+	}
+}
+
+namespace
+{
+	/*
+	 *	Blur of levels' base image into out of the same size.
+	 */
+	void
+	blur_levels(const filters::pyramid& levels, float sigma, unsigned int quality, const filters::raster::image& out)
+	{
+		using filters::pyramid;
+		namespace raster	=	filters::raster;
+
+		unsigned int	top		=	std::min(filters::pyramid_level(sigma, quality), levels.size() - 1);
+		float			scale	=	1.0f;
+		float			used	=	0.0f;
+		for (unsigned int k = 1; k <= top; ++k)
+		{
+			used	+=	0.75f * scale;
+			scale	*=	4.0f;
+			used	+=	scale / 6.0f;
+		}
+		// a sigma the blur cannot size leaves the image as it is
+		float	residual	=	std::isfinite(sigma)	?	std::sqrt(std::max(sigma * sigma - used, 0.0f) / scale)
+													:	0.0f;
+
+		// coarse level is blurred, then brought up one level at a time,
+		// two scratch buffers of the next finer size are enough
+		std::vector<unsigned char>	buffers[2];
+		raster::image				current	=	out;
+		if (top > 0)
+		{
+			raster::image	coarse	=	levels.level(top);
+			buffers[top & 1].resize(coarse.width * coarse.height * 4);
+			current	=	raster::wrap(coarse.width, coarse.height, buffers[top & 1].data());
+		}
+
+		if (residual > 0.0f)
+			blur(levels.level(top), current, residual);
+		else
+		{
+			raster::image	src	=	levels.level(top);
+			for (int y = 0; y < src.height; ++y)
+				std::memcpy(raster::row(current, y), raster::row(src, y), src.width * 4);
+		}
+
+		for (unsigned int k = top; k > 0; --k)
+		{
+			raster::image	next	=	out;
+			if (k > 1)
+			{
+				raster::image	finer	=	levels.level(k - 1);
+				buffers[(k - 1) & 1].resize(finer.width * finer.height * 4);
+				next	=	raster::wrap(finer.width, finer.height, buffers[(k - 1) & 1].data());
+			}
+			pyramid::upsample(current, next);
+			current	=	next;
+		}
+
+		for (int y = 0; y < out.height; ++y)
+		{
+			unsigned char*	p	=	raster::row(out, y);
+			for (int x = 0; x < out.width; ++x)
+				p[x * 4 + 3]	=	255;
+		}
+	}
+}
+
+ALLEGRO_BITMAP*
+filters::gaussian_blur_pyramid(const pyramid& levels, float sigma, unsigned int quality)
+{
+	if (!levels.size())	return nullptr;
+
+	raster::image	base	=	levels.level(0);
+	ALLEGRO_BITMAP*	output	=	al_create_bitmap(base.width, base.height);
+	if (!output)	return nullptr;
+
+	raster::image	out		=	raster::lock(output, ALLEGRO_LOCK_WRITEONLY);
+	if (!out.data)
+	{
+		al_destroy_bitmap(output);
+		return nullptr;
+	}
+
+	blur_levels(levels, sigma, quality, out);
+
+	al_unlock_bitmap(output);
+	return output;
+}
+
+ALLEGRO_BITMAP*
+filters::gaussian_blur_pyramid(ALLEGRO_BITMAP* source, float sigma, unsigned int quality, region roi)
+{
+	if (roi.whole())
+	{
+		// only levels the blur will use are built
+		pyramid	levels(source, pyramid_level(sigma, quality) + 1);
+		return gaussian_blur_pyramid(levels, sigma, quality);
+	}
+
+	// levels are halved from the image corner, a window would shift them
+	return	raster::into_region(source, roi, true, [&](const view& in, const view& out)
+	{
+		return	gaussian_blur_pyramid(in, out, sigma, quality);
+	});
+}
+
+bool
+filters::gaussian_blur_pyramid(const view& source, const view& output, float sigma, unsigned int quality)
+{
+	raster::image	in	=	raster::open(source);
+	raster::image	out	=	raster::open(output);
+	if (!in.data || !out.data || in.width != out.width || in.height != out.height)
+		return	false;
+
+	// level 0 is the pyramid's own copy, so output may be source
+	pyramid	levels(in, pyramid_level(sigma, quality) + 1);
+	blur_levels(levels, sigma, quality, out);
+	return	true;
+}
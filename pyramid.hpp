@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+
+#include "filters.hpp"
+#include "raster.hpp"
+
+/**
+ *	piramida obrazów: każdy poziom ma połowę rozdzielczości poprzedniego.
+ *	filtry o dużym zasięgu mogą liczyć na małym poziomie i skalować
+ *	wynik z powrotem.
+*/
+
+namespace filters
+{
+	class pyramid
+	{
+	public:
+		/*
+		 *			source bitmap	,	max # of levels
+		 *	ARGS:	ALLEGRO_BITMAP*	,	[unsigned int]
+		 *	Builds levels down to given count, 0 means until 1x1 level.
+		 *	Level 0 is a copy of the source.
+		 */
+		pyramid(ALLEGRO_BITMAP* source, unsigned int levels = 0);
+		pyramid(const raster::image& source, unsigned int levels = 0);
+
+		unsigned int
+		size() const;
+
+		/*
+		 *	Level as raster image, valid as long as the pyramid.
+		 *	Read only, filters share the same levels.
+		 */
+		raster::image
+		level(unsigned int i) const;
+
+		/*
+		 *	Level copied into a new bitmap, owned by caller.
+		 */
+		ALLEGRO_BITMAP*
+		bitmap(unsigned int i) const;
+
+		/*
+		 *			fine image		,	coarse image
+		 *	ARGS:	raster::image	,	raster::image
+		 *	Halves resolution: [1 3 3 1] / 8 anti-aliasing prefilter in both
+		 *	directions, then every second pixel. Coarse image has to be
+		 *	((w + 1) / 2, (h + 1) / 2) big. Edges are clamped.
+		 */
+		static void
+		downsample(const raster::image& in, const raster::image& out);
+
+		/*
+		 *			coarse image	,	fine image
+		 *	ARGS:	raster::image	,	raster::image
+		 *	Bilinear upsampling to any bigger size, pixel centres aligned.
+		 */
+		static void
+		upsample(const raster::image& in, const raster::image& out);
+
+	private:
+		void	build(const raster::image& source, unsigned int levels);
+
+		std::vector<int>							widths_;
+		std::vector<int>							heights_;
+		std::vector<std::vector<unsigned char> >	levels_;
+	};
+
+	/*
+	 *			blur strength	,	quality
+	 *	ARGS:	float			,	unsigned int
+	 *	RET:	unsigned int
+	 *	Coarsest level gaussian_blur_pyramid will blur at. Each quality step
+	 *	keeps one more pixel of sigma left for that level, so the blur
+	 *	moves to finer levels. 0 for a sigma that is not a positive number.
+	 */
+	unsigned int
+	pyramid_level(float sigma, unsigned int quality = 1);
+
+	/*
+	 *			image pyramid	,	blur strength	,	[quality]
+	 *	ARGS:	pyramid			,	float			,	[unsigned int]
+	 *	RET:	ALLEGRO_BITMAP*
+	 *	Same as gaussian_blur_pyramid for bitmap, on already built pyramid,
+	 *	so several blurs of one image share the downsampling.
+	 *	Uses as many levels as pyramid has, even if more would be cheaper.
+	 */
+	ALLEGRO_BITMAP*
+	gaussian_blur_pyramid(const pyramid& levels, float sigma, unsigned int quality = 1);
+}
@@ -0,0 +1,113 @@
+#include "raster.hpp"
+
+#include <cmath>
+#include <cstring>
+
+filters::raster::image
+filters::raster::lock(ALLEGRO_BITMAP* bitmap, int flags)
+{
+	image	img		=	{nullptr, 0, 0, 0};
+	ALLEGRO_LOCKED_REGION*	region	=	al_lock_bitmap(bitmap, format, flags);
+	if (!region)	return img;
+
+	img.data	=	(unsigned char*) region->data;
+	img.width	=	al_get_bitmap_width(bitmap);
+	img.height	=	al_get_bitmap_height(bitmap);
+	img.pitch	=	region->pitch;
+	return img;
+}
+
+filters::raster::image
+filters::raster::lock(ALLEGRO_BITMAP* bitmap, const rect& area, int flags)
+{
+	image	img		=	{nullptr, 0, 0, 0};
+	ALLEGRO_LOCKED_REGION*	region	=	al_lock_bitmap_region(bitmap, area.x, area.y, area.w, area.h, format, flags);
+	if (!region)	return img;
+
+	img.data	=	(unsigned char*) region->data;
+	img.width	=	area.w;
+	img.height	=	area.h;
+	img.pitch	=	region->pitch;
+	return img;
+}
+
+filters::raster::rect
+filters::raster::clip(const region& roi, int img_w, int img_h)
+{
+	rect	r	=	{0, 0, img_w, img_h};
+	if (roi.whole())	return r;
+
+	r.x	=	std::max(roi.x, 0);
+	r.y	=	std::max(roi.y, 0);
+	r.w	=	std::min(roi.x + roi.width, img_w)	-	r.x;
+	r.h	=	std::min(roi.y + roi.height, img_h)	-	r.y;
+	return r;
+}
+
+filters::raster::image
+filters::raster::wrap(int width, int height, unsigned char* buffer)
+{
+	image	img	=	{buffer, width, height, width * 4};
+	return img;
+}
+
+std::vector<int>
+filters::raster::fixed_weights(const int* weights, int count)
+{
+	int	sum	=	0;
+	for (int i = 0; i < count; ++i)
+		sum	+=	weights[i];
+
+	std::vector<int>	taps(count);
+	int					total	=	0;
+	for (int i = 0; i < count; ++i)
+		total	+=	taps[i]	=	(weights[i] * (1 << 14) + sum / 2) / sum;
+	taps[count / 2]	+=	(1 << 14) - total;
+	return	taps;
+}
+
+std::vector<int>
+filters::raster::gaussian_weights(float sigma)
+{
+	int					radius	=	(int) std::ceil(3.0f * sigma);
+	std::vector<float>	w(2 * radius + 1);
+	float				sum		=	0.0f;
+
+	for (int i = -radius; i <= radius; ++i)
+		sum	+=	w[i + radius]	=	std::exp(-0.5f * i * i / (sigma * sigma));
+
+	std::vector<int>	taps(w.size());
+	int					total	=	0;
+	for (std::size_t i = 0; i < w.size(); ++i)
+		total	+=	taps[i]	=	(int) (w[i] / sum * (1 << 14) + 0.5f);
+
+	taps[radius]	+=	(1 << 14) - total;
+	return	taps;
+}
+
+filters::raster::image
+filters::raster::open(const view& v)
+{
+	image	img	=	{nullptr, 0, 0, 0};
+	if (!v.data || v.format != format || v.width <= 0 || v.height <= 0)	return img;
+
+	img.data	=	v.data;
+	img.width	=	v.width;
+	img.height	=	v.height;
+	img.pitch	=	v.pitch;
+	return img;
+}
+
+filters::view
+filters::raster::view_of(const image& img)
+{
+	return	view(img.data, img.width, img.height, img.pitch, format);
+}
+
+void
+filters::raster::copy(const image& source, const image& target)
+{
+	if (source.data == target.data)	return;
+	for (int y = 0; y < source.height; ++y)
+		std::memcpy(row(target, y), row(source, y), source.width * 4);
+}
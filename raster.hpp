@@ -0,0 +1,245 @@
+#pragma once
+
+#include <allegro5/allegro.h>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "filters.hpp"
+
+/**
+ *	dostęp do pamięci bitmapy bez al_get_pixel/al_put_pixel.
+ *	bitmapa jest blokowana zawsze w tym samym formacie, więc filtry
+ *	mogą czytać i pisać piksele bezpośrednio.
+*/
+
+namespace filters
+{
+	namespace raster
+	{
+		/*
+		 *	Pixel format every locked image is converted to:
+		 *	4 bytes per pixel, R G B A order in memory.
+		 */
+		const int	format	=	ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE;
+
+		/*
+		 *	Locked bitmap memory (or any other RGBA buffer).
+		 *	Rows are pitch bytes apart, pitch may be negative.
+		 */
+		struct image
+		{
+			unsigned char*	data;
+			int				width;
+			int				height;
+			int				pitch;
+		};
+
+		/*
+		 *	Rectangle in image coordinates.
+		 */
+		struct rect
+		{
+			int	x;
+			int	y;
+			int	w;
+			int	h;
+		};
+
+		/*
+		 *			bitmap			,	lock flags
+		 *	ARGS:	ALLEGRO_BITMAP*	,	int
+		 *	RET:	image
+		 *	Locks whole bitmap in raster::format.
+		 *	Returns image with data == nullptr if bitmap can't be locked.
+		 */
+		image
+		lock(ALLEGRO_BITMAP* bitmap, int flags);
+
+		/*
+		 *			bitmap			,	part to lock,	lock flags
+		 *	ARGS:	ALLEGRO_BITMAP*	,	rect		,	int
+		 *	RET:	image
+		 *	Locks only given part of bitmap, pixel (0, 0) of returned image
+		 *	is pixel (area.x, area.y) of bitmap.
+		 *	Returns image with data == nullptr if bitmap can't be locked.
+		 */
+		image
+		lock(ALLEGRO_BITMAP* bitmap, const rect& area, int flags);
+
+		/*
+		 *			region of interest	,	image width	,	image height
+		 *	ARGS:	region				,	int			,	int
+		 *	RET:	rect
+		 *	Clips region to the image. Whole image for default region.
+		 *	Returns rect with w or h <= 0 if nothing is left.
+		 */
+		rect
+		clip(const region& roi, int img_w, int img_h);
+
+		/*
+		 *			width	,	height	,	buffer
+		 *	ARGS:	int		,	int		,	unsigned char*
+		 *	RET:	image
+		 *	Wraps tightly packed buffer of width * height * 4 bytes.
+		 */
+		image
+		wrap(int width, int height, unsigned char* buffer);
+
+		/*
+		 *	Maps coordinate outside of [0, n) back into the image.
+		 *	Returns -1 for BORDER_CONSTANT.
+		 */
+		inline int
+		border_coord(int c, int n, filters::border_mode mode)
+		{
+			if (c >= 0 && c < n)	return c;
+
+			switch (mode)
+			{
+				case filters::BORDER_WRAP:
+					c	%=	n;
+					return	c < 0 ? c + n : c;
+
+				case filters::BORDER_CLAMP:
+					return	c < 0 ? 0 : n - 1;
+
+				case filters::BORDER_MIRROR:
+				{
+					if (n == 1)	return 0;
+					int	period	=	2 * (n - 1);
+					c	%=	period;
+					if (c < 0)	c	+=	period;
+					return	c < n ? c : period - c;
+				}
+
+				default:
+					return	-1;
+			}
+		}
+
+		/*
+		 *			caller's view
+		 *	ARGS:	const view&
+		 *	RET:	image
+		 *	Same memory as image. Returns image with data == nullptr for
+		 *	views of other format than raster::format or without pixels.
+		 */
+		image
+		open(const view& v);
+
+		/*
+		 *			image
+		 *	ARGS:	const image&
+		 *	RET:	view
+		 */
+		view
+		view_of(const image& img);
+
+		/*
+		 *			source image,	target image
+		 *	ARGS:	const image&,	const image&
+		 *	Copies pixels of source into target of the same size,
+		 *	nothing to do if both are the same memory.
+		 */
+		void
+		copy(const image& source, const image& target);
+
+		/*
+		 *			integer weights	,	# of weights
+		 *	ARGS:	const int*		,	int
+		 *	RET:	std::vector<int>
+		 *	Kernel weights rescaled to sum to exactly 1 << 14, rounding
+		 *	error goes to the middle weight.
+		 */
+		std::vector<int>
+		fixed_weights(const int* weights, int count);
+
+		/*
+		 *			sigma
+		 *	ARGS:	float
+		 *	RET:	std::vector<int>
+		 *	Gaussian weights of radius ceil(3 sigma), summing to exactly
+		 *	1 << 14 like fixed_weights, so flat areas stay flat.
+		 */
+		std::vector<int>
+		gaussian_weights(float sigma);
+
+		/*
+		 *			source bitmap	,	output size	,	filter
+		 *	ARGS:	ALLEGRO_BITMAP*	,	int, int	,	Fn
+		 *	RET:	ALLEGRO_BITMAP*
+		 *	Bitmap version of a view filter: locks source, creates and locks
+		 *	output of given size and calls fn(in, out), which returns bool.
+		 *	Returns output, nullptr if anything failed.
+		 */
+		template <typename Fn>
+		ALLEGRO_BITMAP*
+		into_bitmap(ALLEGRO_BITMAP* source, int width, int height, Fn fn);
+
+		/*
+		 *			source bitmap	,	region of interest	,	reads whole image	,	filter
+		 *	ARGS:	ALLEGRO_BITMAP*	,	const region&		,	bool				,	view_fn
+		 *	RET:	ALLEGRO_BITMAP*
+		 *	Bitmap version of a view filter with region, run the way the
+		 *	kernel filters are (see run_passes in filters.cpp). Point filters
+		 *	read the region only; filters whose pixels depend on the whole
+		 *	image (histograms, grids, random blocks) are run on all of it and
+		 *	only the region is written, so it matches the whole image result.
+		 *	Returns what kernel filters return for roi, nullptr if fn failed.
+		 */
+		typedef	std::function<bool (const view& in, const view& out)>	view_fn;
+
+		ALLEGRO_BITMAP*
+		into_region(ALLEGRO_BITMAP* source, const region& roi, bool whole_image, const view_fn& fn);
+
+		template <typename Fn>
+		ALLEGRO_BITMAP*
+		into_bitmap(ALLEGRO_BITMAP* source, int width, int height, Fn fn)
+		{
+			ALLEGRO_BITMAP*	output	=	al_create_bitmap(width, height);
+			if (!output)	return nullptr;
+
+			image	in	=	lock(source, ALLEGRO_LOCK_READONLY);
+			if (!in.data)
+			{
+				al_destroy_bitmap(output);
+				return nullptr;
+			}
+
+			image	out	=	lock(output, ALLEGRO_LOCK_WRITEONLY);
+			bool	ok	=	out.data && fn(in, out);
+			if (out.data)	al_unlock_bitmap(output);
+			al_unlock_bitmap(source);
+
+			if (!ok)
+			{
+				al_destroy_bitmap(output);
+				return nullptr;
+			}
+			return output;
+		}
+
+		inline unsigned char*
+		row(const image& img, int y)
+		{
+			return img.data + (std::ptrdiff_t) y * img.pitch;
+		}
+
+		inline unsigned char*
+		pixel(const image& img, int x, int y)
+		{
+			return row(img, y) + x * 4;
+		}
+
+		/*
+		 *	Luma of RGBA pixel, 0.299 R + 0.587 G + 0.114 B in 8-bit
+		 *	fixed point, the one histogram and bilateral work on.
+		 */
+		inline int
+		luma(const unsigned char* p)
+		{
+			return (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8;
+		}
+	}
+}
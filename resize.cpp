@@ -0,0 +1,385 @@
+#include "filters.hpp"
+#include "raster.hpp"
+#include "cpu.hpp"
+
+#include <vector>
+#include <cmath>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef FILTERS_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	using filters::raster::image;
+
+	const int	precision	=	14;
+
+	/*
+	 *	Contributions of source pixels to every output pixel of one axis.
+	 *	Every output has the same (even) number of taps, so inner loops take
+	 *	taps in pairs; padding taps have weight 0. Indices are clamped to
+	 *	the source, which is the same as clamping the image edge.
+	 */
+	struct weights
+	{
+		int					taps;
+		std::vector<int>	index;
+		std::vector<short>	weight;
+	};
+
+	double
+	kernel(filters::resize_mode mode, double t)
+	{
+		t	=	std::fabs(t);
+		if (mode == filters::RESIZE_BILINEAR)
+			return	t < 1.0 ? filters::lerp(1.0, 0.0, t) : 0.0;
+
+		// weight of one sample is cubrp of unit vector at the sample's place
+		if (t < 1.0)	return filters::cubrp(0.0, 1.0, 0.0, 0.0, t);
+		if (t < 2.0)	return filters::cubrp(1.0, 0.0, 0.0, 0.0, t - 1.0);
+		return	0.0;
+	}
+
+	/*
+	 *	Box: output pixel is the area average of source pixels it covers.
+	 *	Bilinear, bicubic: kernel is stretched by the scale when shrinking,
+	 *	so it averages all covered pixels instead of skipping some.
+	 */
+	weights
+	make_weights(int in, int out, filters::resize_mode mode)
+	{
+		double	scale	=	double(in) / out;
+		double	reach	=	mode == filters::RESIZE_BICUBIC ? 2.0 : 1.0;
+		double	stretch	=	std::max(scale, 1.0);
+
+		std::vector<std::vector<std::pair<int, double> > >	lists(out);
+		std::size_t											taps	=	0;
+
+		for (int o = 0; o < out; ++o)
+		{
+			std::vector<std::pair<int, double> >&	list	=	lists[o];
+
+			if (mode == filters::RESIZE_BOX)
+			{
+				double	lo	=	o * scale;
+				double	hi	=	(o + 1) * scale;
+				for (int i = (int) std::floor(lo); i < hi; ++i)
+				{
+					double	w	=	std::min(hi, i + 1.0) - std::max(lo, double(i));
+					if (w > 0.0)	list.push_back(std::make_pair(i, w));
+				}
+			}
+			else
+			{
+				double	centre	=	(o + 0.5) * scale - 0.5;
+				int		lo		=	(int) std::floor(centre - reach * stretch) + 1;
+				int		hi		=	(int) std::ceil(centre + reach * stretch) - 1;
+				for (int i = lo; i <= hi; ++i)
+				{
+					double	w	=	kernel(mode, (i - centre) / stretch);
+					if (w != 0.0)	list.push_back(std::make_pair(i, w));
+				}
+			}
+
+			taps	=	std::max(taps, list.size());
+		}
+
+		weights	table;
+		table.taps	=	(int) (taps + 1) & ~1;
+		table.index.resize(out * table.taps);
+		table.weight.resize(out * table.taps);
+
+		for (int o = 0; o < out; ++o)
+		{
+			const std::vector<std::pair<int, double> >&	list	=	lists[o];
+			double	sum		=	0.0;
+			for (std::size_t i = 0; i < list.size(); ++i)
+				sum	+=	list[i].second;
+
+			int		total	=	0;
+			int		biggest	=	0;
+			for (std::size_t i = 0; i < list.size(); ++i)
+			{
+				int	w	=	(int) std::floor(list[i].second / sum * (1 << precision) + 0.5);
+				table.index[o * table.taps + i]		=	std::min(std::max(list[i].first, 0), in - 1);
+				table.weight[o * table.taps + i]	=	(short) w;
+				total	+=	w;
+				if (w > table.weight[o * table.taps + biggest])	biggest	=	i;
+			}
+
+			// rounding error goes to the biggest weight, so flat areas stay flat
+			table.weight[o * table.taps + biggest]	+=	(1 << precision) - total;
+
+			for (int i = list.size(); i < table.taps; ++i)
+			{
+				table.index[o * table.taps + i]		=	table.index[o * table.taps];
+				table.weight[o * table.taps + i]	=	0;
+			}
+		}
+
+		return	table;
+	}
+
+	// two 16-bit weights in one 32-bit lane, as _mm_madd_epi16 pairs them
+	inline int
+	pair(short a, short b)
+	{
+		return	(int) ((unsigned short) a | ((unsigned int) (unsigned short) b << 16));
+	}
+
+	inline unsigned char
+	store(int acc)
+	{
+		acc	=	(acc + (1 << (precision - 1))) >> precision;
+		return	(unsigned char) std::min(std::max(acc, 0), 255);
+	}
+
+	/*
+	 *	Resamples rows. out has in's height and table's width.
+	 */
+	void
+	horizontal(const image& in, const image& out, const weights& table)
+	{
+		const int	taps	=	table.taps;
+
+		for (int y = 0; y < out.height; ++y)
+		{
+			const unsigned char*	src	=	filters::raster::row(in, y);
+			unsigned char*			dst	=	filters::raster::row(out, y);
+
+			for (int x = 0; x < out.width; ++x)
+			{
+				const int*		index	=	&table.index[x * taps];
+				const short*	weight	=	&table.weight[x * taps];
+#ifdef __SSE2__
+				// two taps at a time: bytes of both pixels interleaved, so
+				// madd multiplies each channel pair by its pair of weights
+				const __m128i	zero	=	_mm_setzero_si128();
+				__m128i			acc		=	_mm_setzero_si128();
+				for (int t = 0; t < taps; t += 2)
+				{
+					int	a, b;
+					std::memcpy(&a, src + index[t] * 4, 4);
+					std::memcpy(&b, src + index[t + 1] * 4, 4);
+
+					__m128i	p	=	_mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(a), _mm_cvtsi32_si128(b)), zero);
+					__m128i	w	=	_mm_set1_epi32(pair(weight[t], weight[t + 1]));
+					acc	=	_mm_add_epi32(acc, _mm_madd_epi16(p, w));
+				}
+
+				acc	=	_mm_srai_epi32(_mm_add_epi32(acc, _mm_set1_epi32(1 << (precision - 1))), precision);
+				acc	=	_mm_packus_epi16(_mm_packs_epi32(acc, acc), zero);
+				int	pixel	=	_mm_cvtsi128_si32(acc);
+				std::memcpy(dst + x * 4, &pixel, 4);
+#else
+				int	acc[4]	=	{0, 0, 0, 0};
+				for (int t = 0; t < taps; ++t)
+				{
+					const unsigned char*	p	=	src + index[t] * 4;
+					for (int c = 0; c < 4; ++c)
+						acc[c]	+=	p[c] * weight[t];
+				}
+				for (int c = 0; c < 4; ++c)
+					dst[x * 4 + c]	=	store(acc[c]);
+#endif
+			}
+		}
+	}
+
+	/*
+	 *	column_row for bytes [i, bytes).
+	 */
+	inline void
+	column_bytes(unsigned char* dst, const unsigned char* const* rows, const short* weight, int taps, int i, int bytes)
+	{
+		for (; i < bytes; ++i)
+		{
+			int	acc	=	0;
+			for (int t = 0; t < taps; ++t)
+				acc	+=	rows[t][i] * weight[t];
+			dst[i]	=	store(acc);
+		}
+	}
+
+	/*
+	 *	One output row of vertical: bytes of taps source rows weighted
+	 *	and summed. Rows are taken in pairs, as make_weights pads them.
+	 */
+	void
+	column_row_sse2(unsigned char* dst, const unsigned char* const* rows, const short* weight, int taps, int bytes)
+	{
+		int	i	=	0;
+#ifdef __SSE2__
+		// 8 bytes of two rows interleaved, madd gives 8 channels per tap pair
+		const __m128i	zero	=	_mm_setzero_si128();
+		const __m128i	half	=	_mm_set1_epi32(1 << (precision - 1));
+		for (; i + 8 <= bytes; i += 8)
+		{
+			__m128i	lo	=	half;
+			__m128i	hi	=	half;
+			for (int t = 0; t < taps; t += 2)
+			{
+				__m128i	a	=	_mm_loadl_epi64((const __m128i*) (rows[t] + i));
+				__m128i	b	=	_mm_loadl_epi64((const __m128i*) (rows[t + 1] + i));
+				__m128i	p	=	_mm_unpacklo_epi8(a, b);
+				__m128i	w	=	_mm_set1_epi32(pair(weight[t], weight[t + 1]));
+				lo	=	_mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi8(p, zero), w));
+				hi	=	_mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi8(p, zero), w));
+			}
+
+			lo	=	_mm_srai_epi32(lo, precision);
+			hi	=	_mm_srai_epi32(hi, precision);
+			__m128i	packed	=	_mm_packus_epi16(_mm_packs_epi32(lo, hi), zero);
+			_mm_storel_epi64((__m128i*) (dst + i), packed);
+		}
+#endif
+		column_bytes(dst, rows, weight, taps, i, bytes);
+	}
+
+#ifdef FILTERS_DISPATCH
+	/*
+	 *	column_row, 16 bytes at once. Unpacking and packing both work
+	 *	within 128-bit lanes, so the words come back in order.
+	 */
+	FILTERS_AVX2 void
+	column_row_avx2(unsigned char* dst, const unsigned char* const* rows, const short* weight, int taps, int bytes)
+	{
+		const __m256i	half	=	_mm256_set1_epi32(1 << (precision - 1));
+
+		int	i	=	0;
+		for (; i + 16 <= bytes; i += 16)
+		{
+			__m256i	lo	=	half;
+			__m256i	hi	=	half;
+			for (int t = 0; t < taps; t += 2)
+			{
+				__m256i	a	=	_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (rows[t] + i)));
+				__m256i	b	=	_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (rows[t + 1] + i)));
+				__m256i	w	=	_mm256_set1_epi32(pair(weight[t], weight[t + 1]));
+				lo	=	_mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+				hi	=	_mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+			}
+
+			__m256i	words	=	_mm256_packs_epi32(_mm256_srai_epi32(lo, precision), _mm256_srai_epi32(hi, precision));
+			__m256i	bytes16	=	_mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+			_mm_storeu_si128((__m128i*) (dst + i), _mm256_castsi256_si128(bytes16));
+		}
+		column_bytes(dst, rows, weight, taps, i, bytes);
+	}
+
+FILTERS_AVX512_BEGIN
+	/*
+	 *	column_row_avx2, 32 bytes at once.
+	 */
+	FILTERS_AVX512 void
+	column_row_avx512(unsigned char* dst, const unsigned char* const* rows, const short* weight, int taps, int bytes)
+	{
+		const __m512i	half	=	_mm512_set1_epi32(1 << (precision - 1));
+		const __m512i	zero	=	_mm512_setzero_si512();
+
+		int	i	=	0;
+		for (; i + 32 <= bytes; i += 32)
+		{
+			__m512i	lo	=	half;
+			__m512i	hi	=	half;
+			for (int t = 0; t < taps; t += 2)
+			{
+				__m512i	a	=	_mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*) (rows[t] + i)));
+				__m512i	b	=	_mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*) (rows[t + 1] + i)));
+				__m512i	w	=	_mm512_set1_epi32(pair(weight[t], weight[t + 1]));
+				lo	=	_mm512_add_epi32(lo, _mm512_madd_epi16(_mm512_unpacklo_epi16(a, b), w));
+				hi	=	_mm512_add_epi32(hi, _mm512_madd_epi16(_mm512_unpackhi_epi16(a, b), w));
+			}
+
+			__m512i	words	=	_mm512_packs_epi32(_mm512_srai_epi32(lo, precision), _mm512_srai_epi32(hi, precision));
+			_mm256_storeu_si256((__m256i*) (dst + i), _mm512_cvtusepi16_epi8(_mm512_max_epi16(words, zero)));
+		}
+		column_bytes(dst, rows, weight, taps, i, bytes);
+	}
+FILTERS_AVX512_END
+#endif
+
+	typedef	void (*column_row_fn)(unsigned char* dst, const unsigned char* const* rows, const short* weight, int taps, int bytes);
+
+	const column_row_fn	column_row	=	FILTERS_PICK(column_row_sse2, column_row_avx2, column_row_avx512);
+
+	/*
+	 *	Resamples columns. out has in's width and table's height.
+	 */
+	void
+	vertical(const image& in, const image& out, const weights& table)
+	{
+		const int							taps	=	table.taps;
+		std::vector<const unsigned char*>	rows(taps);
+
+		for (int y = 0; y < out.height; ++y)
+		{
+			for (int t = 0; t < taps; ++t)
+				rows[t]	=	filters::raster::row(in, table.index[y * taps + t]);
+			column_row(filters::raster::row(out, y), rows.data(), &table.weight[y * taps], taps, out.width * 4);
+		}
+	}
+}
+
+ALLEGRO_BITMAP*
+filters::resize(ALLEGRO_BITMAP* source, int width, int height, resize_mode mode)
+{
+	if (width <= 0 || height <= 0)	return nullptr;
+
+	return	raster::into_bitmap(source, width, height, [&](const image& in, const image& out)
+	{
+		return	resize(raster::view_of(in), raster::view_of(out), mode);
+	});
+}
+
+bool
+filters::resize(const view& source, const view& output, resize_mode mode)
+{
+	image	in	=	raster::open(source);
+	image	out	=	raster::open(output);
+	if (!in.data || !out.data)	return false;
+
+	const int	img_w	=	in.width;
+	const int	img_h	=	in.height;
+	const int	width	=	out.width;
+	const int	height	=	out.height;
+
+	// the second pass writes out while the first still reads in
+	std::vector<unsigned char>	copy;
+	if (in.data == out.data)
+	{
+		copy.resize(img_w * img_h * 4);
+		in	=	raster::wrap(img_w, img_h, copy.data());
+		raster::copy(raster::open(source), in);
+	}
+
+	weights	columns	=	make_weights(img_w, width, mode);
+	weights	rows	=	make_weights(img_h, height, mode);
+
+	// pass that shrinks more goes first, so the second pass has less to read
+	long long	rows_first		=	(long long) img_w * height * rows.taps		+	(long long) width * height * columns.taps;
+	long long	columns_first	=	(long long) width * img_h * columns.taps	+	(long long) width * height * rows.taps;
+
+	std::vector<unsigned char>	scratch;
+	if (columns_first <= rows_first)
+	{
+		scratch.resize(width * img_h * 4);
+		image	tmp	=	raster::wrap(width, img_h, scratch.data());
+		horizontal(in, tmp, columns);
+		vertical(tmp, out, rows);
+	}
+	else
+	{
+		scratch.resize(img_w * height * 4);
+		image	tmp	=	raster::wrap(img_w, height, scratch.data());
+		vertical(in, tmp, rows);
+		horizontal(tmp, out, columns);
+	}
+
+	return	true;
+}
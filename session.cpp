@@ -0,0 +1,164 @@
+#include "session.hpp"
+#include "raster.hpp"
+
+namespace
+{
+	using filters::raster::rect;
+
+	bool
+	overlaps(const rect& a, const rect& b)
+	{
+		return	a.x < b.x + b.w	&&	b.x < a.x + a.w	&&
+				a.y < b.y + b.h	&&	b.y < a.y + a.h;
+	}
+
+	rect
+	bounding(const rect& a, const rect& b)
+	{
+		rect	r;
+		r.x	=	std::min(a.x, b.x);
+		r.y	=	std::min(a.y, b.y);
+		r.w	=	std::max(a.x + a.w, b.x + b.w)	-	r.x;
+		r.h	=	std::max(a.y + a.h, b.y + b.h)	-	r.y;
+		return	r;
+	}
+
+	/*
+	 *	Splits range [beg, beg + len) of axis of size n into parts inside
+	 *	[0, n). Parts sticking out are wrapped to the opposite side when
+	 *	wrap is set, dropped otherwise.
+	 */
+	void
+	split_axis(int beg, int len, int n, bool wrap, std::vector<std::pair<int, int> >& parts)
+	{
+		if (wrap && len >= n)
+		{
+			parts.push_back(std::make_pair(0, n));
+			return;
+		}
+
+		int	lo	=	std::max(beg, 0);
+		int	hi	=	std::min(beg + len, n);
+		if (hi > lo)	parts.push_back(std::make_pair(lo, hi - lo));
+		if (!wrap)		return;
+
+		if (beg < 0)		parts.push_back(std::make_pair(n + beg, -beg));
+		if (beg + len > n)	parts.push_back(std::make_pair(0, beg + len - n));
+	}
+}
+
+filters::session::session(ALLEGRO_BITMAP* source, filter_fn filter, int radius, border_mode mode)
+	:	source_(source),
+		output_(filter(source, region())),
+		filter_(filter),
+		radius_(radius),
+		mode_(mode)
+{
+}
+
+filters::session::session(session&& other)
+	:	source_(other.source_),
+		output_(other.output_),
+		filter_(other.filter_),
+		radius_(other.radius_),
+		mode_(other.mode_)
+{
+	other.output_	=	nullptr;
+}
+
+filters::session::~session()
+{
+	if (output_ && output_ != source_)
+		al_destroy_bitmap(output_);
+}
+
+filters::session
+filters::session::gaussian_blur(ALLEGRO_BITMAP* source, unsigned int n, border edge)
+{
+	return	session(source, [n, edge](ALLEGRO_BITMAP* src, region roi)
+	{
+		return	filters::gaussian_blur(src, n, edge, roi);
+	}, 3 * n, edge.mode);
+}
+
+filters::session
+filters::session::gaussian_blur_optimized(ALLEGRO_BITMAP* source, unsigned int n, border edge)
+{
+	return	session(source, [n, edge](ALLEGRO_BITMAP* src, region roi)
+	{
+		return	filters::gaussian_blur_optimized(src, n, edge, roi);
+	}, 3 * n, edge.mode);
+}
+
+filters::session
+filters::session::box_blur(ALLEGRO_BITMAP* source, unsigned int n, border edge)
+{
+	return	session(source, [n, edge](ALLEGRO_BITMAP* src, region roi)
+	{
+		return	filters::box_blur(src, n, edge, roi);
+	}, n, edge.mode);
+}
+
+filters::session
+filters::session::sharpen(ALLEGRO_BITMAP* source, border edge)
+{
+	return	session(source, [edge](ALLEGRO_BITMAP* src, region roi)
+	{
+		return	filters::sharpen(src, edge, roi);
+	}, 1, edge.mode);
+}
+
+ALLEGRO_BITMAP*
+filters::session::update(const std::vector<region>& dirty)
+{
+	if (!output_ || output_ == source_)	return output_;
+
+	int					img_w	=	al_get_bitmap_width(source_);
+	int					img_h	=	al_get_bitmap_height(source_);
+	bool				wrap	=	mode_ == BORDER_WRAP;
+	std::vector<rect>	rects;
+
+	for (std::size_t i = 0; i < dirty.size(); ++i)
+	{
+		rect	d	=	raster::clip(dirty[i], img_w, img_h);
+		if (d.w <= 0 || d.h <= 0)	continue;
+
+		std::vector<std::pair<int, int> >	xs;
+		std::vector<std::pair<int, int> >	ys;
+		split_axis(d.x - radius_, d.w + 2 * radius_, img_w, wrap, xs);
+		split_axis(d.y - radius_, d.h + 2 * radius_, img_h, wrap, ys);
+
+		for (std::size_t y = 0; y < ys.size(); ++y)
+			for (std::size_t x = 0; x < xs.size(); ++x)
+			{
+				rect	r	=	{xs[x].first, ys[y].first, xs[x].second, ys[y].second};
+				rects.push_back(r);
+			}
+	}
+
+	// merging may make a rectangle overlap one already checked, so repeat until stable
+	for (bool merged = true; merged; )
+	{
+		merged	=	false;
+		for (std::size_t i = 0; i < rects.size(); ++i)
+			for (std::size_t j = i + 1; j < rects.size(); ++j)
+				if (overlaps(rects[i], rects[j]))
+				{
+					rects[i]	=	bounding(rects[i], rects[j]);
+					rects.erase(rects.begin() + j);
+					merged		=	true;
+					--j;
+				}
+	}
+
+	for (std::size_t i = 0; i < rects.size(); ++i)
+		filter_(source_, region(rects[i].x, rects[i].y, rects[i].w, rects[i].h, output_));
+
+	return	output_;
+}
+
+ALLEGRO_BITMAP*
+filters::session::output() const
+{
+	return	output_;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "filters.hpp"
+
+/**
+ *	sesja trzyma ostatni wynik filtra, po zmianie kawałka źródła
+ *	przelicza tylko piksele wyniku, na które ta zmiana ma wpływ.
+*/
+
+namespace filters
+{
+	class session
+	{
+	public:
+		/*
+		 *	Filter applied by session. Has to honour region argument,
+		 *	all filters taking region do.
+		 */
+		typedef	std::function<ALLEGRO_BITMAP* (ALLEGRO_BITMAP* source, region roi)>	filter_fn;
+
+		/*
+		 *			source bitmap	,	filter		,	reach of filter	,	border mode
+		 *	ARGS:	ALLEGRO_BITMAP*	,	filter_fn	,	int				,	[border_mode]
+		 *	Runs filter on the whole source once and keeps the output.
+		 *	Radius is how far one source pixel can change output:
+		 *	kernel radius times number of iterations. With BORDER_WRAP
+		 *	changes near the edge also reach the opposite edge.
+		 *	Source is not owned, it has to outlive the session.
+		 */
+		session(ALLEGRO_BITMAP* source, filter_fn filter, int radius, border_mode mode = BORDER_WRAP);
+		session(session&& other);
+		~session();
+
+		/*
+		 *			source bitmap	,	# of iterations	,	border handling
+		 *	ARGS:	ALLEGRO_BITMAP*	,	[int]			,	[border]
+		 *	RET:	session
+		 *	Sessions for filters with known reach.
+		 */
+		static session	gaussian_blur(ALLEGRO_BITMAP* source, unsigned int n = 1, border edge = BORDER_WRAP);
+		static session	gaussian_blur_optimized(ALLEGRO_BITMAP* source, unsigned int n = 1, border edge = BORDER_WRAP);
+		static session	box_blur(ALLEGRO_BITMAP* source, unsigned int n = 1, border edge = BORDER_WRAP);
+		static session	sharpen(ALLEGRO_BITMAP* source, border edge = BORDER_WRAP);
+
+		/*
+		 *			changed parts of source
+		 *	ARGS:	std::vector<region>
+		 *	RET:	ALLEGRO_BITMAP*
+		 *	Refilters output pixels affected by changed source rectangles.
+		 *	Each rectangle is grown by radius, overlapping ones are merged
+		 *	so no pixel is computed twice.
+		 *	Returns output (owned by session).
+		 */
+		ALLEGRO_BITMAP*
+		update(const std::vector<region>& dirty);
+
+		/*
+		 *	Last output, owned by session.
+		 */
+		ALLEGRO_BITMAP*
+		output() const;
+
+	private:
+		session(const session&)				=	delete;
+		session&	operator=(const session&)	=	delete;
+
+		ALLEGRO_BITMAP*	source_;
+		ALLEGRO_BITMAP*	output_;
+		filter_fn		filter_;
+		int				radius_;
+		border_mode		mode_;
+	};
+}
@@ -0,0 +1,395 @@
+#include "stream.hpp"
+#include "parallel.hpp"
+
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace
+{
+	using filters::planar::image;
+
+	inline unsigned char
+	clamp(int v)
+	{
+		return	v < 0 ? 0 : v > 255 ? 255 : v;
+	}
+
+	/*
+	 *	sum / d rounded to nearest, d > 0.
+	 */
+	inline int
+	rounded(int sum, int d)
+	{
+		return	(sum + (sum >= 0 ? d / 2 : -d / 2)) / d;
+	}
+
+	/*
+	 *	Frame layout: size of frame and of its chroma planes
+	 *	(chroma_shift 1 for 4:2:0, 0 for 4:4:4).
+	 */
+	struct layout
+	{
+		filters::stream::frame_format	format;
+		int								width;
+		int								height;
+		int								chroma_shift;
+
+		int
+		chroma_w() const
+		{
+			return	(width + (1 << chroma_shift) - 1) >> chroma_shift;
+		}
+
+		int
+		chroma_h() const
+		{
+			return	(height + (1 << chroma_shift) - 1) >> chroma_shift;
+		}
+
+		std::size_t
+		bytes() const
+		{
+			if (format == filters::stream::FRAME_RGB)
+				return	(std::size_t) width * height * 3;
+			return	(std::size_t) width * height + 2 * (std::size_t) chroma_w() * chroma_h();
+		}
+	};
+
+	bool
+	read_line(std::FILE* input, std::string& line)
+	{
+		line.clear();
+		for (int c = std::fgetc(input); c != EOF; c = std::fgetc(input))
+		{
+			if (c == '\n')	return true;
+			if (line.size() > 4096)	return false;
+			line	+=	char(c);
+		}
+		return	false;
+	}
+
+	/*
+	 *	Size and chroma subsampling from YUV4MPEG2 header.
+	 */
+	bool
+	parse_header(const std::string& header, layout& l)
+	{
+		if (header.compare(0, 10, "YUV4MPEG2 ") != 0)	return false;
+
+		l.width			=	0;
+		l.height		=	0;
+		l.chroma_shift	=	1;
+		std::size_t	pos	=	9;
+		while (pos < header.size())
+		{
+			std::size_t	end		=	header.find(' ', pos + 1);
+			std::string	token	=	header.substr(pos + 1, end == std::string::npos ? std::string::npos : end - pos - 1);
+			pos	=	end;
+
+			if (token.empty())	continue;
+			if (token[0] == 'W')	l.width		=	std::atoi(token.c_str() + 1);
+			if (token[0] == 'H')	l.height	=	std::atoi(token.c_str() + 1);
+			if (token[0] == 'C')
+			{
+				if (token.compare(0, 4, "C444") == 0)		l.chroma_shift	=	0;
+				else if (token.compare(0, 4, "C420") != 0)	return false;
+			}
+		}
+		return	l.width > 0 && l.height > 0;
+	}
+
+	bool
+	read_frame(std::FILE* input, const layout& l, std::vector<unsigned char>& frame)
+	{
+		if (l.format == filters::stream::FRAME_Y4M)
+		{
+			std::string	line;
+			if (!read_line(input, line) || line.compare(0, 5, "FRAME") != 0)
+				return	false;
+		}
+		return	std::fread(frame.data(), 1, frame.size(), input) == frame.size();
+	}
+
+	bool
+	write_frame(std::FILE* output, const layout& l, const std::vector<unsigned char>& frame)
+	{
+		if (l.format == filters::stream::FRAME_Y4M && std::fputs("FRAME\n", output) < 0)
+			return	false;
+		return	std::fwrite(frame.data(), 1, frame.size(), output) == frame.size();
+	}
+
+	/*
+	 *	Raw frame into R, G, B planes. YUV is BT.601 limited range,
+	 *	every chroma sample is used by all pixels it covers.
+	 */
+	void
+	unpack(const std::vector<unsigned char>& frame, const layout& l, image& img)
+	{
+		filters::parallel::for_bands(l.height, [&](int, int begin, int end)
+		{
+			for (int y = begin; y < end; ++y)
+			{
+				unsigned char*	r	=	img.row(0, y);
+				unsigned char*	g	=	img.row(1, y);
+				unsigned char*	b	=	img.row(2, y);
+
+				if (l.format == filters::stream::FRAME_RGB)
+				{
+					const unsigned char*	src	=	&frame[(std::size_t) y * l.width * 3];
+					for (int x = 0; x < l.width; ++x, src += 3)
+					{
+						r[x]	=	src[0];
+						g[x]	=	src[1];
+						b[x]	=	src[2];
+					}
+					continue;
+				}
+
+				const int				s	=	l.chroma_shift;
+				const unsigned char*	py	=	&frame[(std::size_t) y * l.width];
+				const unsigned char*	pu	=	&frame[(std::size_t) l.width * l.height + (std::size_t) (y >> s) * l.chroma_w()];
+				const unsigned char*	pv	=	pu + (std::size_t) l.chroma_w() * l.chroma_h();
+				for (int x = 0; x < l.width; ++x)
+				{
+					int	c	=	298 * (py[x] - 16) + 128;
+					int	d	=	pu[x >> s] - 128;
+					int	e	=	pv[x >> s] - 128;
+					r[x]	=	clamp((c + 409 * e) >> 8);
+					g[x]	=	clamp((c - 100 * d - 208 * e) >> 8);
+					b[x]	=	clamp((c + 516 * d) >> 8);
+				}
+			}
+		});
+	}
+
+	/*
+	 *	R, G, B planes back into raw frame. Chroma of 4:2:0 is the
+	 *	average of its pixels' chroma.
+	 */
+	void
+	pack(const image& img, const layout& l, std::vector<unsigned char>& frame)
+	{
+		if (l.format == filters::stream::FRAME_RGB)
+		{
+			filters::parallel::for_bands(l.height, [&](int, int begin, int end)
+			{
+				for (int y = begin; y < end; ++y)
+				{
+					const unsigned char*	r	=	img.row(0, y);
+					const unsigned char*	g	=	img.row(1, y);
+					const unsigned char*	b	=	img.row(2, y);
+					unsigned char*			dst	=	&frame[(std::size_t) y * l.width * 3];
+					for (int x = 0; x < l.width; ++x, dst += 3)
+					{
+						dst[0]	=	r[x];
+						dst[1]	=	g[x];
+						dst[2]	=	b[x];
+					}
+				}
+			});
+			return;
+		}
+
+		// bands of chroma rows, so every band owns whole blocks of luma rows
+		const int	s	=	l.chroma_shift;
+		const int	cw	=	l.chroma_w();
+		filters::parallel::for_bands(l.chroma_h(), [&](int, int begin, int end)
+		{
+			std::vector<int>	u(cw);
+			std::vector<int>	v(cw);
+			std::vector<int>	n(cw);
+			for (int cy = begin; cy < end; ++cy)
+			{
+				std::fill(u.begin(), u.end(), 0);
+				std::fill(v.begin(), v.end(), 0);
+				std::fill(n.begin(), n.end(), 0);
+
+				for (int y = cy << s; y < std::min((cy + 1) << s, l.height); ++y)
+				{
+					const unsigned char*	r	=	img.row(0, y);
+					const unsigned char*	g	=	img.row(1, y);
+					const unsigned char*	b	=	img.row(2, y);
+					unsigned char*			py	=	&frame[(std::size_t) y * l.width];
+					for (int x = 0; x < l.width; ++x)
+					{
+						py[x]		=	((66 * r[x] + 129 * g[x] + 25 * b[x] + 128) >> 8) + 16;
+						u[x >> s]	+=	-38 * r[x] - 74 * g[x] + 112 * b[x];
+						v[x >> s]	+=	112 * r[x] - 94 * g[x] - 18 * b[x];
+						++n[x >> s];
+					}
+				}
+
+				unsigned char*	pu	=	&frame[(std::size_t) l.width * l.height + (std::size_t) cy * cw];
+				unsigned char*	pv	=	pu + (std::size_t) cw * l.chroma_h();
+				for (int x = 0; x < cw; ++x)
+				{
+					int	d	=	n[x] * 256;
+					pu[x]	=	clamp(rounded(u[x], d) + 128);
+					pv[x]	=	clamp(rounded(v[x], d) + 128);
+				}
+			}
+		}, 1);
+	}
+}
+
+filters::stream::chain&
+filters::stream::chain::then(step s)
+{
+	steps_.push_back(s);
+	return	*this;
+}
+
+filters::stream::chain&
+filters::stream::chain::lut(const unsigned char table[3][256])
+{
+	std::vector<unsigned char>	t(&table[0][0], &table[0][0] + 3 * 256);
+	return	then([t](planar::image& frame)
+	{
+		parallel::for_bands(frame.height, [&](int, int begin, int end)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				const unsigned char*	map	=	&t[c * 256];
+				for (int y = begin; y < end; ++y)
+				{
+					unsigned char*	p	=	frame.row(c, y);
+					for (int x = 0; x < frame.width; ++x)
+						p[x]	=	map[p[x]];
+				}
+			}
+		});
+	});
+}
+
+filters::stream::chain&
+filters::stream::chain::lighten(int n)
+{
+	unsigned char	table[3][256];
+	for (int c = 0; c < 3; ++c)
+		for (int v = 0; v < 256; ++v)
+			table[c][v]	=	std::min(std::max(v + n, 0), 255);
+	return	lut(table);
+}
+
+filters::stream::chain&
+filters::stream::chain::contrast(float n)
+{
+	unsigned char	table[3][256];
+	for (int c = 0; c < 3; ++c)
+		for (int v = 0; v < 256; ++v)
+			table[c][v]	=	(v * n) <= 255 ? std::max(int(v * n), 0) : 255;
+	return	lut(table);
+}
+
+filters::stream::chain&
+filters::stream::chain::gaussian_blur(unsigned int n, border edge)
+{
+	return	then([n, edge](planar::image& frame)
+	{
+		planar::gaussian_blur(frame, n, edge);
+	});
+}
+
+filters::stream::chain&
+filters::stream::chain::box_blur(unsigned int n, border edge)
+{
+	return	then([n, edge](planar::image& frame)
+	{
+		planar::box_blur(frame, n, edge);
+	});
+}
+
+void
+filters::stream::chain::run(planar::image& frame) const
+{
+	for (std::size_t i = 0; i < steps_.size(); ++i)
+		steps_[i](frame);
+}
+
+long
+filters::stream::run(std::FILE* input, std::FILE* output, const chain& filters, frame_format format, int width, int height)
+{
+	layout	l	=	{format, width, height, 0};
+	if (format == FRAME_Y4M)
+	{
+		std::string	header;
+		if (!read_line(input, header) || !parse_header(header, l))	return -1;
+		if (std::fprintf(output, "%s\n", header.c_str()) < 0)		return -1;
+	}
+	if (l.width <= 0 || l.height <= 0)	return -1;
+
+	// all buffers live for the whole stream: two input frames (one being
+	// read while the other is filtered), planes and output frame
+	std::vector<unsigned char>	in[2];
+	std::vector<unsigned char>	out(l.bytes());
+	in[0].resize(l.bytes());
+	in[1].resize(l.bytes());
+
+	planar::image	planes;
+	planar::allocate(planes, l.width, l.height, 3);
+
+	// one reader thread for the whole stream fills the two input frames
+	// in turn; a frame is handed over by full[i] and given back once
+	// it's unpacked, so the reader never waits on filtering
+	std::mutex				lock;
+	std::condition_variable	changed;
+	bool					full[2]	=	{false, false};
+	bool					read[2]	=	{false, false};
+	bool					stop	=	false;
+
+	std::thread	reader([&]()
+	{
+		for (int next = 0; ; next ^= 1)
+		{
+			{
+				std::unique_lock<std::mutex>	guard(lock);
+				changed.wait(guard, [&]() { return stop || !full[next]; });
+				if (stop)	return;
+			}
+
+			bool	ok	=	read_frame(input, l, in[next]);
+
+			std::lock_guard<std::mutex>	guard(lock);
+			read[next]	=	ok;
+			full[next]	=	true;
+			changed.notify_all();
+			if (!ok)	return;
+		}
+	});
+
+	long	frames	=	0;
+	for (int current = 0; ; current ^= 1)
+	{
+		{
+			std::unique_lock<std::mutex>	guard(lock);
+			changed.wait(guard, [&]() { return full[current]; });
+			if (!read[current])	break;
+		}
+
+		unpack(in[current], l, planes);
+		{
+			std::lock_guard<std::mutex>	guard(lock);
+			full[current]	=	false;
+			changed.notify_all();
+		}
+
+		filters.run(planes);
+		pack(planes, l, out);
+		if (!write_frame(output, l, out))	break;
+		++frames;
+	}
+
+	{
+		std::lock_guard<std::mutex>	guard(lock);
+		stop	=	true;
+		changed.notify_all();
+	}
+	reader.join();
+
+	std::fflush(output);
+	return	frames;
+}
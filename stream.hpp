@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#include "filters.hpp"
+#include "planar.hpp"
+
+/**
+ *	tryb strumienia: klatki wideo czytane z wejścia (y4m albo surowe RGB),
+ *	filtrowane tym samym łańcuchem i pisane na wyjście. bufory klatek
+ *	są tworzone raz, na pierwszej klatce.
+*/
+
+namespace filters
+{
+	namespace stream
+	{
+		enum frame_format
+		{
+			FRAME_RGB,	// raw 8-bit R G B, fixed size given by caller
+			FRAME_Y4M	// YUV4MPEG2, 4:2:0 or 4:4:4, size from header
+		};
+
+		/*
+		 *	Filters run on every frame, in order, on planes of one frame.
+		 *	Steps are planned once; table based ones bake their table
+		 *	when added.
+		 */
+		class chain
+		{
+		public:
+			typedef	std::function<void (planar::image& frame)>	step;
+
+			chain&	then(step s);
+
+			/*
+			 *			table per channel
+			 *	ARGS:	const unsigned char[3][256]
+			 *	Point filter: every value of plane c goes through table[c].
+			 */
+			chain&	lut(const unsigned char table[3][256]);
+
+			/*
+			 *	Same results as filters::lighten and filters::contrast.
+			 */
+			chain&	lighten(int n);
+			chain&	contrast(float n);
+
+			/*
+			 *	planar::gaussian_blur / planar::box_blur.
+			 */
+			chain&	gaussian_blur(unsigned int n = 1, border edge = BORDER_CLAMP);
+			chain&	box_blur(unsigned int n = 1, border edge = BORDER_CLAMP);
+
+			void
+			run(planar::image& frame) const;
+
+		private:
+			std::vector<step>	steps_;
+		};
+
+		/*
+		 *			input	,	output	,	filters	,	format			,	[frame width]	,	[frame height]
+		 *	ARGS:	FILE*	,	FILE*	,	chain	,	frame_format	,	[int]			,	[int]
+		 *	RET:	long
+		 *	Filters frames from input until it ends. Size of FRAME_RGB
+		 *	frames is given, y4m takes it from the header, which is copied
+		 *	to output. Reading the next frame overlaps filtering of the
+		 *	current one.
+		 *	Returns # of frames written, -1 for bad size or header.
+		 */
+		long
+		run(std::FILE* input, std::FILE* output, const chain& filters, frame_format format, int width = 0, int height = 0);
+	}
+}
@@ -0,0 +1,635 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../filters.hpp"
+#include "../raster.hpp"
+#include "../planar.hpp"
+#include "../stream.hpp"
+#include "../cpu.hpp"
+#include "../session.hpp"
+#include "reference.hpp"
+
+/**
+ *	test różnicowy: każdy filtr liczony w pierwotnej postaci (reference)
+ *	i we wszystkich szybkich wersjach (bitmapa, widok, kafelki, sesja,
+ *	obraz planarny) na losowych obrazach losowych rozmiarów. wypisuje
+ *	największy błąd na kanał i PSNR, kończy się błędem, gdy któraś
+ *	wersja przekroczy tolerancję swojego filtra.
+ *
+ *	./differential [# of rounds] [seed]
+*/
+
+namespace
+{
+	struct picture
+	{
+		int							width;
+		int							height;
+		std::vector<unsigned char>	pixels;
+
+		picture(int width = 0, int height = 0)
+			:	width(width), height(height), pixels(width * height * 4)
+		{
+		}
+
+		filters::view
+		view() const
+		{
+			return	filters::view((void*) pixels.data(), width, height, width * 4);
+		}
+	};
+
+	/*
+	 *	Everything one round of one filter is run with.
+	 */
+	struct inputs
+	{
+		picture			a;
+		picture			b;
+		picture			mask;
+		unsigned int	n;
+		int				shift;
+		float			factor;
+		float			alpha;
+		ALLEGRO_COLOR	from;
+		ALLEGRO_COLOR	to;
+		std::mt19937*	g;
+	};
+
+	typedef	std::function<picture (const inputs&)>	run_fn;
+
+	/*
+	 *	Alpha is not compared for variants that have no alpha (planes
+	 *	of video frames).
+	 */
+	struct variant
+	{
+		std::string	name;
+		run_fn		run;
+		bool		alpha;
+	};
+
+	/*
+	 *	Largest allowed difference of any channel from the reference
+	 *	and lowest allowed PSNR of R, G, B over all rounds.
+	 */
+	struct filter_case
+	{
+		std::string				name;
+		int						tolerance;
+		double					min_psnr;
+		run_fn					reference;
+		std::vector<variant>	variants;
+	};
+
+	/*
+	 *	Worst result of one variant so far.
+	 */
+	struct stats
+	{
+		int		max_error[4];
+		double	min_psnr;
+	};
+
+	/*
+	 *	Noise, smooth ramps, flat areas and hard edges, so that both
+	 *	clamping and rounding get exercised.
+	 */
+	picture
+	random_picture(std::mt19937& g, int width, int height)
+	{
+		picture	p(width, height);
+		int		kind	=	g() % 4;
+		int		base[4]	=	{int(g() % 256), int(g() % 256), int(g() % 256), int(g() % 256)};
+
+		for (int y = 0; y < height; ++y)
+			for (int x = 0; x < width; ++x)
+				for (int c = 0; c < 4; ++c)
+				{
+					int	v;
+					switch (kind)
+					{
+					case 0:		v	=	g() % 256;															break;
+					case 1:		v	=	(base[c] + x * 255 / width + y * 255 / height) % 256;			break;
+					case 2:		v	=	((x / 8 + y / 8) & 1) ? 255 - base[c] * (g() % 2) : base[c];	break;
+					default:	v	=	std::min(std::max(base[c] + int(g() % 31) - 15, 0), 255);		break;
+					}
+					p.pixels[(y * width + x) * 4 + c]	=	v;
+				}
+		return	p;
+	}
+
+	ALLEGRO_BITMAP*
+	to_bitmap(const picture& p)
+	{
+		ALLEGRO_BITMAP*			bitmap	=	al_create_bitmap(p.width, p.height);
+		filters::raster::image	img		=	filters::raster::lock(bitmap, ALLEGRO_LOCK_WRITEONLY);
+		for (int y = 0; y < p.height; ++y)
+			std::memcpy(filters::raster::row(img, y), &p.pixels[y * p.width * 4], p.width * 4);
+		al_unlock_bitmap(bitmap);
+		return	bitmap;
+	}
+
+	picture
+	from_bitmap(ALLEGRO_BITMAP* bitmap)
+	{
+		picture	p;
+		if (!bitmap)	return p;
+
+		filters::raster::image	img	=	filters::raster::lock(bitmap, ALLEGRO_LOCK_READONLY);
+		p	=	picture(img.width, img.height);
+		for (int y = 0; y < p.height; ++y)
+			std::memcpy(&p.pixels[y * p.width * 4], filters::raster::row(img, y), p.width * 4);
+		al_unlock_bitmap(bitmap);
+		return	p;
+	}
+
+	/*
+	 *	Per channel error of out against ref, PSNR of colour channels
+	 *	(infinity when equal). Different sizes count as the worst error.
+	 */
+	void
+	compare(const picture& ref, const picture& out, bool alpha, int* max_error, double& psnr)
+	{
+		if (ref.width != out.width || ref.height != out.height)
+		{
+			for (int c = 0; c < 4; ++c)
+				max_error[c]	=	256;
+			psnr	=	0.0;
+			return;
+		}
+
+		double	squares	=	0.0;
+		for (int c = 0; c < 4; ++c)
+			max_error[c]	=	0;
+		for (std::size_t i = 0; i < ref.pixels.size(); ++i)
+		{
+			int	d	=	std::abs(ref.pixels[i] - out.pixels[i]);
+			if (i % 4 == 3 && !alpha)	continue;
+
+			max_error[i % 4]	=	std::max(max_error[i % 4], d);
+			if (i % 4 != 3)	squares	+=	d * d;
+		}
+
+		double	mse	=	squares / std::max<std::size_t>(ref.pixels.size() / 4 * 3, 1);
+		psnr	=	mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : std::numeric_limits<double>::infinity();
+	}
+
+	/*
+	 *	Ways of running a filter, each one a separate code path.
+	 */
+	variant
+	bitmap_variant(std::function<ALLEGRO_BITMAP* (ALLEGRO_BITMAP*, const inputs&)> fn)
+	{
+		variant	v	=	{"bitmap", [fn](const inputs& in)
+		{
+			ALLEGRO_BITMAP*	source	=	to_bitmap(in.a);
+			ALLEGRO_BITMAP*	output	=	fn(source, in);
+			picture			p		=	from_bitmap(output);
+			if (output != source)	al_destroy_bitmap(output);
+			al_destroy_bitmap(source);
+			return	p;
+		}, true};
+		return	v;
+	}
+
+	variant
+	view_variant(std::function<bool (const filters::view&, const filters::view&, const inputs&)> fn)
+	{
+		variant	v	=	{"view", [fn](const inputs& in)
+		{
+			picture	out(in.a.width, in.a.height);
+			if (!fn(in.a.view(), out.view(), in))	return picture();
+			return	out;
+		}, true};
+		return	v;
+	}
+
+	/*
+	 *	Same filter over a bottom-up view written in place.
+	 */
+	variant
+	in_place_variant(std::function<bool (const filters::view&, const filters::view&, const inputs&)> fn)
+	{
+		variant	v	=	{"in place", [fn](const inputs& in)
+		{
+			picture			p		=	in.a;
+			filters::view	flipped(&p.pixels[(p.height - 1) * p.width * 4], p.width, p.height, -p.width * 4);
+			if (!fn(flipped, flipped, in))	return picture();
+			return	p;
+		}, true};
+		return	v;
+	}
+
+	/*
+	 *	Output assembled from random tiles, each one filtered through
+	 *	a region written into the same target.
+	 */
+	variant
+	tiles_variant(std::function<ALLEGRO_BITMAP* (ALLEGRO_BITMAP*, const inputs&, filters::region)> fn)
+	{
+		variant	v	=	{"tiles", [fn](const inputs& in)
+		{
+			ALLEGRO_BITMAP*	source	=	to_bitmap(in.a);
+			ALLEGRO_BITMAP*	target	=	al_create_bitmap(in.a.width, in.a.height);
+			int				tile_w	=	1 + (*in.g)() % 48;
+			int				tile_h	=	1 + (*in.g)() % 48;
+			for (int y = 0; y < in.a.height; y += tile_h)
+				for (int x = 0; x < in.a.width; x += tile_w)
+					fn(source, in, filters::region(x, y, tile_w, tile_h, target));
+
+			picture	p	=	from_bitmap(target);
+			al_destroy_bitmap(target);
+			al_destroy_bitmap(source);
+			return	p;
+		}, true};
+		return	v;
+	}
+
+	/*
+	 *	Session built on a copy of a with one rectangle taken from b;
+	 *	the rectangle is then restored and only it is refiltered.
+	 */
+	variant
+	session_variant(std::function<filters::session (ALLEGRO_BITMAP*, const inputs&)> make)
+	{
+		variant	v	=	{"session", [make](const inputs& in)
+		{
+			std::mt19937&	g	=	*in.g;
+			int				w	=	1 + g() % in.a.width;
+			int				h	=	1 + g() % in.a.height;
+			int				x	=	g() % (in.a.width - w + 1);
+			int				y	=	g() % (in.a.height - h + 1);
+
+			picture	start	=	in.a;
+			for (int row = y; row < y + h; ++row)
+				std::memcpy(&start.pixels[(row * in.a.width + x) * 4], &in.b.pixels[(row * in.a.width + x) * 4], w * 4);
+
+			ALLEGRO_BITMAP*		source	=	to_bitmap(start);
+			filters::session	s		=	make(source, in);
+
+			filters::raster::image	img	=	filters::raster::lock(source, ALLEGRO_LOCK_WRITEONLY);
+			for (int row = 0; row < in.a.height; ++row)
+				std::memcpy(filters::raster::row(img, row), &in.a.pixels[row * in.a.width * 4], in.a.width * 4);
+			al_unlock_bitmap(source);
+
+			picture	p	=	from_bitmap(s.update(std::vector<filters::region>(1, filters::region(x, y, w, h))));
+			al_destroy_bitmap(source);
+			return	p;
+		}, true};
+		return	v;
+	}
+
+	/*
+	 *	Colour planes filtered in place, alpha set opaque on merge.
+	 */
+	variant
+	planar_variant(const std::string& name, std::function<void (filters::planar::image&, const inputs&)> fn)
+	{
+		variant	v	=	{name, [fn](const inputs& in)
+		{
+			filters::raster::image	src	=	filters::raster::open(in.a.view());
+			picture					out(in.a.width, in.a.height);
+			filters::planar::image	planes;
+			filters::planar::split(src, planes, false);
+			fn(planes, in);
+			filters::planar::merge(planes, filters::raster::open(out.view()));
+			return	out;
+		}, false};
+		return	v;
+	}
+
+	/*
+	 *	Red of p copied into green and blue: heights for heightmap,
+	 *	which reads red only where the original read every channel.
+	 */
+	picture
+	heights(const picture& p)
+	{
+		picture	h	=	p;
+		for (std::size_t i = 0; i < h.pixels.size(); i += 4)
+			h.pixels[i + 1]	=	h.pixels[i + 2]	=	h.pixels[i];
+		return	h;
+	}
+
+	/*
+	 *	Sampled blurs draw only taps of non-zero weight, where the original
+	 *	drew any of the 49 cells. On a flat image every drawn tap then
+	 *	gives the image's value back, while a cell of zero weight would
+	 *	add nothing and leave the pixel black. Returns # of pixels more
+	 *	than 1 off the flat value, over all rounds.
+	 */
+	int
+	sampled_taps(std::mt19937& g, int rounds)
+	{
+		int	stray	=	0;
+		for (int round = 0; round < rounds; ++round)
+		{
+			const int		size	=	8 + g() % 24;
+			const int		value	=	1 + g() % 255;
+			const unsigned	samples	=	1 + round % 4;
+
+			picture	flat(size, size);
+			picture	out(size, size);
+			for (std::size_t i = 0; i < flat.pixels.size(); ++i)
+				flat.pixels[i]	=	i % 4 == 3 ? 255 : value;
+
+			filters::gaussian_blur_sampling(flat.view(), out.view(), 1, samples);
+			for (std::size_t i = 0; i < out.pixels.size(); ++i)
+				if (i % 4 != 3)
+					stray	+=	std::abs(out.pixels[i] - value) > 1;
+		}
+		return	stray;
+	}
+
+	std::vector<filter_case>
+	cases()
+	{
+		using namespace filters;
+		typedef	const view&		cv;
+		typedef	const inputs&	ci;
+
+		std::vector<filter_case>	all;
+		filter_case					f;
+
+		f	=	filter_case();
+		f.name		=	"grayscale";
+		f.tolerance	=	0;
+		f.min_psnr	=	std::numeric_limits<double>::infinity();
+		f.reference	=	[](ci in) { picture o(in.a.width, in.a.height); reference::grayscale(in.a.view(), o.view()); return o; };
+		f.variants.push_back(bitmap_variant([](ALLEGRO_BITMAP* s, ci) { return grayscale(s); }));
+		f.variants.push_back(view_variant([](cv s, cv o, ci) { return grayscale(s, o); }));
+		f.variants.push_back(in_place_variant([](cv s, cv o, ci) { return grayscale(s, o); }));
+		f.variants.push_back(tiles_variant([](ALLEGRO_BITMAP* s, ci, region r) { return grayscale(s, r); }));
+		all.push_back(f);
+
+		f	=	filter_case();
+		f.name		=	"black_white";
+		f.tolerance	=	0;
+		f.min_psnr	=	std::numeric_limits<double>::infinity();
+		f.reference	=	[](ci in) { picture o(in.a.width, in.a.height); reference::black_white(in.a.view(), o.view()); return o; };
+		f.variants.push_back(bitmap_variant([](ALLEGRO_BITMAP* s, ci) { return black_white(s); }));
+		f.variants.push_back(view_variant([](cv s, cv o, ci) { return black_white(s, o); }));
+		f.variants.push_back(tiles_variant([](ALLEGRO_BITMAP* s, ci, region r) { return black_white(s, r); }));
+		all.push_back(f);
+
+		f	=	filter_case();
+		f.name		=	"tint";
+		f.tolerance	=	0;
+		f.min_psnr	=	std::numeric_limits<double>::infinity();
+		f.reference	=	[](ci in) { picture o(in.a.width, in.a.height); reference::tint(in.a.view(), o.view()); return o; };
+		f.variants.push_back(bitmap_variant([](ALLEGRO_BITMAP* s, ci) { return tint(s); }));
+		f.variants.push_back(view_variant([](cv s, cv o, ci) { return tint(s, o); }));
+		f.variants.push_back(tiles_variant([](ALLEGRO_BITMAP* s, ci, region r) { return tint(s, r); }));
+		all.push_back(f);
+
+		f	=	filter_case();
+		f.name		=	"lighten";
+		f.tolerance	=	0;
+		f.min_psnr	=	std::numeric_limits<double>::infinity();
+		f.reference	=	[](ci in) { picture o(in.a.width, in.a.height); reference::lighten(in.a.view(), o.view(), in.shift); return o; };
+		f.variants.push_back(bitmap_variant([](ALLEGRO_BITMAP* s, ci in) { return lighten(s, in.shift); }));
+		f.variants.push_back(view_variant([](cv s, cv o, ci in) { return lighten(s, o, in.shift); }));
+		f.variants.push_back(in_place_variant([](cv s, cv o, ci in) { return lighten(s, o, in.shift); }));
+		f.variants.push_back(tiles_variant([](ALLEGRO_BITMAP* s, ci in, region r) { return lighten(s, in.shift, r); }));
+		f.variants.push_back(planar_variant("stream", [](planar::image& p, ci in) { stream::chain().lighten(in.shift).run(p); }));
+		all.push_back(f);
+
+		f	=	filter_case();
+		f.name		=	"contrast";
+		f.tolerance	=	0;
+		f.min_psnr	=	std::numeric_limits<double>::infinity();
+		f.reference	=	[](ci in) { picture o(in.a.width, in.a.height); reference::contrast(in.a.view(), o.view(), in.factor); return o; };
+		f.variants.push_back(bitmap_variant([](ALLEGRO_BITMAP* s, ci in) { return contrast(s, in.factor); }));
+		f.variants.push_back(view_variant([](cv s, cv o, ci in) { return contrast(s, o, in.factor); }));
+		f.variants.push_back(tiles_variant([](ALLEGRO_BITMAP* s, ci in, region r) { return contrast(s, in.factor, r); }));
+		f.variants.push_back(planar_variant("stream", [](planar::image& p, ci in) { stream::chain().contrast(in.factor).run(p); }));
+		all.push_back(f);
+
+		f	=	filter_case();
+		f.name		=	"gaussian_blur";
+		f.tolerance	=	0;
+		f.min_psnr	=	std::numeric_limits<double>::infinity();
+		f.reference	=	[](ci in) { picture o(in.a.width, in.a.height); reference::gaussian_blur(in.a.view(), o.view(), in.n); return o; };
+		f.variants.push_back(bitmap_variant([](ALLEGRO_BITMAP* s, ci in) { return gaussian_blur(s, in.n); }));
+		f.variants.push_back(view_variant([](cv s, cv o, ci in) { return gaussian_blur(s, o, in.n); }));
+		f.variants.push_back(in_place_variant([](cv s, cv o, ci in) { return gaussian_blur(s, o, in.n); }));
+		f.variants.push_back(tiles_variant([](ALLEGRO_BITMAP* s, ci in, region r) { return gaussian_blur(s, in.n, BORDER_WRAP, r); }));
+		f.variants.push_back(session_variant([](ALLEGRO_BITMAP* s, ci in) { return session::gaussian_blur(s, in.n); }));
+		all.push_back(f);
+
+		f	=	filter_case();
+		f.name		=	"gaussian_blur_optimized";
+		f.tolerance	=	0;
+		f.min_psnr	=	std::numeric_limits<double>::infinity();
+		f.reference	=	[](ci in) { picture o(in.a.width, in.a.height); reference::gaussian_blur_optimized(in.a.view(), o.view(), in.n); return o; };
+		f.variants.push_back(bitmap_variant([](ALLEGRO_BITMAP* s, ci in) { return gaussian_blur_optimized(s, in.n); }));
+		f.variants.push_back(view_variant([](cv s, cv o, ci in) { return gaussian_blur_optimized(s, o, in.n); }));
+		f.variants.push_back(tiles_variant([](ALLEGRO_BITMAP* s, ci in, region r) { return gaussian_blur_optimized(s, in.n, BORDER_WRAP, r); }));
+		f.variants.push_back(session_variant([](ALLEGRO_BITMAP* s, ci in) { return session::gaussian_blur_optimized(s, in.n); }));
+		all.push_back(f);
+
+		// fixed-point planes round every pass to nearest where the
+		// original truncates, so they drift by up to a level per pass
+		f.name		=	"planar::gaussian_blur";
+		f.tolerance	=	6;
+		f.min_psnr	=	36.0;
+		f.variants.clear();
+		f.variants.push_back(planar_variant("planar", [](planar::image& p, ci in) { planar::gaussian_blur(p, in.n); }));
+		f.variants.push_back(planar_variant("stream", [](planar::image& p, ci in) { stream::chain().gaussian_blur(in.n, BORDER_WRAP).run(p); }));
+		all.push_back(f);
+
+		f	=	filter_case();
+		f.name		=	"box_blur";
+		f.tolerance	=	0;
+		f.min_psnr	=	std::numeric_limits<double>::infinity();
+		f.reference	=	[](ci in) { picture o(in.a.width, in.a.height); reference::box_blur(in.a.view(), o.view(), in.n); return o; };
+		f.variants.push_back(bitmap_variant([](ALLEGRO_BITMAP* s, ci in) { return box_blur(s, in.n); }));
+		f.variants.push_back(view_variant([](cv s, cv o, ci in) { return box_blur(s, o, in.n); }));
+		f.variants.push_back(tiles_variant([](ALLEGRO_BITMAP* s, ci in, region r) { return box_blur(s, in.n, BORDER_WRAP, r); }));
+		f.variants.push_back(session_variant([](ALLEGRO_BITMAP* s, ci in) { return session::box_blur(s, in.n); }));
+		all.push_back(f);
+
+		f.name		=	"planar::box_blur";
+		f.tolerance	=	6;
+		f.min_psnr	=	36.0;
+		f.variants.clear();
+		f.variants.push_back(planar_variant("planar", [](planar::image& p, ci in) { planar::box_blur(p, in.n); }));
+		f.variants.push_back(planar_variant("stream", [](planar::image& p, ci in) { stream::chain().box_blur(in.n, BORDER_WRAP).run(p); }));
+		all.push_back(f);
+
+		f	=	filter_case();
+		f.name		=	"detect_edges";
+		f.tolerance	=	0;
+		f.min_psnr	=	std::numeric_limits<double>::infinity();
+		f.reference	=	[](ci in) { picture o(in.a.width, in.a.height); reference::detect_edges(in.a.view(), o.view()); return o; };
+		f.variants.push_back(bitmap_variant([](ALLEGRO_BITMAP* s, ci) { return detect_edges(s); }));
+		f.variants.push_back(view_variant([](cv s, cv o, ci) { return detect_edges(s, o); }));
+		f.variants.push_back(tiles_variant([](ALLEGRO_BITMAP* s, ci, region r) { return detect_edges(s, BORDER_WRAP, r); }));
+		all.push_back(f);
+
+		f	=	filter_case();
+		f.name		=	"sharpen";
+		f.tolerance	=	0;
+		f.min_psnr	=	std::numeric_limits<double>::infinity();
+		f.reference	=	[](ci in) { picture o(in.a.width, in.a.height); reference::sharpen(in.a.view(), o.view()); return o; };
+		f.variants.push_back(bitmap_variant([](ALLEGRO_BITMAP* s, ci) { return sharpen(s); }));
+		f.variants.push_back(view_variant([](cv s, cv o, ci) { return sharpen(s, o); }));
+		f.variants.push_back(in_place_variant([](cv s, cv o, ci) { return sharpen(s, o); }));
+		f.variants.push_back(tiles_variant([](ALLEGRO_BITMAP* s, ci, region r) { return sharpen(s, BORDER_WRAP, r); }));
+		f.variants.push_back(session_variant([](ALLEGRO_BITMAP* s, ci) { return session::sharpen(s); }));
+		all.push_back(f);
+
+		f	=	filter_case();
+		f.name		=	"alpha_blending";
+		f.tolerance	=	1;
+		f.min_psnr	=	48.0;
+		f.reference	=	[](ci in) { picture o(in.a.width, in.a.height); reference::alpha_blending(in.a.view(), in.b.view(), in.alpha, o.view()); return o; };
+		f.variants.push_back(bitmap_variant([](ALLEGRO_BITMAP* s, ci in)
+		{
+			ALLEGRO_BITMAP*	fg	=	to_bitmap(in.b);
+			ALLEGRO_BITMAP*	out	=	alpha_blending(s, fg, in.alpha);
+			if (out == fg)	out	=	al_clone_bitmap(fg);
+			al_destroy_bitmap(fg);
+			return	out;
+		}));
+		f.variants.push_back(view_variant([](cv s, cv o, ci in) { return alpha_blending(s, in.b.view(), in.alpha, o); }));
+		all.push_back(f);
+
+		f	=	filter_case();
+		f.name		=	"alpha_blending mask";
+		f.tolerance	=	1;
+		f.min_psnr	=	48.0;
+		f.reference	=	[](ci in) { picture o(in.a.width, in.a.height); reference::alpha_blending(in.a.view(), in.b.view(), in.mask.view(), o.view()); return o; };
+		f.variants.push_back(bitmap_variant([](ALLEGRO_BITMAP* s, ci in)
+		{
+			ALLEGRO_BITMAP*	fg		=	to_bitmap(in.b);
+			ALLEGRO_BITMAP*	mask	=	to_bitmap(in.mask);
+			ALLEGRO_BITMAP*	out		=	alpha_blending(s, fg, mask);
+			al_destroy_bitmap(mask);
+			al_destroy_bitmap(fg);
+			return	out;
+		}));
+		f.variants.push_back(view_variant([](cv s, cv o, ci in) { return alpha_blending(s, in.b.view(), in.mask.view(), o); }));
+		all.push_back(f);
+
+		f	=	filter_case();
+		f.name		=	"heightmap";
+		f.tolerance	=	1;
+		f.min_psnr	=	48.0;
+		f.reference	=	[](ci in) { picture o(in.a.width, in.a.height); reference::heightmap(heights(in.a).view(), o.view()); return o; };
+		f.variants.push_back(bitmap_variant([](ALLEGRO_BITMAP*, ci in)
+		{
+			ALLEGRO_BITMAP*	source	=	to_bitmap(heights(in.a));
+			ALLEGRO_BITMAP*	out		=	perlin::heightmap(source);
+			al_destroy_bitmap(source);
+			return	out;
+		}));
+		f.variants.push_back(view_variant([](cv, cv o, ci in) { return perlin::heightmap(heights(in.a).view(), o); }));
+		all.push_back(f);
+
+		f	=	filter_case();
+		f.name		=	"gradient";
+		f.tolerance	=	0;
+		f.min_psnr	=	std::numeric_limits<double>::infinity();
+		f.reference	=	[](ci in) { picture o(in.a.width, in.a.height); reference::gradient(o.view(), in.from, in.to); return o; };
+		f.variants.push_back(bitmap_variant([](ALLEGRO_BITMAP* s, ci in)
+		{
+			return	gradient(al_get_bitmap_width(s), al_get_bitmap_height(s), in.from, in.to);
+		}));
+		f.variants.push_back(view_variant([](cv, cv o, ci in) { return gradient(o, in.from, in.to); }));
+		all.push_back(f);
+
+		return	all;
+	}
+}
+
+int
+main(int argc, char const *argv[])
+{
+	int				rounds	=	argc > 1 ? std::atoi(argv[1]) : 20;
+	unsigned int	seed	=	argc > 2 ? std::strtoul(argv[2], nullptr, 10) : std::random_device()();
+
+	al_init();
+	al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+	al_set_new_bitmap_format(filters::raster::format);
+
+	std::printf("seed %u, %d rounds, %s kernels\n\n", seed, rounds, filters::cpu::name(filters::cpu::active()));
+
+	std::vector<filter_case>			all	=	cases();
+	std::vector<std::vector<stats> >	worst(all.size());
+	for (std::size_t f = 0; f < all.size(); ++f)
+	{
+		stats	s	=	{{0, 0, 0, 0}, std::numeric_limits<double>::infinity()};
+		worst[f].assign(all[f].variants.size(), s);
+	}
+
+	std::mt19937	g(seed);
+	for (int round = 0; round < rounds; ++round)
+	{
+		// mostly ordinary sizes, sometimes smaller than the kernels
+		int	width	=	g() % 8 ? 1 + g() % 160 : 1 + g() % 6;
+		int	height	=	g() % 8 ? 1 + g() % 120 : 1 + g() % 6;
+
+		inputs	in;
+		in.a		=	random_picture(g, width, height);
+		in.b		=	random_picture(g, width, height);
+		in.mask		=	random_picture(g, width, height);
+		in.n		=	1 + g() % 3;
+		// values that leave the image unchanged come up often enough
+		in.shift	=	g() % 4 ? int(g() % 321) - 160 : 0;
+		in.factor	=	g() % 4 ? (g() % 301) / 100.0f : 1.0f;
+		in.alpha	=	g() % 4 ? (g() % 1001) / 1000.0f : float(g() % 2);
+		in.from		=	al_map_rgb(g() % 256, g() % 256, g() % 256);
+		in.to		=	al_map_rgb(g() % 256, g() % 256, g() % 256);
+		in.g		=	&g;
+
+		for (std::size_t f = 0; f < all.size(); ++f)
+		{
+			picture	ref	=	all[f].reference(in);
+			for (std::size_t v = 0; v < all[f].variants.size(); ++v)
+			{
+				int		error[4];
+				double	psnr;
+				compare(ref, all[f].variants[v].run(in), all[f].variants[v].alpha, error, psnr);
+
+				stats&	s	=	worst[f][v];
+				for (int c = 0; c < 4; ++c)
+					s.max_error[c]	=	std::max(s.max_error[c], error[c]);
+				s.min_psnr	=	std::min(s.min_psnr, psnr);
+			}
+		}
+	}
+
+	int	failed	=	0;
+	int	total	=	0;
+	std::printf("%-24s %-10s %5s %5s %5s %5s %9s   %s\n", "filter", "variant", "R", "G", "B", "A", "PSNR", "tolerance");
+	for (std::size_t f = 0; f < all.size(); ++f)
+		for (std::size_t v = 0; v < all[f].variants.size(); ++v)
+		{
+			const stats&	s	=	worst[f][v];
+			bool			ok	=	s.min_psnr >= all[f].min_psnr;
+			for (int c = 0; c < 4; ++c)
+				ok	=	ok && s.max_error[c] <= all[f].tolerance;
+			failed	+=	!ok;
+			++total;
+
+			std::printf("%-24s %-10s %5d %5d %5d %5d %9.2f   %d / %.0f dB%s\n",
+						all[f].name.c_str(), all[f].variants[v].name.c_str(),
+						s.max_error[0], s.max_error[1], s.max_error[2], s.max_error[3], s.min_psnr,
+						all[f].tolerance, all[f].min_psnr, ok ? "" : "   FAILED");
+		}
+
+	std::printf("\n%d of %d variants out of tolerance\n", failed, total);
+
+	int	stray	=	sampled_taps(g, std::max(rounds, 1) * 8);
+	std::printf("%d pixels of flat gaussian_blur_sampling off by more than 1\n", stray);
+	return	failed || stray ? 1 : 0;
+}
@@ -0,0 +1,329 @@
+#include "reference.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	inline unsigned char*
+	pixel(const filters::view& v, int x, int y)
+	{
+		return	v.data + (std::ptrdiff_t) y * v.pitch + x * 4;
+	}
+
+	inline void
+	put(const filters::view& v, int x, int y, int r, int g, int b)
+	{
+		unsigned char*	p	=	pixel(v, x, y);
+		p[0]	=	r;
+		p[1]	=	g;
+		p[2]	=	b;
+		p[3]	=	255;
+	}
+
+	inline int
+	wrap(int c, int n)
+	{
+		return	((c % n) + n) % n;
+	}
+
+	/*
+	 *	One pass of the original convolution: channel times weight summed
+	 *	over the matrix placed with (anchor_x, anchor_y) on the pixel,
+	 *	then scaled by float factor and truncated.
+	 */
+	void
+	convolve(	const filters::view& in, const filters::view& out, const int* matrix,
+				int matrix_w, int matrix_h, int anchor_x, int anchor_y, float factor)
+	{
+		for (int y = 0; y < in.height; ++y)
+			for (int x = 0; x < in.width; ++x)
+			{
+				int	sum[3]	=	{0, 0, 0};
+				for (int i = 0; i < matrix_h; ++i)
+					for (int j = 0; j < matrix_w; ++j)
+					{
+						const unsigned char*	p	=	pixel(in, wrap(x + j - anchor_x, in.width), wrap(y + i - anchor_y, in.height));
+						for (int c = 0; c < 3; ++c)
+							sum[c]	+=	p[c] * matrix[i * matrix_w + j];
+					}
+
+				put(out, x, y,	std::min(std::max(int(factor * sum[0]), 0), 255),
+								std::min(std::max(int(factor * sum[1]), 0), 255),
+								std::min(std::max(int(factor * sum[2]), 0), 255));
+			}
+	}
+
+	float
+	normalising(const int* matrix, int count)
+	{
+		int	kernel	=	0;
+		for (int i = 0; i < count; ++i)
+			kernel	+=	matrix[i];
+		return	1.0 / kernel;
+	}
+
+	/*
+	 *	Passes run on copies, the last one writes output.
+	 */
+	struct passes
+	{
+		const filters::view&		output;
+		std::vector<unsigned char>	buffers[2];
+		filters::view				current;
+		int							left;
+
+		passes(const filters::view& source, const filters::view& output, int count)
+			:	output(output), current(source), left(count)
+		{
+		}
+
+		filters::view
+		next()
+		{
+			if (--left == 0)	return output;
+
+			std::vector<unsigned char>&	b	=	buffers[left & 1];
+			b.resize(output.width * output.height * 4);
+			return	filters::view(b.data(), output.width, output.height, output.width * 4);
+		}
+
+		void
+		run(const int* matrix, int matrix_w, int matrix_h, int anchor_x, int anchor_y, float factor)
+		{
+			filters::view	out	=	next();
+			convolve(current, out, matrix, matrix_w, matrix_h, anchor_x, anchor_y, factor);
+			current	=	out;
+		}
+	};
+
+	/*
+	 *	Original filters returned their source when they had nothing
+	 *	to do, alpha included.
+	 */
+	void
+	copy(const filters::view& source, const filters::view& output)
+	{
+		for (int y = 0; y < source.height; ++y)
+			std::memcpy(pixel(output, 0, y), pixel(source, 0, y), source.width * 4);
+	}
+
+	template <typename Fn>
+	void
+	map_pixels(const filters::view& source, const filters::view& output, Fn fn)
+	{
+		for (int y = 0; y < source.height; ++y)
+			for (int x = 0; x < source.width; ++x)
+			{
+				const unsigned char*	p	=	pixel(source, x, y);
+				int						rgb[3]	=	{p[0], p[1], p[2]};
+				fn(rgb);
+				put(output, x, y, rgb[0], rgb[1], rgb[2]);
+			}
+	}
+}
+
+void
+reference::grayscale(const filters::view& source, const filters::view& output)
+{
+	map_pixels(source, output, [](int* rgb)
+	{
+		rgb[0]	=	rgb[1]	=	rgb[2]	=	(unsigned char) (int) ((rgb[0] + rgb[1] + rgb[2]) / 3.0);
+	});
+}
+
+void
+reference::black_white(const filters::view& source, const filters::view& output)
+{
+	map_pixels(source, output, [](int* rgb)
+	{
+		unsigned char	avg	=	(int) ((rgb[0] + rgb[1] + rgb[2]) / 3.0);
+		rgb[0]	=	rgb[1]	=	rgb[2]	=	avg > 127 ? 255 : 0;
+	});
+}
+
+void
+reference::tint(const filters::view& source, const filters::view& output)
+{
+	map_pixels(source, output, [](int* rgb)
+	{
+		int	r	=	rgb[0];
+		rgb[0]	=	rgb[2];
+		rgb[2]	=	rgb[1];
+		rgb[1]	=	r;
+	});
+}
+
+void
+reference::lighten(const filters::view& source, const filters::view& output, int n)
+{
+	if (!n)	return copy(source, output);
+
+	map_pixels(source, output, [n](int* rgb)
+	{
+		for (int c = 0; c < 3; ++c)
+			if (n > 0)	rgb[c]	=	(rgb[c] + n) <= 255 ? (rgb[c] + n) : 255;
+			else		rgb[c]	=	(rgb[c] + n) >= 0 ? (rgb[c] + n) : 0;
+	});
+}
+
+void
+reference::contrast(const filters::view& source, const filters::view& output, float n)
+{
+	if (n == 1.0)	return copy(source, output);
+
+	map_pixels(source, output, [n](int* rgb)
+	{
+		for (int c = 0; c < 3; ++c)
+			rgb[c]	=	(rgb[c] * n) <= 255 ? (unsigned char) (int) (rgb[c] * n) : 255;
+	});
+}
+
+void
+reference::gaussian_blur(const filters::view& source, const filters::view& output, unsigned int n)
+{
+	const int	matrix[7][7]	=
+	{
+		{0,		0,		0,		5,		0,		0,		0},
+		{0,		5,		18,		32,		18,		5,		0},
+		{0,		18,		64,		100,	64,		18,		0},
+		{5,		32,		100,	100,	100,	32,		5},
+		{0,		18,		64,		100,	64,		18,		0},
+		{0,		5,		18,		32,		18,		5,		0},
+		{0,		0,		0,		5,		0,		0,		0}
+	};
+
+	if (!n)	return copy(source, output);
+
+	passes	p(source, output, n);
+	for (unsigned int i = 0; i < n; ++i)
+		p.run(&matrix[0][0], 7, 7, 3, 3, normalising(&matrix[0][0], 49));
+}
+
+void
+reference::gaussian_blur_optimized(const filters::view& source, const filters::view& output, unsigned int n)
+{
+	const int	matrix[7]	=	{5,		32,		100,	100,	100,	32,		5};
+
+	if (!n)	return copy(source, output);
+
+	passes	p(source, output, 2 * n);
+	for (unsigned int i = 0; i < n; ++i)
+		p.run(matrix, 7, 1, 3, 0, normalising(matrix, 7));
+	for (unsigned int i = 0; i < n; ++i)
+		p.run(matrix, 1, 7, 0, 3, normalising(matrix, 7));
+}
+
+void
+reference::box_blur(const filters::view& source, const filters::view& output, unsigned int n)
+{
+	const int	matrix[3][3]	=
+	{
+		{1,	1,	1},
+		{1,	1,	1},
+		{1,	1,	1}
+	};
+
+	if (!n)	return copy(source, output);
+
+	passes	p(source, output, n);
+	for (unsigned int i = 0; i < n; ++i)
+		p.run(&matrix[0][0], 3, 3, 1, 1, normalising(&matrix[0][0], 9));
+}
+
+void
+reference::detect_edges(const filters::view& source, const filters::view& output)
+{
+	const int	matrix[5][5]	=
+	{
+		{0,	0,	-1,	0,	0},
+		{0, 0,	-1,	0,	0},
+		{0, 0,	2,	0,	0},
+		{0, 0,	0,	0,	0},
+		{0, 0,	0,	0,	0}
+	};
+
+	convolve(source, output, &matrix[0][0], 5, 5, 1, 1, 1.0f);
+}
+
+void
+reference::sharpen(const filters::view& source, const filters::view& output)
+{
+	const int	matrix[3][3]	=
+	{
+		{0, -1, 0},
+		{-1, 5, -1},
+		{0, -1, 0}
+	};
+
+	convolve(source, output, &matrix[0][0], 3, 3, 1, 1, 1.0f);
+}
+
+void
+reference::alpha_blending(const filters::view& background, const filters::view& foreground, float alpha, const filters::view& output)
+{
+	if (alpha == 1.0)	return copy(foreground, output);
+	if (alpha == 0.0)	return copy(background, output);
+
+	for (int y = 0; y < background.height; ++y)
+		for (int x = 0; x < background.width; ++x)
+		{
+			const unsigned char*	bg	=	pixel(background, x, y);
+			const unsigned char*	fg	=	pixel(foreground, x, y);
+			int						rgb[3];
+			for (int c = 0; c < 3; ++c)
+				rgb[c]	=	std::min(std::max(int((bg[c] * (1.0 - alpha)) + (fg[c] * alpha)), 0), 255);
+			put(output, x, y, rgb[0], rgb[1], rgb[2]);
+		}
+}
+
+void
+reference::alpha_blending(const filters::view& background, const filters::view& foreground, const filters::view& mask, const filters::view& output)
+{
+	for (int y = 0; y < background.height; ++y)
+		for (int x = 0; x < background.width; ++x)
+		{
+			const unsigned char*	bg		=	pixel(background, x, y);
+			const unsigned char*	fg		=	pixel(foreground, x, y);
+			float					alpha	=	(float) pixel(mask, x, y)[2] / 255;
+			int						rgb[3];
+			for (int c = 0; c < 3; ++c)
+				rgb[c]	=	std::min(std::max(int((bg[c] * (1.0 - alpha)) + (fg[c] * alpha)), 0), 255);
+			put(output, x, y, rgb[0], rgb[1], rgb[2]);
+		}
+}
+
+void
+reference::heightmap(const filters::view& source, const filters::view& output)
+{
+	const unsigned char	hill[3]	=	{0, 255, 0};
+	const unsigned char	mntn[3]	=	{255, 0, 0};
+
+	for (int y = 0; y < source.height; ++y)
+		for (int x = 0; x < source.width; ++x)
+		{
+			const unsigned char*	p	=	pixel(source, x, y);
+			if (std::floor(p[0] / 256.0 * 3) > 0)
+				put(output, x, y,	(unsigned char) filters::lerp(hill[0], mntn[0], p[0] / 256.0),
+									(unsigned char) filters::lerp(hill[1], mntn[1], p[1] / 256.0),
+									(unsigned char) filters::lerp(hill[2], mntn[2], p[2] / 256.0));
+			else
+				put(output, x, y, 0, 0, (unsigned char) (255 * (p[0] / (256.0 / 3))));
+		}
+}
+
+void
+reference::gradient(const filters::view& output, ALLEGRO_COLOR from, ALLEGRO_COLOR to)
+{
+	unsigned char	a[3];
+	unsigned char	b[3];
+	al_unmap_rgb(from, &a[0], &a[1], &a[2]);
+	al_unmap_rgb(to, &b[0], &b[1], &b[2]);
+
+	for (int y = 0; y < output.height; ++y)
+		for (int x = 0; x < output.width; ++x)
+			put(output, x, y,	(int) filters::lerp(a[0], b[0], x / (float) output.width),
+								(int) filters::lerp(a[1], b[1], x / (float) output.width),
+								(int) filters::lerp(a[2], b[2], x / (float) output.width));
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "../filters.hpp"
+
+/**
+ *	filtry w pierwotnej postaci: piksel po pikselu, te same wagi,
+ *	zaokrąglenia i zawijanie krawędzi co pierwsza wersja filters.cpp.
+ *	służą tylko jako wzorzec, z którym porównywane są szybkie wersje.
+*/
+
+namespace reference
+{
+	/*
+	 *			source view		,	output view
+	 *	ARGS:	filters::view	,	filters::view
+	 *	Point filters, output has the size of source.
+	 */
+	void	grayscale(const filters::view& source, const filters::view& output);
+	void	black_white(const filters::view& source, const filters::view& output);
+	void	tint(const filters::view& source, const filters::view& output);
+	void	lighten(const filters::view& source, const filters::view& output, int n);
+	void	contrast(const filters::view& source, const filters::view& output, float n);
+
+	/*
+	 *			source view		,	output view		,	# of iterations
+	 *	ARGS:	filters::view	,	filters::view	,	unsigned int
+	 *	Convolutions with the original kernels and BORDER_WRAP. The
+	 *	original read pass i + 1 from the bitmap pass i was still being
+	 *	written to; here every pass reads a finished copy, as the
+	 *	filters do since they were moved onto raster.
+	 */
+	void	gaussian_blur(const filters::view& source, const filters::view& output, unsigned int n);
+	void	gaussian_blur_optimized(const filters::view& source, const filters::view& output, unsigned int n);
+	void	box_blur(const filters::view& source, const filters::view& output, unsigned int n);
+	void	detect_edges(const filters::view& source, const filters::view& output);
+	void	sharpen(const filters::view& source, const filters::view& output);
+
+	/*
+	 *			background		,	foreground		,	alpha / mask	,	output
+	 *	ARGS:	filters::view	,	filters::view	,	float / view	,	filters::view
+	 */
+	void	alpha_blending(const filters::view& background, const filters::view& foreground, float alpha, const filters::view& output);
+	void	alpha_blending(const filters::view& background, const filters::view& foreground, const filters::view& mask, const filters::view& output);
+
+	/*
+	 *			height view		,	output view
+	 *	ARGS:	filters::view	,	filters::view
+	 *	Original palette: blue water up to 85, then every channel lerped
+	 *	from green to red by its own value, so heights should be grey.
+	 */
+	void	heightmap(const filters::view& source, const filters::view& output);
+
+	/*
+	 *			output view		,	left colour		,	right colour
+	 *	ARGS:	filters::view	,	ALLEGRO_COLOR	,	ALLEGRO_COLOR
+	 */
+	void	gradient(const filters::view& output, ALLEGRO_COLOR from, ALLEGRO_COLOR to);
+}